@@ -1,9 +1,66 @@
 #include "Encoders.h"
+#include "JpegTranscoder.h"
+#include <algorithm>
+#include <cstring>
+extern "C"
+{
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+}
 // #include <spdlog/spdlog.h>
 
+CodecContextPool::~CodecContextPool()
+{
+    Clear();
+}
+
+void CodecContextPool::Put(AVCodecContext *ctx, int key)
+{
+    if (!ctx)
+        return;
+    entries.push_back({ctx, key});
+    while (entries.size() > _capacity)
+    {
+        avcodec_free_context(&entries.front().ctx);
+        entries.pop_front();
+    }
+}
+
+AVCodecContext *CodecContextPool::Take(int w, int h, int key)
+{
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        if (it->ctx->width == w && it->ctx->height == h && it->key == key)
+        {
+            AVCodecContext *ctx = it->ctx;
+            entries.erase(it);
+            return ctx;
+        }
+    }
+    return nullptr;
+}
+
+void CodecContextPool::Clear()
+{
+    for (auto &e : entries)
+        avcodec_free_context(&e.ctx);
+    entries.clear();
+}
+
+MjpegEncoder::MjpegEncoder(int threads)
+{
+    SetThreads(threads);
+}
+
 MjpegEncoder::~MjpegEncoder()
 {
     Close();
+    av_packet_free(&pkt);
+}
+
+void MjpegEncoder::SetThreads(int threads)
+{
+    _threads = std::max(1, threads);
 }
 
 bool MjpegEncoder::Open(int w, int h, int quality)
@@ -12,6 +69,9 @@ bool MjpegEncoder::Open(int w, int h, int quality)
     if (!codec)
         return false;
 
+    open_threads = _threads;
+    int threads = std::clamp(open_threads, 1, std::max(1, h / kMinRowsPerThread));
+
     enc_ctx = avcodec_alloc_context3(codec);
     enc_ctx->width = w;
     enc_ctx->height = h;
@@ -21,8 +81,159 @@ bool MjpegEncoder::Open(int w, int h, int quality)
     enc_ctx->flags |= AV_CODEC_FLAG_QSCALE;
     enc_ctx->global_quality = FF_QP2LAMBDA * quality;
     _quality = quality;
+    out_pool.Attach(enc_ctx);
+    // 分片线程：一帧内按 MCU 行并行，片间以重启标记分隔
+    if (threads > 1 && (codec->capabilities & AV_CODEC_CAP_SLICE_THREADS))
+    {
+        enc_ctx->thread_count = threads;
+        enc_ctx->thread_type = FF_THREAD_SLICE;
+    }
+
+    if (avcodec_open2(enc_ctx, codec, nullptr) < 0)
+        return false;
+    // 分片线程没有生效（编码器不支持或 FFmpeg 未启用线程）：自行切条，失败时保持单线程
+    if (threads > 1 && !(enc_ctx->active_thread_type & FF_THREAD_SLICE) && !OpenStrips(w, h, quality, threads))
+        CloseStrips();
+    return true;
+}
+
+bool MjpegEncoder::OpenStrips(int w, int h, int quality, int count)
+{
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    // yuvj420p 的 MCU 为 16 行，除最后一条外每条都是整数个 MCU 行
+    int mcuRows = (h + 15) / 16;
+    int perStrip = (mcuRows + count - 1) / count;
+    for (int y = 0; y < h; y += perStrip * 16)
+    {
+        Strip strip;
+        strip.y = y;
+        strip.ctx = avcodec_alloc_context3(codec);
+        strip.frame = av_frame_alloc();
+        strip.pkt = av_packet_alloc();
+        strips.push_back(strip);
+        if (!strip.ctx || !strip.frame || !strip.pkt)
+            return false;
+        strip.ctx->width = w;
+        strip.ctx->height = std::min(perStrip * 16, h - y);
+        strip.ctx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+        strip.ctx->time_base = {1, 25};
+        strip.ctx->flags |= AV_CODEC_FLAG_QSCALE;
+        strip.ctx->global_quality = FF_QP2LAMBDA * quality;
+        // 各条必须共用同一组 Huffman 表才能拼接，不能按条优化
+        av_opt_set(strip.ctx->priv_data, "huffman", "default", 0);
+        out_pool.Attach(strip.ctx);
+        if (avcodec_open2(strip.ctx, codec, nullptr) < 0)
+            return false;
+    }
+    strip_spans.resize(strips.size());
+    if (!stitcher)
+        stitcher = std::make_unique<JpegTranscoder>();
+    strip_stop = false;
+    for (size_t i = 1; i < strips.size(); ++i)
+        strip_threads.emplace_back(&MjpegEncoder::StripWorker, this, i, strip_gen);
+    return true;
+}
 
-    return avcodec_open2(enc_ctx, codec, nullptr) >= 0;
+void MjpegEncoder::CloseStrips()
+{
+    {
+        std::lock_guard<std::mutex> lk(strip_mtx);
+        strip_stop = true;
+    }
+    strip_cv.notify_all();
+    for (auto &t : strip_threads)
+        t.join();
+    strip_threads.clear();
+    for (auto &strip : strips)
+    {
+        avcodec_free_context(&strip.ctx);
+        av_frame_free(&strip.frame);
+        av_packet_free(&strip.pkt);
+    }
+    strips.clear();
+    strip_spans.clear();
+}
+
+void MjpegEncoder::StripWorker(size_t index, uint64_t seen)
+{
+    std::unique_lock<std::mutex> lk(strip_mtx);
+    while (true)
+    {
+        strip_cv.wait(lk, [&]
+                      { return strip_stop || strip_gen != seen; });
+        if (strip_stop)
+            return;
+        seen = strip_gen;
+        const AVFrame *frame = strip_frame;
+        lk.unlock();
+        bool ok = EncodeStrip(strips[index], frame);
+        lk.lock();
+        strip_ok = strip_ok && ok;
+        if (--strip_pending == 0)
+            strip_done_cv.notify_one();
+    }
+}
+
+bool MjpegEncoder::EncodeStrip(Strip &strip, const AVFrame *frame)
+{
+    // 条带是原帧的视图：共享缓冲，只移动平面指针
+    if (av_frame_ref(strip.frame, frame) < 0)
+        return false;
+    strip.frame->height = strip.ctx->height;
+    for (int p = 0; p < 3; ++p)
+        strip.frame->data[p] += static_cast<ptrdiff_t>(p ? strip.y / 2 : strip.y) * strip.frame->linesize[p];
+    int ret = avcodec_send_frame(strip.ctx, strip.frame);
+    av_frame_unref(strip.frame);
+    return ret >= 0 && avcodec_receive_packet(strip.ctx, strip.pkt) >= 0;
+}
+
+void MjpegEncoder::EncodeStrips(AVFrame *frame, EncoderOutput &out)
+{
+    if (frame->format != AV_PIX_FMT_YUVJ420P || frame->width != enc_ctx->width || frame->height != enc_ctx->height)
+        return;
+    // 第一条在当前线程编码，其余交给常驻的工作线程
+    {
+        std::lock_guard<std::mutex> lk(strip_mtx);
+        strip_frame = frame;
+        strip_pending = strips.size() - 1;
+        strip_ok = true;
+        ++strip_gen;
+    }
+    strip_cv.notify_all();
+    bool ok = EncodeStrip(strips[0], frame);
+    {
+        std::unique_lock<std::mutex> lk(strip_mtx);
+        strip_done_cv.wait(lk, [&]
+                           { return strip_pending == 0; });
+        ok = ok && strip_ok;
+        strip_frame = nullptr;
+    }
+    // 各条的包直接拼进池中的输出缓冲，不经过中间拷贝
+    size_t size = 0;
+    AVBufferRef *buf = nullptr;
+    if (ok)
+    {
+        for (size_t i = 0; i < strips.size(); ++i)
+            strip_spans[i] = {strips[i].pkt->data, static_cast<size_t>(strips[i].pkt->size)};
+        size_t bound = JpegTranscoder::StitchBound(strip_spans);
+        buf = out_pool.Get(bound);
+        if (buf)
+            size = stitcher->Stitch(strip_spans, buf->data, bound);
+    }
+    for (auto &strip : strips)
+        av_packet_unref(strip.pkt);
+    if (size == 0)
+    {
+        av_buffer_unref(&buf);
+        return;
+    }
+    out.data = SharedBuffer(buf, size);
+    out.width = enc_ctx->width;
+    out.height = enc_ctx->height;
+    out.timestamp = frame->pts;
+    out.keyframe = true;
+    out.codec = AV_CODEC_ID_MJPEG;
+    out.success = true;
 }
 
 AVCodecContext *MjpegEncoder::GetCodecContext()
@@ -32,20 +243,45 @@ AVCodecContext *MjpegEncoder::GetCodecContext()
 
 void MjpegEncoder::Encode(AVFrame *frame, EncoderOutput &out)
 {
-    if (!enc_ctx || avcodec_send_frame(enc_ctx, frame) < 0)
+    // 线程数变化：按原尺寸与质量重开
+    if (enc_ctx && _threads != open_threads)
+    {
+        int w = enc_ctx->width;
+        int h = enc_ctx->height;
+        Close();
+        Open(w, h, _quality);
+    }
+    if (!enc_ctx || !frame)
+        return;
+    if (!pkt && !(pkt = av_packet_alloc()))
+        return;
+    // qscale 随帧下发（编码器按帧的 quality 选量化表），换质量不必重开编码器
+    int quality = frame->quality;
+    frame->quality = FF_QP2LAMBDA * _quality;
+    if (!strips.empty())
+    {
+        EncodeStrips(frame, out);
+        frame->quality = quality;
+        return;
+    }
+    int ret = avcodec_send_frame(enc_ctx, frame);
+    frame->quality = quality;
+    if (ret < 0)
         return;
 
-    AVPacket *pkt = av_packet_alloc();
     if (avcodec_receive_packet(enc_ctx, pkt) == 0)
     {
-        out.data.assign(pkt->data, pkt->data + pkt->size);
+        // 直接引用包的缓冲区，不拷贝
+        out.data = SharedBuffer::FromPacket(pkt);
         out.width = enc_ctx->width;
         out.height = enc_ctx->height;
         // spdlog::info("Encoded MJPEG frame: {} bytes, {}x{}, timestamp: {} ms", pkt->size, out.width, out.height, pkt->pts);
         out.timestamp = pkt->pts;
+        out.keyframe = true;
+        out.codec = AV_CODEC_ID_MJPEG;
         out.success = true;
+        av_packet_unref(pkt);
     }
-    av_packet_free(&pkt);
 }
 
 void MjpegEncoder::Close()
@@ -55,13 +291,413 @@ void MjpegEncoder::Close()
         avcodec_free_context(&enc_ctx);
         enc_ctx = nullptr;
     }
+    CloseStrips();
 }
 
 bool MjpegEncoder::Reset(int w, int h, int quality)
+{
+    // 只改质量：下一帧直接生效，码率控制每帧都可能调整
+    if (enc_ctx && enc_ctx->width == w && enc_ctx->height == h)
+    {
+        _quality = quality;
+        return true;
+    }
+    // 换尺寸：当前编码器放回缓存（自行切条的不缓存），目标尺寸之前用过的话直接取回
+    if (enc_ctx && strips.empty())
+    {
+        pool.Put(enc_ctx, open_threads);
+        enc_ctx = nullptr;
+    }
+    Close();
+    int threads = _threads;
+    if (AVCodecContext *cached = pool.Take(w, h, threads))
+    {
+        enc_ctx = cached;
+        open_threads = threads;
+        _quality = quality;
+        return true;
+    }
+    return Open(w, h, quality);
+}
+
+// 帧内编码的格式（MJPEG 等）每帧独立可解码
+bool IEncoder::IntraOnly() const
+{
+    AVCodecID id = CodecId();
+    if (id == AV_CODEC_ID_NONE)
+        return true;
+    const AVCodecDescriptor *desc = avcodec_descriptor_get(id);
+    return desc && (desc->props & AV_CODEC_PROP_INTRA_ONLY);
+}
+
+namespace
+{
+    // 起始码 00 00 01 之后第一个字节的位置，找不到返回 size
+    size_t NextStartCode(const uint8_t *data, size_t size, size_t pos)
+    {
+        for (; pos + 3 <= size; ++pos)
+            if (data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1)
+                return pos + 3;
+        return size;
+    }
+
+    // 从关键帧里取出序列头：H.264 取 SPS / PPS，MPEG-4 取第一个 VOP 之前的部分
+    std::vector<uint8_t> ExtractHeaders(AVCodecID id, const uint8_t *data, size_t size)
+    {
+        std::vector<uint8_t> headers;
+        if (id == AV_CODEC_ID_MPEG4)
+        {
+            for (size_t p = NextStartCode(data, size, 0); p < size; p = NextStartCode(data, size, p))
+            {
+                if (data[p] == 0xB6)
+                {
+                    headers.assign(data, data + p - 3);
+                    break;
+                }
+            }
+            return headers;
+        }
+        size_t p = NextStartCode(data, size, 0);
+        while (p < size)
+        {
+            size_t next = NextStartCode(data, size, p);
+            // NAL 的结尾：下一个起始码（含 4 字节起始码多出的 0）之前
+            size_t end = next < size ? next - 3 : size;
+            while (next < size && end > p && data[end - 1] == 0)
+                --end;
+            int type = data[p] & 0x1F;
+            if (type == 7 || type == 8)
+            {
+                static const uint8_t sc[4] = {0, 0, 0, 1};
+                headers.insert(headers.end(), sc, sc + 4);
+                headers.insert(headers.end(), data + p, data + end);
+            }
+            p = next;
+        }
+        return headers;
+    }
+
+    // 全范围 -> 有限范围（BT.601 的 16-235 / 16-240）
+    struct RangeLut
+    {
+        uint8_t y[256];
+        uint8_t c[256];
+        RangeLut()
+        {
+            for (int v = 0; v < 256; ++v)
+            {
+                y[v] = static_cast<uint8_t>(16 + (v * 219 + 127) / 255);
+                c[v] = static_cast<uint8_t>(16 + (v * 224 + 127) / 255);
+            }
+        }
+    };
+}
+
+VideoEncoder::VideoEncoder(Codec codec, int gop) : _codec(codec), _gop(gop > 0 ? gop : 50)
+{
+}
+
+VideoEncoder::~VideoEncoder()
+{
+    Close();
+}
+
+bool VideoEncoder::Open(int w, int h, int quality)
+{
+    const AVCodec *codec = nullptr;
+    if (_codec == Codec::H264)
+        codec = avcodec_find_encoder_by_name("libx264");
+    if (!codec)
+        codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    if (!codec)
+        return false;
+
+    enc_ctx = avcodec_alloc_context3(codec);
+    enc_ctx->width = w;
+    enc_ctx->height = h;
+    enc_ctx->time_base = {1, 25};
+    // 低延迟：不用 B 帧，编码器不缓存帧
+    enc_ctx->max_b_frames = 0;
+    enc_ctx->gop_size = _gop;
+    _quality = quality;
+    out_pool.Attach(enc_ctx);
+
+    full_range = false;
+    for (const AVPixelFormat *p = codec->pix_fmts; p && *p != AV_PIX_FMT_NONE; ++p)
+        full_range |= *p == AV_PIX_FMT_YUVJ420P;
+    enc_ctx->pix_fmt = full_range ? AV_PIX_FMT_YUVJ420P : AV_PIX_FMT_YUV420P;
+    enc_ctx->color_range = full_range ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+
+    if (codec->id == AV_CODEC_ID_H264)
+    {
+        av_opt_set(enc_ctx->priv_data, "preset", "veryfast", 0);
+        av_opt_set(enc_ctx->priv_data, "tune", "zerolatency", 0);
+        av_opt_set_int(enc_ctx->priv_data, "forced-idr", 1, 0);
+        // qscale 1-31 映射到 crf 16-46
+        av_opt_set_int(enc_ctx->priv_data, "crf", std::clamp(15 + quality, 0, 51), 0);
+    }
+    else
+    {
+        enc_ctx->flags |= AV_CODEC_FLAG_QSCALE;
+        enc_ctx->global_quality = FF_QP2LAMBDA * quality;
+    }
+
+    if (avcodec_open2(enc_ctx, codec, nullptr) < 0)
+    {
+        avcodec_free_context(&enc_ctx);
+        return false;
+    }
+    // next_pts 不归零：缓存里取回的上下文也要看到递增的 pts
+    pkt = av_packet_alloc();
+    headers.clear();
+    // 新开的编码器第一帧总是关键帧
+    force_key = false;
+    return true;
+}
+
+AVCodecContext *VideoEncoder::GetCodecContext()
+{
+    return enc_ctx;
+}
+
+AVCodecID VideoEncoder::CodecId() const
+{
+    if (enc_ctx)
+        return enc_ctx->codec_id;
+    return _codec == Codec::H264 ? AV_CODEC_ID_H264 : AV_CODEC_ID_MPEG4;
+}
+
+void VideoEncoder::RequestKeyframe()
+{
+    force_key = true;
+}
+
+void VideoEncoder::Flush()
+{
+    // libx264 支持原地清空；MPEG-4 没有 B 帧、不缓存帧，从关键帧重新开始即可
+    if (enc_ctx && (enc_ctx->codec->capabilities & AV_CODEC_CAP_ENCODER_FLUSH))
+        avcodec_flush_buffers(enc_ctx);
+    force_key = true;
+}
+
+AVFrame *VideoEncoder::ToLimitedRange(const AVFrame *frame)
+{
+    static const RangeLut lut;
+    if (!limited || limited->width != frame->width || limited->height != frame->height)
+    {
+        av_frame_free(&limited);
+        limited = av_frame_alloc();
+        limited->format = AV_PIX_FMT_YUV420P;
+        limited->width = frame->width;
+        limited->height = frame->height;
+        if (av_frame_get_buffer(limited, 0) < 0)
+        {
+            av_frame_free(&limited);
+            return nullptr;
+        }
+    }
+    if (av_frame_make_writable(limited) < 0)
+        return nullptr;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const uint8_t *table = i == 0 ? lut.y : lut.c;
+        int w = i == 0 ? frame->width : (frame->width + 1) / 2;
+        int h = i == 0 ? frame->height : (frame->height + 1) / 2;
+        for (int y = 0; y < h; ++y)
+        {
+            const uint8_t *src = frame->data[i] + static_cast<ptrdiff_t>(y) * frame->linesize[i];
+            uint8_t *dst = limited->data[i] + static_cast<ptrdiff_t>(y) * limited->linesize[i];
+            for (int x = 0; x < w; ++x)
+                dst[x] = table[src[x]];
+        }
+    }
+    return limited;
+}
+
+void VideoEncoder::Encode(AVFrame *frame, EncoderOutput &out)
+{
+    if (!enc_ctx || !frame)
+        return;
+
+    AVFrame *input = full_range ? frame : ToLimitedRange(frame);
+    if (!input)
+        return;
+
+    // 调用方的帧会被复用，改过的字段编码后还原
+    int64_t pts = frame->pts;
+    AVPictureType pict_type = input->pict_type;
+    int flags = input->flags;
+    // 编码器要求 pts 严格递增，seek / 循环后调用方的 pts 会回退
+    input->pts = next_pts++;
+    input->pict_type = AV_PICTURE_TYPE_NONE;
+    if (force_key.exchange(false))
+    {
+        input->pict_type = AV_PICTURE_TYPE_I;
+        input->flags |= AV_FRAME_FLAG_KEY;
+    }
+    int ret = avcodec_send_frame(enc_ctx, input);
+    input->pts = pts;
+    input->pict_type = pict_type;
+    input->flags = flags;
+    if (ret < 0)
+        return;
+
+    // 通常一帧对应一个包，直接引用；偶尔出多个包时才拼接
+    SharedBuffer first;
+    std::vector<uint8_t> joined;
+    out.keyframe = false;
+    while (avcodec_receive_packet(enc_ctx, pkt) == 0)
+    {
+        if (first.empty())
+        {
+            out.keyframe = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+            first = SharedBuffer::FromPacket(pkt);
+        }
+        else
+        {
+            if (joined.empty())
+                joined.assign(first.begin(), first.end());
+            joined.insert(joined.end(), pkt->data, pkt->data + pkt->size);
+        }
+        av_packet_unref(pkt);
+    }
+    if (!joined.empty())
+        out.data = std::move(joined);
+    else
+        out.data = std::move(first);
+    if (out.data.empty())
+        return;
+
+    out.codec = enc_ctx->codec_id;
+    if (out.keyframe)
+    {
+        if (headers.empty())
+            headers = ExtractHeaders(enc_ctx->codec_id, out.data.data(), out.data.size());
+        out.extradata = headers;
+    }
+    else
+    {
+        out.extradata.clear();
+    }
+    out.width = enc_ctx->width;
+    out.height = enc_ctx->height;
+    out.timestamp = pts;
+    out.success = true;
+}
+
+void VideoEncoder::Close()
+{
+    if (enc_ctx)
+    {
+        avcodec_free_context(&enc_ctx);
+        enc_ctx = nullptr;
+    }
+    av_packet_free(&pkt);
+    av_frame_free(&limited);
+}
+
+bool VideoEncoder::Reset(int w, int h, int quality)
 {
     if (enc_ctx && enc_ctx->width == w && enc_ctx->height == h &&
         _quality == quality)
         return true;
+    // 换尺寸 / 质量：当前编码器放回缓存，目标参数之前用过的话直接取回
+    if (enc_ctx)
+    {
+        pool.Put(enc_ctx, _quality);
+        enc_ctx = nullptr;
+    }
+    if (AVCodecContext *cached = pool.Take(w, h, quality))
+    {
+        enc_ctx = cached;
+        _quality = quality;
+        // 取回的上下文还留着上次的参考帧；序列头随尺寸变化，从下一个关键帧重新提取
+        Flush();
+        headers.clear();
+        return true;
+    }
     Close();
     return Open(w, h, quality);
 }
+
+RawEncoder::RawEncoder(Format format) : _format(format)
+{
+}
+
+bool RawEncoder::Open(int w, int h, int /*quality*/)
+{
+    if (w <= 0 || h <= 0)
+        return false;
+    _width = w;
+    _height = h;
+    return true;
+}
+
+AVCodecContext *RawEncoder::GetCodecContext()
+{
+    return nullptr;
+}
+
+AVPixelFormat RawEncoder::InputFormat() const
+{
+    switch (_format)
+    {
+    case Format::NV12:
+        return AV_PIX_FMT_NV12;
+    case Format::RGBA:
+        return AV_PIX_FMT_RGBA;
+    default:
+        return AV_PIX_FMT_YUVJ420P;
+    }
+}
+
+void RawEncoder::Encode(AVFrame *frame, EncoderOutput &out)
+{
+    // 尺寸 / 格式与配置不一致（配置刚变更）的帧不输出
+    if (!frame || frame->format != InputFormat() || frame->width != _width || frame->height != _height)
+        return;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(InputFormat());
+    int planes = av_pix_fmt_count_planes(InputFormat());
+
+    size_t total = 0;
+    size_t size[4] = {};
+    for (int p = 0; p < planes; ++p)
+    {
+        if (frame->linesize[p] <= 0)
+            return;
+        bool chroma = p == 1 || p == 2;
+        int rows = chroma ? AV_CEIL_RSHIFT(_height, desc->log2_chroma_h) : _height;
+        size[p] = static_cast<size_t>(frame->linesize[p]) * rows;
+        out.offset[p] = total;
+        out.linesize[p] = frame->linesize[p];
+        total += size[p];
+    }
+    // 每个平面一次整块拷贝
+    AVBufferRef *buf = out_pool.Get(total);
+    if (!buf)
+        return;
+    for (int p = 0; p < planes; ++p)
+        std::memcpy(buf->data + out.offset[p], frame->data[p], size[p]);
+    out.data = SharedBuffer(buf, total);
+
+    out.planes = planes;
+    out.format = InputFormat();
+    out.codec = AV_CODEC_ID_RAWVIDEO;
+    out.keyframe = true;
+    out.width = _width;
+    out.height = _height;
+    out.timestamp = frame->pts;
+    out.success = true;
+}
+
+void RawEncoder::Close()
+{
+    _width = 0;
+    _height = 0;
+}
+
+bool RawEncoder::Reset(int w, int h, int quality)
+{
+    return Open(w, h, quality);
+}
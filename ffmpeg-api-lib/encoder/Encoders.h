@@ -2,6 +2,14 @@
 #include <vector>
 #include <cstdint>
 #include <memory>
+#include <atomic>
+#include <deque>
+#include "SharedBuffer.h"
+#include "BufferPool.h"
+#include "JpegTranscoder.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 extern "C"
 {
@@ -9,11 +17,26 @@ extern "C"
 }
 struct EncoderOutput
 {
-    std::vector<uint8_t> data;
+    // 只读的共享数据：拷贝 EncoderOutput 只增加引用计数，不复制字节
+    SharedBuffer data;
     int width = 0;
     int height = 0;
     int64_t timestamp = 0;
     bool success = false;
+    // 帧间编码：data 以关键帧开头时为 true（MJPEG 每帧都是）
+    bool keyframe = false;
+    AVCodecID codec = AV_CODEC_ID_NONE;
+    // 关键帧附带的序列头（H.264 SPS/PPS 或 MPEG-4 VOS/VOL，Annex B / 起始码格式），其余帧为空
+    std::vector<uint8_t> extradata;
+    // 原始像素输出（codec 为 rawvideo）：像素格式，以及各平面在 data 中的偏移与步长
+    AVPixelFormat format = AV_PIX_FMT_NONE;
+    int planes = 0;
+    int linesize[4] = {};
+    size_t offset[4] = {};
+    // 发布序号：每路输出单调递增，画面有变化才加一；0 表示尚未发布
+    uint64_t seq = 0;
+    // 条件获取：自读者给出的序号以来没有新帧，data 为空
+    bool not_modified = false;
 };
 // 编码器接口规范
 class IEncoder
@@ -25,25 +48,182 @@ public:
     virtual void Close() = 0;
     virtual bool Reset(int w, int h, int quality = 8) = 0;
     virtual AVCodecContext* GetCodecContext() { return nullptr; }
+    // 输出的编码格式，用于判断能否跳过解码直接输出源码流
+    virtual AVCodecID CodecId() const { return AV_CODEC_ID_NONE; }
+    // 让下一次 Encode 输出关键帧（帧内编码忽略）
+    virtual void RequestKeyframe() {}
+    // seek / 循环：丢弃编码器内部缓存的帧与参考，保留已打开的上下文（帧内编码无状态，忽略）
+    virtual void Flush() {}
+    // Encode 需要的输入像素格式，裁剪缩放时直接输出该格式
+    virtual AVPixelFormat InputFormat() const { return AV_PIX_FMT_YUVJ420P; }
+    // 单帧并行编码的线程数，可在编码过程中随时修改，下一帧生效（不支持的编码器忽略）
+    virtual void SetThreads(int /*threads*/) {}
+    // 每帧都可单独解码；否则输出必须按顺序、从关键帧开始交给读者
+    bool IntraOnly() const;
+};
+
+
+// 已打开的编码器上下文缓存：输出尺寸来回切换时直接取回，省掉 avcodec_open2 与首帧的初始化开销
+//      key 区分尺寸之外影响打开参数的设置（线程数、质量等），由使用者决定含义
+//      每个编码器各自持有，不跨线程共享
+class CodecContextPool
+{
+public:
+    explicit CodecContextPool(size_t capacity = 3) : _capacity(capacity) {}
+    ~CodecContextPool();
+
+    // 放回一个已打开的上下文，超出容量时释放最早放入的
+    void Put(AVCodecContext *ctx, int key);
+    // 取出尺寸与 key 都匹配的上下文，没有时返回 nullptr
+    AVCodecContext *Take(int w, int h, int key);
+    void Clear();
+
+private:
+    struct Entry
+    {
+        AVCodecContext *ctx;
+        int key;
+    };
+    size_t _capacity;
+    std::deque<Entry> entries;
 };
 
 // MJPEG 具体实现
+//      多线程：优先用编码器自带的分片线程（按 MCU 行切片，片间插入 RST）；
+//      FFmpeg 不支持时退回自行切条：每条一个单线程编码器并行编码，再按重启间隔拼成一帧
 class MjpegEncoder : public IEncoder
 {
 private:
     AVCodecContext *enc_ctx = nullptr;
+    AVPacket *pkt = nullptr; // 每帧复用
     int _quality = 8;
+    BufferPool out_pool;     // 输出包的缓冲（含切条的各条），JS 释放后回池
+
+    // 每个线程至少分到的行数，输出太小时减少线程数
+    static constexpr int kMinRowsPerThread = 64;
+    std::atomic<int> _threads{1};
+    int open_threads = 1; // 当前编码器按此线程数打开
+
+    // 退回切条时每条的编码器与帧视图
+    struct Strip
+    {
+        AVCodecContext *ctx = nullptr;
+        AVFrame *frame = nullptr;
+        AVPacket *pkt = nullptr;
+        int y = 0;
+    };
+    std::vector<Strip> strips;
+    std::vector<JpegTranscoder::Span> strip_spans; // 各条的编码结果（指向各条的 pkt），拼接时使用
+    std::unique_ptr<JpegTranscoder> stitcher;
+    CodecContextPool pool; // 按 (宽, 高, 线程数) 缓存换尺寸前的编码器
+
+    // 切条的常驻工作线程：第 0 条在调用线程编码，其余每条固定由一个线程负责，不再每帧创建线程
+    std::vector<std::thread> strip_threads;
+    std::mutex strip_mtx;
+    std::condition_variable strip_cv;      // 工作线程等新帧
+    std::condition_variable strip_done_cv; // 调用线程等各条完成
+    const AVFrame *strip_frame = nullptr;
+    uint64_t strip_gen = 0; // 每帧加一，工作线程据此识别新任务
+    size_t strip_pending = 0;
+    bool strip_ok = true;
+    bool strip_stop = false;
+
+    bool OpenStrips(int w, int h, int quality, int count);
+    void CloseStrips();
+    // seen 为启动时的 strip_gen，之后每次变化编码一帧中的第 index 条
+    void StripWorker(size_t index, uint64_t seen);
+    // 编码结果留在 strip.pkt 中，拼接后由调用方释放
+    static bool EncodeStrip(Strip &strip, const AVFrame *frame);
+    void EncodeStrips(AVFrame *frame, EncoderOutput &out);
 
 public:
+    explicit MjpegEncoder(int threads = 1);
     ~MjpegEncoder();
 
     bool Open(int w, int h, int quality = 8) override;
 
     AVCodecContext* GetCodecContext() override;
 
+    AVCodecID CodecId() const override { return AV_CODEC_ID_MJPEG; }
+
+    void SetThreads(int threads) override;
+
     void Encode(AVFrame *frame, EncoderOutput &out) override;
 
     void Close() override;
 
     bool Reset(int w, int h, int quality = 8) override;
-};
\ No newline at end of file
+};
+
+// 帧间编码：优先 libx264，不可用时回退到 FFmpeg 内置的 MPEG-4 Part 2
+//      低延迟：无 B 帧、zerolatency，一帧输入对应一帧输出；GOP 可配置
+//      quality 沿用 qscale 1-31 的含义：MPEG-4 直接作为 qscale，H.264 映射为 crf
+//      输出为 Annex B / 起始码格式的裸流，关键帧带序列头
+class VideoEncoder : public IEncoder
+{
+public:
+    enum class Codec
+    {
+        H264, // libx264，缺失时回退到 MPEG-4
+        Mpeg4
+    };
+
+    explicit VideoEncoder(Codec codec = Codec::H264, int gop = 50);
+    ~VideoEncoder();
+
+    bool Open(int w, int h, int quality = 8) override;
+    AVCodecContext *GetCodecContext() override;
+    void Encode(AVFrame *frame, EncoderOutput &out) override;
+    void Close() override;
+    bool Reset(int w, int h, int quality = 8) override;
+    AVCodecID CodecId() const override;
+    void RequestKeyframe() override;
+    void Flush() override;
+
+private:
+    // 输入是全范围 yuvj420p；编码器不支持时压缩到有限范围
+    AVFrame *ToLimitedRange(const AVFrame *frame);
+
+    Codec _codec;
+    int _gop;
+    int _quality = 8;
+    AVCodecContext *enc_ctx = nullptr;
+    AVPacket *pkt = nullptr;
+    AVFrame *limited = nullptr;
+    bool full_range = false; // 编码器直接接受 yuvj420p
+    int64_t next_pts = 0;
+    std::atomic<bool> force_key{false};
+    BufferPool out_pool; // 输出包的缓冲
+    std::vector<uint8_t> headers; // 从首个关键帧提取的序列头
+    CodecContextPool pool;        // 按 (宽, 高, 质量) 缓存换尺寸 / 质量前的编码器
+};
+
+// 原始像素输出：本机的渲染端直接上传纹理，省掉一次 JPEG 编码和一次解码
+//      格式转换在裁剪缩放时完成（InputFormat），这里只把各平面拷进输出并记录偏移 / 步长
+//      I420 / NV12 为全范围 BT.601；平面保留缩放输出的行对齐，不重新紧凑排列
+class RawEncoder : public IEncoder
+{
+public:
+    enum class Format
+    {
+        I420,
+        NV12,
+        RGBA
+    };
+
+    explicit RawEncoder(Format format = Format::I420);
+
+    bool Open(int w, int h, int quality = 8) override;
+    AVCodecContext *GetCodecContext() override;
+    void Encode(AVFrame *frame, EncoderOutput &out) override;
+    void Close() override;
+    bool Reset(int w, int h, int quality = 8) override;
+    AVCodecID CodecId() const override { return AV_CODEC_ID_RAWVIDEO; }
+    AVPixelFormat InputFormat() const override;
+
+private:
+    Format _format;
+    int _width = 0;
+    int _height = 0;
+    BufferPool out_pool; // 尺寸固定，稳态下每帧都取回同一级的缓冲
+};
@@ -0,0 +1,226 @@
+#include "FrameSubscription.h"
+#include <algorithm>
+#include <cstring>
+
+FrameSubscription::FrameSubscription(int id, Callback callback, const SubscribeOptions &options, bool interFrame, Pull pull)
+    : _id(id), callback(std::move(callback)), pull(std::move(pull)), latest_only(options.latestOnly), inter_frame(interFrame)
+{
+    if (options.maxFps > 0)
+        min_interval = std::chrono::duration_cast<DecodeTask::Clock::duration>(std::chrono::duration<double>(1.0 / options.maxFps));
+}
+
+void FrameSubscription::SetWaker(std::function<void()> fn)
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!cancelled)
+        waker = std::move(fn);
+}
+
+void FrameSubscription::SetOnCancel(std::function<void()> fn)
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (!cancelled)
+        {
+            on_cancel = std::move(fn);
+            return;
+        }
+    }
+    if (fn)
+        fn();
+}
+
+void FrameSubscription::WakeLocked()
+{
+    if (waker)
+        waker();
+}
+
+void FrameSubscription::AppendLocked(EncoderOutput &back, const EncoderOutput &next)
+{
+    // 共享数据只读，拼成新的一块；关键帧标志与序列头保留第一段的
+    size_t size = back.data.size() + next.data.size();
+    AVBufferRef *joined = concat_pool.Get(size);
+    if (!joined)
+        return;
+    std::memcpy(joined->data, back.data.data(), back.data.size());
+    std::memcpy(joined->data + back.data.size(), next.data.data(), next.data.size());
+    back.data = SharedBuffer(joined, size);
+    back.timestamp = next.timestamp;
+}
+
+void FrameSubscription::Offer(const EncoderOutput &out)
+{
+    if (!out.success)
+        return;
+    std::lock_guard<std::mutex> lk(mtx);
+    if (cancelled)
+        return;
+    if (inter_frame)
+    {
+        if (out.keyframe)
+        {
+            // 关键帧之前未投递的数据已无意义
+            dropped += queue.size();
+            queue.clear();
+            queue.push_back(out);
+            wait_key = false;
+        }
+        else if (wait_key)
+        {
+            ++dropped;
+            return;
+        }
+        else if (queue.empty())
+            queue.push_back(out);
+        else
+            AppendLocked(queue.back(), out);
+    }
+    else
+    {
+        while (!queue.empty() && (latest_only || queue.size() >= kMaxQueued))
+        {
+            queue.pop_front();
+            ++dropped;
+        }
+        queue.push_back(out);
+    }
+    WakeLocked();
+}
+
+void FrameSubscription::Touch()
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    if (cancelled)
+        return;
+    touched = true;
+    WakeLocked();
+}
+
+void FrameSubscription::Release()
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    if (in_flight > 0)
+        --in_flight;
+    if (!queue.empty() || touched)
+        WakeLocked();
+}
+
+void FrameSubscription::ResetToKeyframe()
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!inter_frame)
+        return;
+    dropped += queue.size();
+    queue.clear();
+    wait_key = true;
+}
+
+void FrameSubscription::Cancel()
+{
+    std::function<void()> fn;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (cancelled)
+            return;
+        cancelled = true;
+        queue.clear();
+        // 唤醒一次让投递任务结束
+        WakeLocked();
+        waker = nullptr;
+        fn = std::move(on_cancel);
+    }
+    if (fn)
+        fn();
+}
+
+StepResult FrameSubscription::Step(DecodeTask &task)
+{
+    EncoderOutput out;
+    bool needPull = false;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (cancelled)
+            return StepResult::Done;
+        if (in_flight >= (latest_only ? 1 : kMaxQueued) || (queue.empty() && !touched))
+            return StepResult::Block;
+        auto now = DecodeTask::Clock::now();
+        if (now < next_at)
+        {
+            task.wake_at = next_at;
+            return StepResult::Sleep;
+        }
+        if (!queue.empty())
+        {
+            out = std::move(queue.front());
+            queue.pop_front();
+        }
+        else
+            needPull = true;
+        touched = false;
+        ++in_flight;
+        next_at = now + min_interval;
+    }
+    // 现场编码不持锁，期间的 Offer / Touch 照常记下
+    if (needPull && pull)
+        out = pull();
+    if (!out.success)
+    {
+        Release();
+        return StepResult::Yield;
+    }
+    ++delivered;
+    callback(std::move(out));
+    return StepResult::Yield;
+}
+
+void SubscriberList::Add(const std::shared_ptr<FrameSubscription> &sub)
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    subs.push_back(sub);
+    count = subs.size();
+}
+
+void SubscriberList::Offer(const EncoderOutput &out)
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    subs.erase(std::remove_if(subs.begin(), subs.end(), [](const std::shared_ptr<FrameSubscription> &s)
+                              { return s->Cancelled(); }),
+               subs.end());
+    count = subs.size();
+    for (auto &s : subs)
+        s->Offer(out);
+}
+
+void SubscriberList::Touch()
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    subs.erase(std::remove_if(subs.begin(), subs.end(), [](const std::shared_ptr<FrameSubscription> &s)
+                              { return s->Cancelled(); }),
+               subs.end());
+    count = subs.size();
+    for (auto &s : subs)
+        s->Touch();
+}
+
+void SubscriberList::ResetToKeyframe()
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    for (auto &s : subs)
+        s->ResetToKeyframe();
+}
+
+std::vector<int> SubscriberList::CancelAll()
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    std::vector<int> ids;
+    for (auto &s : subs)
+    {
+        if (!s->Cancelled())
+            ids.push_back(s->Id());
+        s->Cancel();
+    }
+    subs.clear();
+    count = 0;
+    return ids;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "Encoders.h"
+#include "DecodeExecutor.h"
+#include "BufferPool.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 推送订阅的选项
+struct SubscribeOptions
+{
+    bool latestOnly = true; // 只保留最新一帧：上一帧处理完 (Release) 才投递下一帧，期间的新帧互相覆盖；
+                            // 否则最多 kMaxQueued 帧已投递未 Release
+    double maxFps = 0;      // 投递频率上限，<=0 不限
+};
+
+/**
+ * 推送订阅：一路输出发布新帧后，由解码执行器上的投递任务回调，读者不必轮询
+ * 呈现任务只做 Offer / Touch（增加引用计数并唤醒），按需编码等耗时工作都在投递任务里完成
+ *      1. 帧内编码：latestOnly 时只留最新一帧；否则按顺序排队，最多 kMaxQueued 帧，溢出丢最旧的，
+ *         已投递未 Release 的也不超过 kMaxQueued 帧，回调方处理慢时积压留在这里按上面的规则丢弃
+ *      2. 帧间编码：不能丢帧，未投递的数据按顺序拼接，遇到关键帧丢弃之前的部分；新订阅从关键帧开始
+ *      3. maxFps：距上次投递不足间隔时任务睡到点再投，期间到达的帧按 1/2 的规则合并
+ *      4. 按需编码的主输出不发布编码结果，只标记有新画面，投递时经 pull 现场编码
+ * 回调在执行器线程上调用，须很快返回（如转交给 JS 线程）
+ */
+class FrameSubscription
+{
+public:
+    using Callback = std::function<void(EncoderOutput &&)>;
+    using Pull = std::function<EncoderOutput()>;
+
+    FrameSubscription(int id, Callback callback, const SubscribeOptions &options, bool interFrame, Pull pull = nullptr);
+
+    int Id() const { return _id; }
+    bool Cancelled() const { return cancelled; }
+
+    // 唤醒投递任务的方式（MediaManager 设置为解码执行器的 Wake），Cancel 后清空
+    void SetWaker(std::function<void()> waker);
+    // 订阅结束时调用一次（任意线程，不持锁），用于释放回调方的资源；已取消时立即调用
+    void SetOnCancel(std::function<void()> fn);
+    // 呈现任务调用：记下新发布的一帧（拷贝只增加引用计数）
+    void Offer(const EncoderOutput &out);
+    // 按需编码：有新画面，投递时再编码
+    void Touch();
+    // 回调方处理完一帧（每次回调对应一次），允许投递下一帧
+    void Release();
+    // 帧间编码：丢弃未投递的数据，直到下一个关键帧（输出中途漏帧时使用）
+    void ResetToKeyframe();
+    // 投递任务随之结束，之后的 Offer / Touch / Release 不再生效
+    void Cancel();
+
+    // 投递任务的单步
+    StepResult Step(DecodeTask &task);
+
+    std::shared_ptr<DecodeTask> task;
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> dropped{0}; // 被覆盖 / 溢出丢弃的帧
+
+private:
+    static constexpr size_t kMaxQueued = 8;
+
+    void WakeLocked();
+    // 帧间编码：把 next 接到 back 后面
+    void AppendLocked(EncoderOutput &back, const EncoderOutput &next);
+
+    int _id;
+    Callback callback;
+    Pull pull;
+    bool latest_only;
+    bool inter_frame;
+    DecodeTask::Clock::duration min_interval{0};
+
+    std::mutex mtx;
+    std::function<void()> waker;
+    std::function<void()> on_cancel;
+    std::deque<EncoderOutput> queue;
+    bool touched = false;
+    size_t in_flight = 0; // 已投递未 Release 的帧数
+    bool wait_key = true;
+    std::atomic<bool> cancelled{false};
+    DecodeTask::Clock::time_point next_at{};
+    BufferPool concat_pool;
+};
+
+// 一路输出（主输出或附加档位）上的推送订阅，已取消的在下一次投递时顺带清理
+class SubscriberList
+{
+public:
+    void Add(const std::shared_ptr<FrameSubscription> &sub);
+    bool Empty() const { return count == 0; }
+    void Offer(const EncoderOutput &out);
+    void Touch();
+    void ResetToKeyframe();
+    // 输出被删除：取消其上的全部订阅，返回被取消的订阅 id
+    std::vector<int> CancelAll();
+
+private:
+    std::mutex mtx;
+    std::vector<std::shared_ptr<FrameSubscription>> subs;
+    std::atomic<size_t> count{0};
+};
@@ -0,0 +1,119 @@
+#include "SourceContext.h"
+#include "SyncGroup.h"
+#include <algorithm>
+
+ReadyOutput::ReadyOutput(ReadyOutput &&o) noexcept
+    : ctx(std::move(o.ctx)), rendition(std::move(o.rendition)), out(std::move(o.out)), yuv(o.yuv), changed(o.changed), timestamp(o.timestamp)
+{
+    o.yuv = nullptr;
+}
+
+ReadyOutput::~ReadyOutput()
+{
+    av_frame_free(&yuv);
+}
+
+bool SourceContext::ReadyFullLocked() const
+{
+    if (ready.empty())
+        return false;
+    return ready.size() >= ready_max_frames || ready.back().pts_ms - ready.front().pts_ms >= ready_max_ms;
+}
+
+void SourceContext::ClearReady()
+{
+    std::lock_guard<std::mutex> lk(ready_mtx);
+    ready.clear();
+}
+
+void SourceContext::RequestSeek(double target)
+{
+    {
+        std::lock_guard<std::mutex> lk(seek_mtx);
+        seek_target = target;
+    }
+    seek_requested = true;
+}
+
+size_t SourceContext::Attach(const std::shared_ptr<StreamContext> &sub)
+{
+    std::lock_guard<std::mutex> lk(subs_mtx);
+    subscribers.push_back(sub);
+    return subscribers.size();
+}
+
+size_t SourceContext::Detach(const StreamContext *sub)
+{
+    std::lock_guard<std::mutex> lk(subs_mtx);
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                     [&](const std::weak_ptr<StreamContext> &w)
+                                     {
+                                         auto p = w.lock();
+                                         return !p || p.get() == sub;
+                                     }),
+                      subscribers.end());
+    return subscribers.size();
+}
+
+size_t SourceContext::SubscriberCount()
+{
+    std::lock_guard<std::mutex> lk(subs_mtx);
+    return subscribers.size();
+}
+
+bool SourceContext::HasActive()
+{
+    std::lock_guard<std::mutex> lk(subs_mtx);
+    for (auto &w : subscribers)
+    {
+        auto p = w.lock();
+        if (p && !p->is_paused)
+            return true;
+    }
+    return false;
+}
+
+bool SourceContext::Collect(std::vector<std::shared_ptr<StreamContext>> &out, bool activeOnly)
+{
+    out.clear();
+    std::lock_guard<std::mutex> lk(subs_mtx);
+    for (auto &w : subscribers)
+    {
+        auto p = w.lock();
+        if (p && (!activeOnly || !p->is_paused))
+            out.push_back(std::move(p));
+    }
+    return !out.empty();
+}
+
+std::shared_ptr<SyncGroup> SourceContext::Group()
+{
+    std::lock_guard<std::mutex> lk(group_mtx);
+    return group;
+}
+
+void SourceContext::SetGroup(std::shared_ptr<SyncGroup> g)
+{
+    std::lock_guard<std::mutex> lk(group_mtx);
+    group = std::move(g);
+}
+
+SourceContext::~SourceContext()
+{
+    stop_flag = true;
+    present_list.clear();
+    ready.clear();
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    av_packet_free(&jpeg_pkt);
+    if (dec_ctx)
+    {
+        avcodec_free_context(&dec_ctx);
+        dec_ctx = nullptr;
+    }
+    if (fmt_ctx)
+    {
+        avformat_close_input(&fmt_ctx);
+        fmt_ctx = nullptr;
+    }
+}
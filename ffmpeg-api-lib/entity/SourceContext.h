@@ -0,0 +1,140 @@
+#pragma once
+#include "StreamContext.h"
+#include "SyncClock.h"
+#include "PacketQueue.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+struct SyncGroup;
+
+// 预处理好、等待到点发布的一份输出（每个订阅者一份）
+struct ReadyOutput
+{
+    std::weak_ptr<StreamContext> ctx;
+    std::shared_ptr<Rendition> rendition; // 附加档位的输出，为空表示主输出
+    EncoderOutput out;      // 普通模式：编码结果
+    AVFrame *yuv = nullptr; // 按需编码模式：滤镜输出的引用，到点后交给 StashFrame
+    bool changed = true;
+    int64_t timestamp = 0;
+
+    ReadyOutput() = default;
+    ReadyOutput(ReadyOutput &&o) noexcept;
+    ReadyOutput &operator=(ReadyOutput &&o) = delete;
+    ~ReadyOutput();
+};
+
+// 呈现队列中的一帧：同一个解码帧对应各订阅者的输出
+struct ReadyFrame
+{
+    int64_t pts_ms = 0;
+    std::vector<ReadyOutput> outputs;
+};
+
+// 解码源：一个 URL + 时间范围只做一次解复用和解码，帧分发给所有订阅者
+struct SourceContext
+{
+    // 注册表键：url + 时间范围；私有源（seek 后脱离共享）为空串，不参与共享
+    std::string key;
+    std::string url;
+
+    // FFmpeg 原始上下文
+    AVFormatContext *fmt_ctx = nullptr;
+    AVCodecContext *dec_ctx = nullptr;
+    const AVCodec *decoder = nullptr;
+    int video_idx = -1;
+
+    // 降分辨率解码：输出远小于 ROI 时让解码器直接输出 1/2^n 尺寸 (MJPEG 为 DCT 域缩放)
+    // lowres 只由解码任务修改；lowres_wanted 由订阅者配置变化时更新，解码任务据此重开解码器
+    std::atomic<int> lowres{0};
+    std::atomic<int> lowres_wanted{0};
+
+    // 调度任务：解复用任务跑在 I/O 执行器上预读到 packets，解码任务从 packets 取包，
+    // 提前滤镜/编码后放入 ready，呈现任务按时钟到点发布
+    std::shared_ptr<DecodeTask> task;
+    std::shared_ptr<DecodeTask> demux_task;
+    std::shared_ptr<DecodeTask> pace_task;
+    std::atomic<bool> stop_flag{false};
+
+    // 解复用 -> 解码的有界包队列
+    PacketQueue packets;
+
+    // 静态资源控制
+    std::atomic<bool> is_static{false};
+    std::atomic<bool> static_decoded{false};
+
+    int64_t totalTime = 0;
+
+    // 呈现时钟：每个源各自一个，暂停 / seek / 循环互不影响
+    SyncClock clock;
+    std::atomic<int64_t> sync_drift{0}; // 相对同步组 master 的最近一次偏差（毫秒）
+
+    // 播放时间范围（秒），<=0 表示不限制
+    double startTime = 0.0;
+    double endTime = 0.0;
+
+    // 外部 seek 请求
+    std::atomic<bool> seek_requested{false};
+    double seek_target = 0.0;
+    std::mutex seek_mtx;
+
+    // 追帧：落后时让解码器少做事，0 正常 / 1 跳过非参考帧 / 2 只解关键帧并在送解码前丢包
+    std::atomic<int> drop_level{0};
+    std::atomic<uint64_t> dropped_packets{0}; // 送解码前丢弃的包
+    std::atomic<uint64_t> late_frames{0};     // 已解码但迟到的帧（帧间编码的输出仍会发布）
+    std::atomic<uint64_t> nonref_skips{0};    // 进入"跳过非参考帧"的次数
+    std::atomic<uint64_t> nonkey_skips{0};    // 进入"只解关键帧"的次数
+
+    // 解复用状态（只在解复用任务内访问）
+    AVPacket *pkt = nullptr;
+    bool demux_eof = false; // 已读到结尾并投递了 EOF 标记，等待 seek
+
+    // MJPEG 源：保留当前帧对应的包，供订阅者在压缩域直出（只在解码任务内访问）
+    bool is_mjpeg = false;
+    AVPacket *jpeg_pkt = nullptr;
+    // 所有订阅者都在压缩域直出时不再送解码器，帧只带时间戳和尺寸
+    std::atomic<bool> skip_decode{false};
+
+    // 预解码呈现队列：上限按帧数和时长计算，以下字段由 ready_mtx 保护
+    std::deque<ReadyFrame> ready;
+    std::mutex ready_mtx;
+    size_t ready_max_frames = 3;
+    int64_t ready_max_ms = 200;
+    bool decoder_waiting = false; // 解码任务因队列满而挂起
+    bool pacer_waiting = false;   // 呈现任务因队列空而挂起
+    std::atomic<uint64_t> ready_underruns{0}; // 呈现时队列为空（解码没跑在时钟前面）
+    std::vector<std::vector<ReadyOutput>> spare_outputs; // 已发布帧清空后的 outputs，解码任务取回复用
+
+    bool ReadyFullLocked() const;
+    void ClearReady();
+
+    // 跨 step 保留的解码状态（只在解码任务内访问）
+    AVFrame *frame = nullptr;
+    double frame_time = 0.0;
+    std::vector<std::shared_ptr<StreamContext>> present_list; // 本帧要投递的订阅者快照
+
+    void RequestSeek(double target);
+
+    // 订阅者管理，返回操作后的订阅者数量
+    size_t Attach(const std::shared_ptr<StreamContext> &sub);
+    size_t Detach(const StreamContext *sub);
+    size_t SubscriberCount();
+
+    // 是否存在未暂停的订阅者
+    bool HasActive();
+    // 取出订阅者快照（默认只取未暂停的），结果为空时返回 false
+    bool Collect(std::vector<std::shared_ptr<StreamContext>> &out, bool activeOnly = true);
+
+    // 所属同步组，未加入时为空
+    std::shared_ptr<SyncGroup> Group();
+    void SetGroup(std::shared_ptr<SyncGroup> g);
+
+    ~SourceContext();
+
+private:
+    std::shared_ptr<SyncGroup> group;
+    std::mutex group_mtx;
+
+    std::vector<std::weak_ptr<StreamContext>> subscribers;
+    std::mutex subs_mtx;
+};
@@ -1,16 +1,127 @@
 #include "StreamContext.h"
+#include <cstring>
 
-void FrameBuffer::Update(EncoderOutput &&newFrame)
+void FrameBuffer::Publish(EncoderOutput &&newFrame, bool changed)
 {
-    std::lock_guard<std::mutex> lock(mtx);
-    bufferB = std::move(newFrame);
-    std::swap(bufferA, bufferB);
+    if (sequential)
+    {
+        if (!newFrame.success)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(seq_mtx);
+            uint64_t next = seq + 1;
+            if (newFrame.keyframe)
+            {
+                // 关键帧之前未取走的帧已无意义
+                pending = std::move(newFrame);
+                wait_key = false;
+            }
+            else if (wait_key)
+                return;
+            else if (!pending.success)
+                pending = std::move(newFrame);
+            else
+            {
+                // 共享数据只读，拼成新的一块
+                size_t size = pending.data.size() + newFrame.data.size();
+                AVBufferRef *joined = concat_pool.Get(size);
+                if (!joined)
+                    return;
+                std::memcpy(joined->data, pending.data.data(), pending.data.size());
+                std::memcpy(joined->data + pending.data.size(), newFrame.data.data(), newFrame.data.size());
+                pending.data = SharedBuffer(joined, size);
+                pending.timestamp = newFrame.timestamp;
+            }
+            pending.seq = next;
+            seq = next;
+        }
+        NotifyWaiters();
+        return;
+    }
+    bool advanced = changed && newFrame.success;
+    {
+        std::lock_guard<std::mutex> lock(write_mtx);
+        // 先发布再推进序号：读者看到新序号时一定能取到这一帧
+        uint64_t next = advanced ? seq + 1 : seq.load();
+        newFrame.seq = next;
+        slots.Back() = std::move(newFrame);
+        slots.Publish();
+        seq = next;
+    }
+    if (advanced)
+        NotifyWaiters();
+}
+
+EncoderOutput FrameBuffer::Latest()
+{
+    if (sequential)
+    {
+        std::lock_guard<std::mutex> lock(seq_mtx);
+        EncoderOutput out = std::move(pending);
+        pending = {};
+        return out;
+    }
+    std::lock_guard<std::mutex> lock(read_mtx);
+    slots.Update();
+    return slots.Front(); // 返回拷贝给 Node.js，确保线程安全
+}
+
+void FrameBuffer::SetSequential(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(seq_mtx);
+    sequential = enabled;
+    pending = {};
+    wait_key = true;
+}
+
+void FrameBuffer::ResetToKeyframe()
+{
+    std::lock_guard<std::mutex> lock(seq_mtx);
+    pending = {};
+    wait_key = true;
+}
+
+uint64_t FrameBuffer::Advance()
+{
+    uint64_t next = ++seq;
+    NotifyWaiters();
+    return next;
+}
+
+void FrameBuffer::NotifyWaiters()
+{
+    // 等待者先登记再检查序号，与这里先推进序号再检查登记构成配对，不会漏掉唤醒
+    if (waiters == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lk(wait_mtx);
+    }
+    wait_cv.notify_all();
+}
+
+bool FrameBuffer::WaitNewer(uint64_t lastSeq, std::chrono::milliseconds timeout)
+{
+    if (seq != lastSeq)
+        return true;
+    ++waiters;
+    bool fresh;
+    {
+        std::unique_lock<std::mutex> lk(wait_mtx);
+        wait_cv.wait_for(lk, timeout, [&]
+                         { return seq != lastSeq || closed; });
+        fresh = seq != lastSeq;
+    }
+    --waiters;
+    return fresh;
 }
 
-EncoderOutput FrameBuffer::Get()
+void FrameBuffer::Close()
 {
-    std::lock_guard<std::mutex> lock(mtx);
-    return bufferA; // 返回拷贝给 Node.js，确保线程安全
+    {
+        std::lock_guard<std::mutex> lk(wait_mtx);
+        closed = true;
+    }
+    wait_cv.notify_all();
 }
 
 void StreamContext::ReleaseFilter()
@@ -24,22 +135,100 @@ void StreamContext::ReleaseFilter()
     }
 }
 
-StreamContext::~StreamContext()
+bool StreamContext::FilterMatches(const AVFrame *in) const
 {
-    stop_flag = true;
-    if (worker.joinable())
-        worker.join();
-    ReleaseFilter();
-    if (dec_ctx)
+    return filter_graph && in->width == filter_in_w && in->height == filter_in_h && in->format == filter_in_fmt;
+}
+
+void StreamContext::StashFrame(AVFrame *yuv, int64_t timestamp, bool changed)
+{
+    std::lock_guard<std::mutex> lk(lazy_mtx);
+    lazy_time = timestamp;
+    if (!changed)
     {
-        avcodec_free_context(&dec_ctx);
-        dec_ctx = nullptr;
+        av_frame_unref(yuv);
+        ++skipped_frames;
+        return;
     }
-    if (fmt_ctx)
+    av_frame_unref(lazy_frame);
+    av_frame_move_ref(lazy_frame, yuv);
+    // 与 Publish 共用序号，切换按需编码前后读者看到的序号保持递增
+    lazy_seq = frame_buffer.Advance();
+}
+
+EncoderOutput StreamContext::EncodeLatest()
+{
+    // 先读配置再取 encode_mtx，与解码任务的 config_mtx -> encode_mtx 顺序一致
+    int quality;
     {
-        avformat_close_input(&fmt_ctx);
-        fmt_ctx = nullptr;
+        std::lock_guard<std::mutex> lk(config_mtx);
+        quality = config.quality;
     }
+    std::lock_guard<std::mutex> enc_lk(encode_mtx);
+    bool fresh = false;
+    int64_t timestamp = 0;
+    {
+        std::lock_guard<std::mutex> lk(lazy_mtx);
+        timestamp = lazy_time;
+        if (lazy_seq != lazy_encoded_seq)
+        {
+            av_frame_unref(lazy_work);
+            av_frame_move_ref(lazy_work, lazy_frame);
+            lazy_encoded_seq = lazy_seq;
+            fresh = true;
+        }
+    }
+    if (!fresh)
+    {
+        // 帧间编码的结果不能重复交给解码端
+        if (inter_frame)
+            return {};
+        // 画面未变化的帧只推进时间戳
+        if (lazy_out.success)
+            lazy_out.timestamp = timestamp;
+        return lazy_out;
+    }
+
+    // 以帧的实际尺寸为准，避免配置刚变更时新旧尺寸错配
+    bool rateControl = rate.Enabled();
+    if (rateControl)
+        quality = rate.NextQuality(quality);
+    encoder->Reset(lazy_work->width, lazy_work->height, quality);
+    EncoderOutput out;
+    encoder->Encode(lazy_work, out);
+    out.timestamp = timestamp;
+    out.seq = lazy_encoded_seq;
+    if (rateControl && out.success)
+        rate.Update(out.data.size(), timestamp);
+    av_frame_unref(lazy_work);
+    ++encoded_frames;
+    if (inter_frame)
+        return out;
+    if (out.success)
+        lazy_out = std::move(out);
+    return lazy_out;
+}
+
+std::shared_ptr<Rendition> StreamContext::FindRendition(int id)
+{
+    std::lock_guard<std::mutex> lk(rendition_mtx);
+    for (auto &r : renditions)
+        if (r->id == id)
+            return r;
+    return nullptr;
+}
+
+Rendition::~Rendition()
+{
+    av_frame_free(&frame);
+}
+
+StreamContext::~StreamContext()
+{
+    ReleaseFilter();
+    av_frame_free(&yuvFrame);
+    av_frame_free(&lazy_frame);
+    av_frame_free(&lazy_work);
 }
 
 ROIConfig::ROIConfig() : srcX(0), srcY(0), srcW(0), srcH(0), outW(0), outH(0), quality(8)
@@ -1,8 +1,15 @@
 #pragma once
 #include "Encoders.h"
-#include <thread>
+#include "DecodeExecutor.h"
+#include "TripleBuffer.h"
+#include "SceneDetector.h"
+#include "FrameScaler.h"
+#include "JpegTranscoder.h"
+#include "RateController.h"
+#include "FrameSubscription.h"
 #include <mutex>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 
 extern "C"
@@ -23,38 +30,133 @@ struct ROIConfig
     ROIConfig(int x, int y, int sw, int sh, int ow, int oh, int q = 8);
 };
 
+// 解码任务与 GetNextFrame 之间的帧交接：解码侧永不等待，读者之间才需串行
 struct FrameBuffer
 {
-    EncoderOutput bufferA; // 供外部读取 (Latest)
-    EncoderOutput bufferB; // 供内部写入 (Working)
-    std::mutex mtx;
+    // 呈现任务调用：写入并发布最新帧；changed 为 false（静态画面复用上一帧）时不推进序号
+    void Publish(EncoderOutput &&newFrame, bool changed = true);
+
+    // 读者调用：取最新帧（拷贝给 Node.js）
+    EncoderOutput Latest();
+
+    // 帧间编码的输出不能只留最新一帧：顺序模式下累积读者尚未取走的帧，
+    // Latest 一次取走全部（拼接后的裸流），没有新数据时返回空；遇到关键帧丢弃之前未取走的部分
+    // 顺序模式假定每路输出只有一个读者
+    void SetSequential(bool enabled);
+    // 丢弃未取走的数据，直到下一个关键帧（新读者加入 / 读者跟丢时使用）
+    void ResetToKeyframe();
+
+    // 最新发布的序号，读者据此判断有无新帧而不必取帧
+    uint64_t Seq() const { return seq; }
+    // 按需编码：画面有更新但尚未编码，只推进序号并唤醒等待者
+    uint64_t Advance();
+    // 阻塞到序号不同于 lastSeq，超时或 Close 后返回 false
+    bool WaitNewer(uint64_t lastSeq, std::chrono::milliseconds timeout);
+    // 输出被删除：唤醒全部等待者，之后的 WaitNewer 立即返回
+    void Close();
+
+private:
+    void NotifyWaiters();
+
+    TripleBuffer<EncoderOutput> slots;
+    std::mutex read_mtx;  // 只在多个读者之间串行，不与呈现任务竞争
+    std::mutex write_mtx; // 订阅者迁移源时新旧两个呈现任务可能同时发布，平时无竞争
+
+    std::atomic<bool> sequential{false};
+    std::mutex seq_mtx; // 顺序模式下读写都只交换 pending，持锁时间很短
+    EncoderOutput pending;
+    bool wait_key = true;
+    BufferPool concat_pool; // 顺序模式拼接未取走的帧
+
+    // 写者之间已由 write_mtx / seq_mtx 串行，读者只读
+    std::atomic<uint64_t> seq{0};
+    // 等待新帧：没有等待者时发布不碰 wait_mtx
+    std::atomic<int> waiters{0};
+    std::mutex wait_mtx;
+    std::condition_variable wait_cv;
+    bool closed = false; // wait_mtx 保护
+};
+
+// 单路流的运行统计，供调参使用
+struct StreamStats
+{
+    bool valid = false;
+    uint64_t encodedFrames = 0; // 实际编码的帧数
+    uint64_t skippedFrames = 0; // 静态画面检测跳过编码的帧数
+
+    // 以下来自所属解码源（共享源的订阅者看到相同的值）
+    int dropLevel = 0;           // 0 正常 / 1 跳过非参考帧 / 2 只解关键帧
+    uint64_t droppedPackets = 0; // 送解码前丢弃的包
+    uint64_t lateFrames = 0;     // 解码后迟到的帧，帧内编码的输出被丢弃
+    uint64_t nonRefSkips = 0;    // 进入"跳过非参考帧"的次数
+    uint64_t nonKeySkips = 0;    // 进入"只解关键帧"的次数
+    int64_t syncDriftMs = 0;     // 相对同步组 master 的偏差，未加入同步组时为 0
+    int decodeLowres = 0;        // 降分辨率解码级别：0 原始尺寸，n 表示 1/2^n
+    size_t renditions = 0;              // 附加输出档位数（不含主输出）
+    uint64_t renditionEncodedFrames = 0; // 附加档位合计编码的帧数
+    RateStats rate;              // 码率控制状态
+    int jpegMode = 0;            // MJPEG 压缩域直出：0 关闭 / 1 透传 / 2 无损裁剪
+    uint64_t jpegFrames = 0;     // 压缩域直出的帧数（不经过解码和编码）
+    // 帧同步定时唤醒的抖动：分桶计数（上界见 JitterHistogram::kUpperUs）与最大值
+    std::array<uint64_t, JitterHistogram::kBuckets> wakeJitter{};
+    int64_t wakeJitterMaxUs = 0;
+    // 解复用预读队列的当前水位与上限
+    size_t demuxQueueBytes = 0;
+    int64_t demuxQueueMs = 0;
+    size_t demuxQueuePackets = 0;
+    size_t demuxMaxBytes = 0;
+    int64_t demuxMaxMs = 0;
+    uint64_t demuxUnderruns = 0; // 解码时队列为空的次数（I/O 没跟上）
+    uint64_t demuxStalls = 0;    // 预读因队列满而暂停的次数
+    // 预解码呈现队列
+    size_t presentQueueFrames = 0;
+    size_t presentMaxFrames = 0;
+    int64_t presentMaxMs = 0;
+    uint64_t presentUnderruns = 0; // 到点时队列为空的次数（解码没跑在时钟前面）
+};
+
+struct SourceContext;
 
-    void Update(EncoderOutput &&newFrame);
+// 附加输出档位：同一 ROI 的另一种尺寸 / 质量，由更大一档的输出级联缩小得到，不再单独裁剪
+struct Rendition
+{
+    int id = 0; // >0，0 表示订阅者的主输出
+    int outW = 0, outH = 0;
+    int quality = 8;
+    std::unique_ptr<IEncoder> encoder;
+    bool inter_frame = false; // 帧间编码：输出走顺序模式，画面未变化时不产出
+    FrameBuffer frame_buffer;
+    SubscriberList subscribers; // 推送订阅
+    std::atomic<uint64_t> encoded_frames{0};
 
-    EncoderOutput Get();
+    // 以下由所属订阅者的 present_mtx 保护
+    FrameScaler scaler;
+    FramePool frame_pool;
+    AVFrame *frame = nullptr; // 本档的缩小结果，也是下一档的输入
+    EncoderOutput last_out;   // 静态画面检测开启时复用
+
+    ~Rendition();
 };
 
+// MJPEG 源 + MJPEG 输出且不需要缩放时，直接在码流上产出结果
+enum class JpegMode
+{
+    None,
+    Passthrough, // ROI 为整帧：源包原样输出
+    Crop         // ROI 起点对齐 MCU：DCT 域无损裁剪
+};
+
+// 订阅者：同一个源可被多个 deviceId/indexCode 订阅，各自拥有独立的 ROI、滤镜与编码器
 struct StreamContext
 {
-    // FFmpeg 原始上下文
-    AVFormatContext *fmt_ctx = nullptr;
-    AVCodecContext *dec_ctx = nullptr;
-    int video_idx = -1;
-    // int64_t pts_offset = 0;
-    // int64_t last_pts = 0;
-
-    // 状态与线程
+    // 所属的解码源（由 MediaManager 在 map_mtx 下维护）
+    std::shared_ptr<SourceContext> source;
+
+    // 状态
     std::unique_ptr<IEncoder> encoder;
+    bool inter_frame = false; // 帧间编码：输出走顺序模式，画面未变化时不产出
     FrameBuffer frame_buffer;
-
-    // 事件通知核心
-    std::mutex sync_mtx;
-    std::condition_variable cv_decode; // 用于通知解码线程：B 帧已空，可以继续
-    std::atomic<bool> b_frame_busy{false}; // B 帧占用标志
-    
-    // 静态资源控制
-    std::atomic<bool> is_static{false};
-    std::atomic<bool> static_decoded{false};
+    SubscriberList subscribers; // 主输出的推送订阅
 
     // 动态配置锁
     ROIConfig config;
@@ -62,31 +164,77 @@ struct StreamContext
     std::atomic<bool> filter_changed{false};
     std::atomic<bool> encoder_changed{false};
 
-    std::atomic<bool> stop_flag{false};
-    std::thread worker;
-
-    int64_t totalTime;
-
-    // 播放时间范围（秒），<=0 表示不限制
-    double startTime = 0.0;
-    double endTime = 0.0;
-
-    // 外部 seek 请求
-    std::atomic<bool> seek_requested{false};
-    double seek_target = 0.0;
-    std::mutex seek_mtx;
-
-    // 暂停控制
+    // 暂停控制：暂停的订阅者不再接收新帧，所有订阅者都暂停时源任务挂起
     std::atomic<bool> is_paused{false};
-    std::mutex pause_mtx;
-    std::condition_variable cv_pause;
+
+    // 滤镜 -> 编码 -> 发布 的串行锁（订阅者迁移源时可能短暂被两个源任务同时投递）
+    std::mutex present_mtx;
+    AVFrame *yuvFrame = nullptr;
+    ROIConfig cur_cfg;
+
+    // 静态画面检测：阈值 <0 关闭；画面未变化时复用 last_out，只更新时间戳
+    std::atomic<int> scene_threshold{-1};
+    SceneDetector scene_detector;   // 以下两个由 present_mtx 保护
+    EncoderOutput last_out;
+
+    // 统计
+    std::atomic<uint64_t> encoded_frames{0};
+    std::atomic<uint64_t> skipped_frames{0};
+
+    // 编码器在解码任务与按需编码的读者之间共享，锁顺序：present_mtx -> config_mtx -> encode_mtx
+    std::mutex encode_mtx;
+    // 单帧并行编码的线程数，同时作用于附加档位
+    std::atomic<int> encoder_threads{1};
+    // 字节预算码率控制：开启后每帧编码前由它给出 qscale（只作用于主输出，encode_mtx 下使用）
+    RateController rate;
+
+    // 按需编码：解码任务只保留最新一帧 YUV，由 GetNextFrame 触发编码并缓存结果
+    std::atomic<bool> encode_on_demand{false};
+    std::mutex lazy_mtx;           // 只保护下面三个字段，持锁时间仅为一次引用交换
+    AVFrame *lazy_frame = nullptr; // 最新的滤镜输出
+    int64_t lazy_time = 0;
+    uint64_t lazy_seq = 0;         // 最新 YUV 对应的发布序号
+    AVFrame *lazy_work = nullptr;  // 以下由 encode_mtx 保护
+    uint64_t lazy_encoded_seq = 0;
+    EncoderOutput lazy_out;        // 已编码的最新帧，直到有更新的 YUV 才重新编码
+
+    // 呈现任务调用：替换最新的 YUV 帧（接管 yuv 的引用）；画面未变化时只更新时间戳
+    void StashFrame(AVFrame *yuv, int64_t timestamp, bool changed);
+    // 读者调用：有新 YUV 则编码，否则直接返回缓存结果
+    EncoderOutput EncodeLatest();
+
+    // 裁剪缩放：常规格式走原生 FrameScaler，其余回退到滤镜链（均由 present_mtx 保护）
+    FrameScaler scaler;
+    FramePool frame_pool; // 原生缩放输出的缓冲
+    bool native_scale = false;
+    int cur_lowres = 0; // 当前裁剪参数对应的解码缩小级别
+
+    // 附加输出档位：按面积从大到小排列，第一档由主输出缩小，其后每档由上一档缩小
+    // 增删同时持有 present_mtx 与 rendition_mtx：解码任务在 present_mtx 下遍历，读者在 rendition_mtx 下查找
+    std::vector<std::shared_ptr<Rendition>> renditions;
+    std::mutex rendition_mtx;
+    int next_rendition = 1;
+    std::shared_ptr<Rendition> FindRendition(int id);
+
+    // 压缩域直出：模式由 MediaManager 在配置变化时（map_mtx 下）重新判定，
+    // 解码任务处理失败时退回 None；jpeg 由 present_mtx 保护
+    std::atomic<JpegMode> jpeg_mode{JpegMode::None};
+    JpegTranscoder jpeg;
+    std::vector<uint8_t> jpeg_out; // 直出结果的暂存，拷入 jpeg_pool 后复用
+    BufferPool jpeg_pool;
+    std::atomic<uint64_t> jpeg_frames{0};
 
     // Filter
     AVFilterGraph* filter_graph = nullptr;
     AVFilterContext* buffersrc_ctx = nullptr;
     AVFilterContext* buffersink_ctx = nullptr;
+    // 滤镜链按此输入建立；seek / 循环后输入不变就继续沿用
+    int filter_in_w = 0;
+    int filter_in_h = 0;
+    int filter_in_fmt = -1;
 
     void ReleaseFilter();
+    bool FilterMatches(const AVFrame *in) const;
 
     ~StreamContext();
 };
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "SyncGroup.h"
+#include "SourceContext.h"
+#include <algorithm>
+
+size_t SyncGroup::Join(const std::shared_ptr<SourceContext> &src)
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    members.erase(std::remove_if(members.begin(), members.end(),
+                                 [&](const std::weak_ptr<SourceContext> &w)
+                                 {
+                                     auto p = w.lock();
+                                     return !p || p == src;
+                                 }),
+                  members.end());
+    members.push_back(src);
+    return members.size();
+}
+
+size_t SyncGroup::Leave(const SourceContext *src)
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    members.erase(std::remove_if(members.begin(), members.end(),
+                                 [&](const std::weak_ptr<SourceContext> &w)
+                                 {
+                                     auto p = w.lock();
+                                     return !p || p.get() == src;
+                                 }),
+                  members.end());
+    return members.size();
+}
+
+void SyncGroup::Collect(std::vector<std::shared_ptr<SourceContext>> &out)
+{
+    out.clear();
+    std::lock_guard<std::mutex> lk(mtx);
+    for (auto &w : members)
+        if (auto p = w.lock())
+            out.push_back(std::move(p));
+}
+
+bool SyncGroup::AnyActive()
+{
+    std::vector<std::shared_ptr<SourceContext>> live;
+    Collect(live);
+    for (auto &src : live)
+        if (src->HasActive())
+            return true;
+    return false;
+}
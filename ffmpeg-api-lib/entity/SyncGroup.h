@@ -0,0 +1,28 @@
+#pragma once
+#include "SyncClock.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct SourceContext;
+
+// 同步组：组内各解码源的时钟逐帧向 master 校正，seek / 循环对整组生效
+// 典型场景：同一事件的多路画面拼成的电视墙
+struct SyncGroup
+{
+    std::string id;
+    SyncClock master;
+
+    // 成员管理，返回操作后的成员数量（顺带清理已释放的源）
+    size_t Join(const std::shared_ptr<SourceContext> &src);
+    size_t Leave(const SourceContext *src);
+    // 取出仍存活的成员
+    void Collect(std::vector<std::shared_ptr<SourceContext>> &out);
+    // 是否还有成员存在未暂停的订阅者
+    bool AnyActive();
+
+private:
+    std::vector<std::weak_ptr<SourceContext>> members;
+    std::mutex mtx;
+};
@@ -1,44 +1,194 @@
 #include "MediaManager.h"
 #include <spdlog/spdlog.h>
 #include <magic_enum/magic_enum.hpp>
+#include <algorithm>
+#include <cstdlib>
 
-MediaManager::MediaManager() : sync_clock_()
+namespace
 {
+    // 追帧阈值（毫秒）：落后超过 kLagNonRefMs 跳过非参考帧，超过 kLagNonKeyMs 只解关键帧
+    // 回落到 kLagNonRefMs 以内降一级，回落到 AllowOffestTime 以内恢复完整解码
+    constexpr int64_t kLagNonRefMs = 120;
+    constexpr int64_t kLagNonKeyMs = 500;
+    // 同步组内成员循环时，master 已在此窗口内跳回过则视为整组已回绕，不再重复
+    constexpr int64_t kGroupLoopWindowMs = 1000;
+
+    // 呈现线程数：只做到点发布，不做编码，不会被大帧拖住
+    constexpr unsigned kPaceThreads = 1;
+
+    // 解复用线程数：读取可能阻塞在网络上，按核数的两倍给足
+    unsigned IoThreadCount()
+    {
+        return std::max(4u, 2 * std::thread::hardware_concurrency());
+    }
+
+    // 单个订阅者允许的降分辨率级别：缩小后的 ROI 仍不小于输出尺寸
+    int LowresFor(const ROIConfig &cfg, int maxLowres)
+    {
+        int level = 0;
+        while (level < maxLowres && (cfg.srcW >> (level + 1)) >= cfg.outW && (cfg.srcH >> (level + 1)) >= cfg.outH)
+            ++level;
+        return level;
+    }
+
+    // 把 ROI 映射到 1/2^lowres 的解码坐标系，并夹到帧内
+    ROIConfig ScaleROI(const ROIConfig &cfg, int lowres, int frameW, int frameH)
+    {
+        if (lowres == 0)
+            return cfg;
+        ROIConfig roi = cfg;
+        int round = (1 << lowres) - 1;
+        roi.srcX = std::min(cfg.srcX >> lowres, frameW - 1);
+        roi.srcY = std::min(cfg.srcY >> lowres, frameH - 1);
+        roi.srcW = std::min((cfg.srcW + round) >> lowres, frameW - roi.srcX);
+        roi.srcH = std::min((cfg.srcH + round) >> lowres, frameH - roi.srcY);
+        return roi;
+    }
+
+    // 停止时打断阻塞中的 av_read_frame / avformat_open_input
+    int InterruptCallback(void *opaque)
+    {
+        return static_cast<SourceContext *>(opaque)->stop_flag ? 1 : 0;
+    }
 }
 
-bool MediaManager::AddMedia(const std::string &deviceId, int indexCode, const std::string &url, const ROIConfig &config, std::unique_ptr<IEncoder> encoder, double startTime, double endTime)
+MediaManager::MediaManager() : scheduler_(std::make_unique<PresentScheduler>(&DecodeExecutor::Fire)),
+                               executor_(std::make_unique<DecodeExecutor>(0, scheduler_.get())),
+                               io_executor_(std::make_unique<DecodeExecutor>(IoThreadCount())),
+                               pace_executor_(std::make_unique<DecodeExecutor>(kPaceThreads, scheduler_.get()))
 {
-    auto key = MakeKey(deviceId, indexCode);
-    auto ctx = std::make_shared<StreamContext>();
+    spdlog::info("DecodeExecutor started with {} worker threads, {} I/O threads",
+                 executor_->ThreadCount(), io_executor_->ThreadCount());
+}
 
-    if (avformat_open_input(&ctx->fmt_ctx, url.c_str(), nullptr, nullptr) < 0)
-        return false;
-    if (avformat_find_stream_info(ctx->fmt_ctx, nullptr) < 0)
-        return false;
+MediaManager::~MediaManager()
+{
+    {
+        std::lock_guard<std::mutex> lock(map_mtx);
+        for (auto &[id, sub] : subscriptions)
+            sub->Cancel();
+        subscriptions.clear();
+    }
+    // 几类任务会互相唤醒，先把所有线程都停掉再析构
+    executor_->Shutdown();
+    io_executor_->Shutdown();
+    pace_executor_->Shutdown();
+    // 调度线程可能还在回调执行器，执行器析构前先停掉
+    scheduler_.reset();
+}
+
+std::shared_ptr<SourceContext> MediaManager::OpenSource(const std::string &url, double startTime, double endTime, const ROIConfig &config)
+{
+    auto src = std::make_shared<SourceContext>();
+    src->url = url;
+
+    src->fmt_ctx = avformat_alloc_context();
+    src->fmt_ctx->interrupt_callback.callback = InterruptCallback;
+    src->fmt_ctx->interrupt_callback.opaque = src.get();
+    if (avformat_open_input(&src->fmt_ctx, url.c_str(), nullptr, nullptr) < 0)
+        return nullptr;
+    if (avformat_find_stream_info(src->fmt_ctx, nullptr) < 0)
+        return nullptr;
 
     const AVCodec *decoder = nullptr;
-    ctx->video_idx = av_find_best_stream(ctx->fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
-    if (ctx->video_idx < 0)
-        return false;
+    src->video_idx = av_find_best_stream(src->fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+    if (src->video_idx < 0)
+        return nullptr;
 
-    auto v_stream = ctx->fmt_ctx->streams[ctx->video_idx];
+    auto v_stream = src->fmt_ctx->streams[src->video_idx];
 
-    bool durationIsZero = (ctx->fmt_ctx->duration <= 0 || ctx->fmt_ctx->duration == AV_NOPTS_VALUE);
+    bool durationIsZero = (src->fmt_ctx->duration <= 0 || src->fmt_ctx->duration == AV_NOPTS_VALUE);
     // - 明确标注只有 1 帧
     bool frameCountIsOne = (v_stream->nb_frames == 1);
     // - 或者是 image2 这种图片序列解复用器（通常用于处理 .jpg, .png 等）
-    std::string formatName = ctx->fmt_ctx->iformat->name;
+    std::string formatName = src->fmt_ctx->iformat->name;
     bool isImageFormat = (formatName.find("image2") != std::string::npos || formatName.find("mjpeg") != std::string::npos);
 
     if (durationIsZero || frameCountIsOne || isImageFormat)
     {
-        ctx->is_static = true;
+        src->is_static = true;
         spdlog::info("[{}] Identified as STATIC image (Format: {}, Frames: {})",
-                     deviceId, formatName, v_stream->nb_frames);
+                     url, formatName, v_stream->nb_frames);
     }
 
-    int rawW = v_stream->codecpar->width;
-    int rawH = v_stream->codecpar->height;
+    src->decoder = decoder;
+    src->dec_ctx = avcodec_alloc_context3(decoder);
+    avcodec_parameters_to_context(src->dec_ctx, v_stream->codecpar);
+    // 输出远小于 ROI 时直接以缩小的分辨率解码（解码器支持 lowres 时）
+    src->lowres = LowresFor(config, decoder->max_lowres);
+    src->lowres_wanted = src->lowres.load();
+    src->dec_ctx->lowres = src->lowres;
+    if (avcodec_open2(src->dec_ctx, decoder, nullptr) < 0)
+        return nullptr;
+    if (src->lowres > 0)
+        spdlog::info("[{}] Decoding at 1/{} resolution", url, 1 << src->lowres);
+
+    // 存储播放时间范围
+    src->startTime = startTime;
+    src->endTime = endTime;
+
+    // 如果指定了 startTime，先 seek 到起始位置
+    if (startTime > 0) {
+        int64_t seekTarget = static_cast<int64_t>(startTime * AV_TIME_BASE);
+        avformat_seek_file(src->fmt_ctx, -1, INT64_MIN, seekTarget, seekTarget, 0);
+        avcodec_flush_buffers(src->dec_ctx);
+    }
+
+    src->frame = av_frame_alloc();
+    src->is_mjpeg = v_stream->codecpar->codec_id == AV_CODEC_ID_MJPEG;
+    if (src->is_mjpeg)
+        src->jpeg_pkt = av_packet_alloc();
+    src->totalTime = src->fmt_ctx->duration;
+    src->packets.SetTimeBase(v_stream->time_base);
+
+    // 任务只持有弱引用：最后一个订阅者离开后源即可释放，任务随之结束
+    std::weak_ptr<SourceContext> weak = src;
+    src->task = std::make_shared<DecodeTask>([this, weak](DecodeTask &)
+                                             {
+        auto self = weak.lock();
+        if (!self)
+            return StepResult::Done;
+        return DecodeStep(self); });
+    src->pace_task = std::make_shared<DecodeTask>([this, weak](DecodeTask &task)
+                                                  {
+        auto self = weak.lock();
+        if (!self)
+            return StepResult::Done;
+        return PaceStep(self, task); });
+    src->demux_task = std::make_shared<DecodeTask>([this, weak](DecodeTask &)
+                                                   {
+        auto self = weak.lock();
+        if (!self)
+            return StepResult::Done;
+        return DemuxStep(self); });
+    return src;
+}
+
+bool MediaManager::AddMedia(const std::string &deviceId, int indexCode, const std::string &url, const ROIConfig &config, std::unique_ptr<IEncoder> encoder, double startTime, double endTime)
+{
+    auto key = MakeKey(deviceId, indexCode);
+    auto srcKey = MakeSourceKey(url, startTime, endTime);
+
+    // 1. 优先复用已注册的源，否则新开一个（打开过程可能较慢，不持锁）
+    std::shared_ptr<SourceContext> src;
+    {
+        std::lock_guard<std::mutex> lock(map_mtx);
+        auto it = sources.find(srcKey);
+        if (it != sources.end())
+            src = it->second.lock();
+    }
+    bool created = false;
+    if (!src || src->stop_flag)
+    {
+        src = OpenSource(url, startTime, endTime, config);
+        if (!src)
+            return false;
+        created = true;
+    }
+
+    auto codecpar = src->fmt_ctx->streams[src->video_idx]->codecpar;
+    int rawW = codecpar->width;
+    int rawH = codecpar->height;
 
     if (config.srcX + config.srcW > rawW || config.srcY + config.srcH > rawH)
     {
@@ -47,36 +197,219 @@ bool MediaManager::AddMedia(const std::string &deviceId, int indexCode, const st
         return false;
     }
 
-    ctx->dec_ctx = avcodec_alloc_context3(decoder);
-    avcodec_parameters_to_context(ctx->dec_ctx, ctx->fmt_ctx->streams[ctx->video_idx]->codecpar);
-    if (avcodec_open2(ctx->dec_ctx, decoder, nullptr) < 0)
-        return false;
-
-    // 4. 配置编码器
+    // 2. 配置订阅者自己的编码器
+    auto ctx = std::make_shared<StreamContext>();
     ctx->config = config;
     ctx->encoder = std::move(encoder);
     if (!ctx->encoder->Open(config.outW, config.outH, config.quality))
         return false;
+    ctx->inter_frame = !ctx->encoder->IntraOnly();
+    if (ctx->inter_frame)
+        ctx->frame_buffer.SetSequential(true);
 
-    // 存储播放时间范围
-    ctx->startTime = startTime;
-    ctx->endTime = endTime;
+    // 缓冲在每帧取用时才有：原生缩放从帧池取，滤镜链由 buffersink 给出引用
+    ctx->yuvFrame = av_frame_alloc();
+    ctx->cur_cfg = config;
+    ctx->lazy_frame = av_frame_alloc();
+    ctx->lazy_work = av_frame_alloc();
 
-    // 如果指定了 startTime，先 seek 到起始位置
-    if (startTime > 0) {
-        int64_t seekTarget = static_cast<int64_t>(startTime * AV_TIME_BASE);
-        avformat_seek_file(ctx->fmt_ctx, -1, INT64_MIN, seekTarget, seekTarget, 0);
-        avcodec_flush_buffers(ctx->dec_ctx);
+    // 3. 注册并挂到源上
+    {
+        std::lock_guard<std::mutex> lock(map_mtx);
+        if (created)
+        {
+            // 并发 AddMedia 可能已抢先注册了同一个源，以先注册的为准
+            auto it = sources.find(srcKey);
+            auto existing = it != sources.end() ? it->second.lock() : nullptr;
+            if (existing && !existing->stop_flag)
+            {
+                src = existing;
+                created = false;
+            }
+            else
+            {
+                src->key = srcKey;
+                sources[srcKey] = src;
+            }
+        }
+
+        auto old = contexts.find(key);
+        if (old != contexts.end())
+            RetireLocked(old->second);
+
+        ctx->source = src;
+        contexts[key] = ctx;
+        size_t subs = src->Attach(ctx);
+        // 共享源的新订阅者可能需要更高的解码分辨率
+        UpdateLowresLocked(src);
+        UpdateJpegModeLocked(ctx);
+
+        // 静态图片只解码一次：新订阅者加入时重新解码一遍，让它也能拿到画面
+        if (!created && src->is_static)
+        {
+            src->RequestSeek(src->startTime > 0 ? src->startTime : 0.0);
+            src->static_decoded = false;
+        }
+        if (!created)
+            spdlog::info("[{}] Attached to shared source {} ({} subscribers)", key, srcKey, subs);
     }
 
-    ctx->worker = std::thread(&MediaManager::DecodingLoop, this, ctx);
-    ctx->totalTime = ctx->fmt_ctx->duration;
-    this->sync_clock_.resetToTime(startTime > 0 ? startTime : 0.0);
-    std::lock_guard<std::mutex> lock(map_mtx);
-    contexts[key] = ctx;
+    if (created)
+    {
+        src->clock.resetToTime(startTime > 0 ? startTime : 0.0);
+        io_executor_->Wake(src->demux_task);
+    }
+    executor_->Wake(src->task);
+    pace_executor_->Wake(src->pace_task);
     return true;
 }
 
+void MediaManager::RetireLocked(const std::shared_ptr<StreamContext> &ctx)
+{
+    CloseOutputLocked(ctx->subscribers, ctx->frame_buffer);
+    {
+        std::lock_guard<std::mutex> lk(ctx->rendition_mtx);
+        for (auto &r : ctx->renditions)
+            CloseOutputLocked(r->subscribers, r->frame_buffer);
+    }
+    DetachLocked(ctx);
+}
+
+void MediaManager::CloseOutputLocked(SubscriberList &subs, FrameBuffer &buffer)
+{
+    for (int id : subs.CancelAll())
+        subscriptions.erase(id);
+    buffer.Close();
+}
+
+void MediaManager::DetachLocked(const std::shared_ptr<StreamContext> &ctx)
+{
+    auto src = ctx->source;
+    if (!src)
+        return;
+    if (src->Detach(ctx.get()) > 0)
+    {
+        // 剩下的订阅者可能允许更低的解码分辨率
+        UpdateLowresLocked(src);
+        return;
+    }
+
+    // 最后一个订阅者离开：注销并停止源
+    src->stop_flag = true;
+    LeaveGroupLocked(src);
+    io_executor_->Wake(src->demux_task);
+    pace_executor_->Wake(src->pace_task);
+    if (!src->key.empty())
+    {
+        auto it = sources.find(src->key);
+        if (it != sources.end())
+        {
+            auto registered = it->second.lock();
+            if (!registered || registered == src)
+                sources.erase(it);
+        }
+    }
+    executor_->Wake(src->task);
+}
+
+void MediaManager::UpdateLowresLocked(const std::shared_ptr<SourceContext> &src)
+{
+    int maxLowres = src->decoder ? src->decoder->max_lowres : 0;
+    if (maxLowres <= 0)
+        return;
+    // 共享源按要求最高分辨率的订阅者解码
+    std::vector<std::shared_ptr<StreamContext>> subs;
+    if (!src->Collect(subs, false))
+        return;
+    int level = maxLowres;
+    for (auto &ctx : subs)
+    {
+        std::lock_guard<std::mutex> lk(ctx->config_mtx);
+        level = std::min(level, LowresFor(ctx->config, maxLowres));
+    }
+    if (src->lowres_wanted.exchange(level) == level)
+        return;
+    spdlog::info("[{}] Decode lowres -> {}", src->url, level);
+    // 图片已解析过：重新解一遍，让订阅者拿到新分辨率的画面
+    src->static_decoded = false;
+    executor_->Wake(src->task);
+}
+
+void MediaManager::ApplyLowres(const std::shared_ptr<SourceContext> &src)
+{
+    int level = src->lowres_wanted;
+    auto par = src->fmt_ctx->streams[src->video_idx]->codecpar;
+    // lowres 只能在打开前设置，换一个新的解码器上下文
+    AVCodecContext *dec = avcodec_alloc_context3(src->decoder);
+    avcodec_parameters_to_context(dec, par);
+    dec->lowres = level;
+    if (avcodec_open2(dec, src->decoder, nullptr) < 0)
+    {
+        spdlog::warn("[{}] Failed to reopen decoder at lowres {}, keeping {}", src->url, level, src->lowres.load());
+        avcodec_free_context(&dec);
+        src->lowres_wanted = src->lowres.load();
+        return;
+    }
+    dec->skip_frame = src->dec_ctx->skip_frame;
+    avcodec_free_context(&src->dec_ctx);
+    src->dec_ctx = dec;
+    src->lowres = level;
+    av_frame_unref(src->frame);
+
+    // 帧内编码 (MJPEG 等) 下一个包就能按新分辨率解出；其余需要从关键帧重新开始
+    const AVCodecDescriptor *desc = avcodec_descriptor_get(par->codec_id);
+    if (src->is_static)
+        SeekSource(src, src->startTime > 0 ? src->startTime : 0.0);
+    else if (!desc || !(desc->props & AV_CODEC_PROP_INTRA_ONLY))
+        SeekSource(src, static_cast<double>(src->clock.position()) / 1000.0);
+}
+
+void MediaManager::UpdateJpegModeLocked(const std::shared_ptr<StreamContext> &ctx)
+{
+    auto &src = ctx->source;
+    JpegMode mode = JpegMode::None;
+    // 按需编码的读者从 YUV 编码、附加档位从主输出的像素缩小，都不走压缩域
+    if (src && src->is_mjpeg && ctx->encoder->CodecId() == AV_CODEC_ID_MJPEG && !ctx->encode_on_demand && ctx->renditions.empty())
+    {
+        auto par = src->fmt_ctx->streams[src->video_idx]->codecpar;
+        ROIConfig cfg;
+        {
+            std::lock_guard<std::mutex> lk(ctx->config_mtx);
+            cfg = ctx->config;
+        }
+        int mcuW, mcuH;
+        // 只有不缩放时才能直出
+        if (cfg.outW == cfg.srcW && cfg.outH == cfg.srcH)
+        {
+            if (cfg.srcX == 0 && cfg.srcY == 0 && cfg.srcW == par->width && cfg.srcH == par->height)
+                mode = JpegMode::Passthrough;
+            else if (JpegTranscoder::McuSize(static_cast<AVPixelFormat>(par->format), mcuW, mcuH) &&
+                     cfg.srcX % mcuW == 0 && cfg.srcY % mcuH == 0)
+                mode = JpegMode::Crop;
+        }
+    }
+    if (ctx->jpeg_mode.exchange(mode) == mode)
+        return;
+    spdlog::info("[{}] MJPEG compressed-domain mode -> {}", src ? src->url : "", magic_enum::enum_name(mode));
+    // 退出直出：恢复解码，避免下一帧没有画面
+    if (mode == JpegMode::None && src)
+        src->skip_decode = false;
+}
+
+void MediaManager::LeaveGroupLocked(const std::shared_ptr<SourceContext> &src)
+{
+    auto group = src->Group();
+    if (!group)
+        return;
+    src->SetGroup(nullptr);
+    src->sync_drift = 0;
+    if (group->Leave(src.get()) == 0)
+    {
+        groups.erase(group->id);
+        spdlog::info("SyncGroup {} removed", group->id);
+    }
+}
+
 bool MediaManager::DeleteMedia(const std::string &deviceId, int indexCode)
 {
     auto key = MakeKey(deviceId, indexCode);
@@ -89,13 +422,14 @@ bool MediaManager::DeleteMedia(const std::string &deviceId, int indexCode)
         return true;
     }
 
+    RetireLocked(this->contexts[key]);
     this->contexts.erase(key);
 
     spdlog::info("[{}] Media context deleted successfully.", key);
     return true;
 }
 
-EncoderOutput MediaManager::GetNextFrame(std::string deviceId, int indexCode)
+EncoderOutput MediaManager::GetNextFrame(std::string deviceId, int indexCode, int rendition, bool requestKeyframe, uint64_t lastSeq)
 {
     auto key = MakeKey(deviceId, indexCode);
     std::shared_ptr<StreamContext> ctx;
@@ -105,25 +439,184 @@ EncoderOutput MediaManager::GetNextFrame(std::string deviceId, int indexCode)
             return {};
         ctx = contexts[key];
     }
+    return FetchFrame(*ctx, rendition, requestKeyframe, lastSeq);
+}
 
-    // 尝试获取最新数据
+std::vector<EncoderOutput> MediaManager::GetFrames(const std::vector<FrameRequest> &requests)
+{
+    // 先在一次加锁内查出全部订阅者，取帧（可能触发按需编码）时不持 map_mtx
+    std::vector<std::shared_ptr<StreamContext>> ctxs(requests.size());
     {
-        std::lock_guard<std::mutex> lk(ctx->sync_mtx);
-        if (ctx->b_frame_busy)
+        std::string key;
+        std::lock_guard<std::mutex> lock(map_mtx);
+        for (size_t i = 0; i < requests.size(); ++i)
         {
-            std::swap(ctx->frame_buffer.bufferA, ctx->frame_buffer.bufferB);
-            ctx->b_frame_busy = false;
-            // 唤醒解码线程开始工作
-            ctx->cv_decode.notify_one();
+            // 复用同一个 key 缓冲，不为每一项分配
+            key.clear();
+            AppendKey(key, requests[i].deviceId, requests[i].indexCode);
+            auto it = contexts.find(key);
+            if (it != contexts.end())
+                ctxs[i] = it->second;
         }
     }
-    return ctx->frame_buffer.bufferA;
+    std::vector<EncoderOutput> out(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i)
+        if (ctxs[i])
+            out[i] = FetchFrame(*ctxs[i], requests[i].rendition, false, requests[i].lastSeq);
+    return out;
+}
+
+EncoderOutput MediaManager::FetchFrame(StreamContext &ctx, int rendition, bool requestKeyframe, uint64_t lastSeq)
+{
+    // 读者已有最新一帧：不拷贝、不编码
+    auto notModified = [lastSeq, requestKeyframe](const FrameBuffer &buffer)
+    {
+        return lastSeq != 0 && !requestKeyframe && buffer.Seq() == lastSeq;
+    };
+
+    if (rendition != 0)
+    {
+        auto r = ctx.FindRendition(rendition);
+        if (!r)
+            return {};
+        if (notModified(r->frame_buffer))
+            return NotModified(lastSeq);
+        if (r->inter_frame && requestKeyframe)
+            return LatestFromKeyframe(r->frame_buffer, *r->encoder);
+        return r->frame_buffer.Latest();
+    }
+    if (notModified(ctx.frame_buffer))
+        return NotModified(lastSeq);
+    // 按需编码模式：由读者触发最新 YUV 帧的编码，结果缓存到下一帧到来
+    if (ctx.encode_on_demand)
+    {
+        // 下一次编码就是关键帧，编码器内部的标志是原子的，无需持 encode_mtx
+        if (ctx.inter_frame && requestKeyframe)
+            ctx.encoder->RequestKeyframe();
+        return ctx.EncodeLatest();
+    }
+    if (ctx.inter_frame && requestKeyframe)
+        return LatestFromKeyframe(ctx.frame_buffer, *ctx.encoder);
+    // 读取最新数据，不会阻塞解码任务
+    return ctx.frame_buffer.Latest();
 }
 
-bool MediaManager::InitFilterGraph(std::shared_ptr<StreamContext> ctx, const ROIConfig &cfg, AVFrame *in_frame)
+EncoderOutput MediaManager::NotModified(uint64_t seq)
+{
+    EncoderOutput out;
+    out.seq = seq;
+    out.not_modified = true;
+    return out;
+}
+
+bool MediaManager::WaitForFrame(const std::string &deviceId, int indexCode, uint64_t lastSeq, std::chrono::milliseconds timeout, int rendition)
+{
+    auto key = MakeKey(deviceId, indexCode);
+    std::shared_ptr<StreamContext> ctx;
+    {
+        std::lock_guard<std::mutex> lock(map_mtx);
+        auto it = contexts.find(key);
+        if (it == contexts.end())
+            return false;
+        ctx = it->second;
+    }
+    // 持有 ctx / 档位的引用等待，期间删除只会 Close 唤醒，不会释放
+    if (rendition == 0)
+        return ctx->frame_buffer.WaitNewer(lastSeq, timeout);
+    auto r = ctx->FindRendition(rendition);
+    return r && r->frame_buffer.WaitNewer(lastSeq, timeout);
+}
+
+std::shared_ptr<FrameSubscription> MediaManager::Subscribe(const std::string &deviceId, int indexCode, int rendition,
+                                                         FrameSubscription::Callback callback, const SubscribeOptions &options)
+{
+    auto key = MakeKey(deviceId, indexCode);
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto it = contexts.find(key);
+    if (it == contexts.end())
+    {
+        spdlog::warn("[{}] Subscribe failed: Key not found", key);
+        return nullptr;
+    }
+    auto ctx = it->second;
+    std::shared_ptr<Rendition> r;
+    if (rendition != 0 && !(r = ctx->FindRendition(rendition)))
+    {
+        spdlog::warn("[{}] Subscribe failed: rendition {} not found", key, rendition);
+        return nullptr;
+    }
+
+    // 主输出在按需编码模式下只有 YUV，投递时现场编码
+    FrameSubscription::Pull pull;
+    if (!r)
+    {
+        std::weak_ptr<StreamContext> weakCtx = ctx;
+        pull = [weakCtx]
+        {
+            auto c = weakCtx.lock();
+            return c ? c->EncodeLatest() : EncoderOutput{};
+        };
+    }
+    bool inter = r ? r->inter_frame : ctx->inter_frame;
+    int id = next_subscription++;
+    auto sub = std::make_shared<FrameSubscription>(id, std::move(callback), options, inter, std::move(pull));
+    std::weak_ptr<FrameSubscription> weakSub = sub;
+    sub->task = std::make_shared<DecodeTask>([weakSub](DecodeTask &task)
+                                             {
+        auto s = weakSub.lock();
+        return s ? s->Step(task) : StepResult::Done; });
+    // 投递任务跑在解码执行器上：按需编码的 pull 可能很慢，不能占住只有一个线程的呈现执行器
+    DecodeExecutor *executor = executor_.get();
+    std::weak_ptr<DecodeTask> weakTask = sub->task;
+    sub->SetWaker([executor, weakTask]
+                  {
+        if (auto task = weakTask.lock())
+            executor->Wake(task); });
+
+    (r ? r->subscribers : ctx->subscribers).Add(sub);
+    // 帧间编码：新订阅从关键帧开始
+    if (inter)
+        (r ? r->encoder : ctx->encoder)->RequestKeyframe();
+    subscriptions[id] = sub;
+    spdlog::info("[{}] Subscription {} added (rendition {}, latestOnly {}, maxFps {})", key, id, rendition, options.latestOnly, options.maxFps);
+    return sub;
+}
+
+bool MediaManager::Unsubscribe(int subscriptionId)
+{
+    std::shared_ptr<FrameSubscription> sub;
+    {
+        std::lock_guard<std::mutex> lock(map_mtx);
+        auto it = subscriptions.find(subscriptionId);
+        if (it == subscriptions.end())
+            return false;
+        sub = it->second;
+        subscriptions.erase(it);
+    }
+    // 所在的订阅列表在下一次投递时顺带移除
+    sub->Cancel();
+    spdlog::info("Subscription {} removed", subscriptionId);
+    return true;
+}
+
+EncoderOutput MediaManager::LatestFromKeyframe(FrameBuffer &buffer, IEncoder &encoder)
+{
+    // 未取走的数据恰好从关键帧开始时直接交出，否则丢弃并让编码器尽快出一个关键帧
+    EncoderOutput out = buffer.Latest();
+    if (out.success && out.keyframe)
+        return out;
+    buffer.ResetToKeyframe();
+    encoder.RequestKeyframe();
+    return {};
+}
+
+bool MediaManager::InitFilterGraph(std::shared_ptr<StreamContext> ctx, const ROIConfig &cfg, AVFrame *in_frame, AVRational time_base)
 {
     ctx->ReleaseFilter(); // 销毁旧的，准备重建
     ctx->filter_graph = avfilter_graph_alloc();
+    ctx->filter_in_w = in_frame->width;
+    ctx->filter_in_h = in_frame->height;
+    ctx->filter_in_fmt = in_frame->format;
 
     char args[512];
     const AVFilter *buffersrc = avfilter_get_by_name("buffer");
@@ -135,8 +628,8 @@ bool MediaManager::InitFilterGraph(std::shared_ptr<StreamContext> ctx, const ROI
     snprintf(args, sizeof(args),
              "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d:colorspace=%d:range=%d",
              in_frame->width, in_frame->height, in_frame->format,
-             ctx->fmt_ctx->streams[ctx->video_idx]->time_base.num,
-             ctx->fmt_ctx->streams[ctx->video_idx]->time_base.den,
+             time_base.num,
+             time_base.den,
              in_frame->sample_aspect_ratio.num,
              in_frame->sample_aspect_ratio.den,
              in_frame->colorspace,
@@ -151,12 +644,14 @@ bool MediaManager::InitFilterGraph(std::shared_ptr<StreamContext> ctx, const ROI
     if (ret < 0)
         return false;
 
-    // 3. 滤镜描述符：crop -> scale -> format(强制转为 yuvj420p 适配 MJPEG)
+    // 3. 滤镜描述符：crop -> scale -> format(转为编码器的输入格式，MJPEG 为 yuvj420p)
     // 注意：这里直接使用最新的 cfg 参数
+    AVPixelFormat outFmt = ctx->encoder->InputFormat();
     std::string filters_descr = "crop=" + std::to_string(cfg.srcW) + ":" + std::to_string(cfg.srcH) +
                                 ":" + std::to_string(cfg.srcX) + ":" + std::to_string(cfg.srcY) +
                                 ",scale=" + std::to_string(cfg.outW) + ":" + std::to_string(cfg.outH) +
-                                ",format=yuvj420p";
+                                (outFmt == AV_PIX_FMT_NV12 ? ":out_range=full" : "") +
+                                ",format=" + av_get_pix_fmt_name(outFmt);
 
     outputs->name = av_strdup("in");
     outputs->filter_ctx = ctx->buffersrc_ctx;
@@ -179,169 +674,590 @@ bool MediaManager::InitFilterGraph(std::shared_ptr<StreamContext> ctx, const ROI
     return ret >= 0;
 }
 
-void MediaManager::DecodingLoop(std::shared_ptr<StreamContext> ctx)
+void MediaManager::SeekSource(const std::shared_ptr<SourceContext> &src, double target, bool loop)
 {
-    AVPacket *pkt = av_packet_alloc();
-    AVFrame *frame = av_frame_alloc();
-    AVFrame *yuvFrame = av_frame_alloc();
+    // 丢弃已预读的包，由解复用任务执行真正的 seek
+    src->packets.Flush(target);
+    io_executor_->Wake(src->demux_task);
+    avcodec_flush_buffers(src->dec_ctx);
+    av_frame_unref(src->frame);
+    UpdateDropLevel(src, 0);
+    // 已排队的帧属于旧位置，呈现任务可能正睡在旧的到期时刻上，唤醒它重新判断
+    src->ClearReady();
+    pace_executor_->Wake(src->pace_task);
 
-    yuvFrame->format = AV_PIX_FMT_YUVJ420P;
-    yuvFrame->width = ctx->config.outW;
-    yuvFrame->height = ctx->config.outH;
-    av_frame_get_buffer(yuvFrame, 0);
+    // 输出尺寸不变：编码器与滤镜链原样沿用，只清掉帧间编码的参考（下一帧为关键帧）；
+    // 配置变化仍由 filter_changed / encoder_changed 在下一帧处理
+    std::vector<std::shared_ptr<StreamContext>> subs;
+    src->Collect(subs, false);
+    for (auto &ctx : subs)
+    {
+        std::lock_guard<std::mutex> lk(ctx->present_mtx);
+        {
+            std::lock_guard<std::mutex> enc_lk(ctx->encode_mtx);
+            ctx->encoder->Flush();
+        }
+        for (auto &r : ctx->renditions)
+            r->encoder->Flush();
+    }
+    src->clock.resetToTime(target);
 
-    // 缓存当前正在使用的配置
-    ROIConfig curCfg;
+    // 同步组成员回绕：带着 master 和其他成员一起跳回，保持整组对齐
+    auto group = loop ? src->Group() : nullptr;
+    if (group && std::llabs(group->master.position() - static_cast<int64_t>(target * 1000)) > kGroupLoopWindowMs)
     {
-        std::lock_guard<std::mutex> lk(ctx->config_mtx);
-        curCfg = ctx->config;
+        group->master.resetToTime(target);
+        std::vector<std::shared_ptr<SourceContext>> members;
+        group->Collect(members);
+        for (auto &m : members)
+        {
+            if (m == src)
+                continue;
+            m->RequestSeek(target);
+            executor_->Wake(m->task);
+        }
+        spdlog::info("SyncGroup {} looped to {}s", group->id, target);
     }
+}
+
+StepResult MediaManager::DemuxStep(const std::shared_ptr<SourceContext> &src)
+{
+    if (src->stop_flag)
+        return StepResult::Done;
 
-    while (!ctx->stop_flag)
+    // seek 请求与 serial 一起取出，之后读到的包都属于新位置
+    double target;
+    int serial;
+    if (src->packets.TakeSeek(target, serial))
     {
+        int64_t seekPts = static_cast<int64_t>(target * AV_TIME_BASE);
+        avformat_seek_file(src->fmt_ctx, -1, INT64_MIN, seekPts, seekPts, 0);
+        src->demux_eof = false;
+    }
+    // 已到结尾：等下一次 seek（循环）再读
+    if (src->demux_eof)
+        return StepResult::Block;
+    // 队列满：等解码任务取走一些再读
+    if (src->packets.WaitIfFull())
+        return StepResult::Block;
+
+    if (!src->pkt)
+        src->pkt = av_packet_alloc();
+    int ret = av_read_frame(src->fmt_ctx, src->pkt);
+    if (ret == AVERROR(EAGAIN))
+        return StepResult::Yield;
+
+    bool wake = false;
+    if (ret < 0)
+    {
+        if (src->stop_flag)
+            return StepResult::Done;
+        // 流结束（或读取失败）：投递 EOF 标记，由解码任务决定跳回起点
+        if (src->packets.PushEof(serial, wake))
+            src->demux_eof = true;
+    }
+    else if (src->pkt->stream_index != src->video_idx)
+    {
+        av_packet_unref(src->pkt);
+        return StepResult::Yield;
+    }
+    else
+    {
+        // 包的所有权交给队列
+        src->packets.Push(src->pkt, serial, wake);
+        src->pkt = nullptr;
+    }
+    if (wake)
+        executor_->Wake(src->task);
+    return StepResult::Yield;
+}
 
-        // 停止等待逻辑
+bool MediaManager::ReceiveFrame(const std::shared_ptr<SourceContext> &src, bool &starved)
+{
+    starved = false;
+    // 解码器里还有上一个包解出的帧，先取完
+    if (avcodec_receive_frame(src->dec_ctx, src->frame) == 0)
+        return true;
+
+    // 每一步只取一个包
+    AVPacket *pkt = nullptr;
+    bool wakeDemux = false;
+    auto res = src->packets.Pop(pkt, wakeDemux);
+    if (wakeDemux)
+        io_executor_->Wake(src->demux_task);
+    if (res == PacketQueue::PopResult::Empty)
+    {
+        starved = true;
+        return false;
+    }
+    if (res == PacketQueue::PopResult::Eof)
+    {
+        // 流结束，跳回 startTime（如果设置了的话，否则跳回 0）
+        SeekSource(src, src->startTime > 0 ? src->startTime : 0.0, true);
+        return false;
+    }
+
+    bool got = false;
+    // 严重落后：非关键帧直接丢包，连送解码的开销也省掉
+    if (src->drop_level >= 2 && !(pkt->flags & AV_PKT_FLAG_KEY))
+        ++src->dropped_packets;
+    else if (src->skip_decode && !src->is_static)
+    {
+        // 所有订阅者都在压缩域直出：不解码，帧只带时间戳和尺寸
+        auto par = src->fmt_ctx->streams[src->video_idx]->codecpar;
+        av_frame_unref(src->frame);
+        src->frame->pts = pkt->pts;
+        src->frame->width = par->width;
+        src->frame->height = par->height;
+        got = true;
+    }
+    else if (avcodec_send_packet(src->dec_ctx, pkt) == 0)
+        got = avcodec_receive_frame(src->dec_ctx, src->frame) == 0;
+    if (src->is_mjpeg)
+    {
+        av_packet_unref(src->jpeg_pkt);
+        av_packet_move_ref(src->jpeg_pkt, pkt);
+    }
+    av_packet_free(&pkt);
+    return got;
+}
+
+void MediaManager::UpdateDropLevel(const std::shared_ptr<SourceContext> &src, int64_t lagMs)
+{
+    int level = src->drop_level;
+    int target;
+    if (lagMs > kLagNonKeyMs)
+        target = 2;
+    else if (lagMs > kLagNonRefMs)
+        target = level == 2 ? 2 : 1;
+    else if (lagMs > AllowOffestTime)
+        target = std::min(level, 1);
+    else
+        target = 0;
+
+    if (target == level)
+        return;
+    if (target > level)
+    {
+        if (target == 1)
+            ++src->nonref_skips;
+        else
+            ++src->nonkey_skips;
+    }
+    static const AVDiscard kDiscard[] = {AVDISCARD_DEFAULT, AVDISCARD_NONREF, AVDISCARD_NONKEY};
+    src->dec_ctx->skip_frame = kDiscard[target];
+    src->drop_level = target;
+    spdlog::debug("[{}] drop level {} -> {} (lag {} ms)", src->url, level, target, lagMs);
+}
+
+void MediaManager::PrepareFrame(const std::shared_ptr<StreamContext> &ctx, AVFrame *frame, const AVPacket *jpeg, int lowres, double frameTime, AVRational time_base, std::vector<ReadyOutput> &outputs)
+{
+    std::lock_guard<std::mutex> present_lk(ctx->present_mtx);
+    // MJPEG 压缩域直出：包与帧的时间戳一致时才对应同一帧
+    if (jpeg && jpeg->size > 0 && jpeg->pts == frame->pts && ctx->jpeg_mode != JpegMode::None)
+    {
+        if (PrepareJpeg(ctx, jpeg, frame, frameTime, outputs))
+            return;
+        // 码流不满足条件（渐进式、MCU 与像素格式推断的不一致等）：回退到解码 + 编码，配置变化后再重新判定
+        spdlog::warn("MJPEG compressed-domain {} failed, falling back to decode", magic_enum::enum_name(ctx->jpeg_mode.load()));
+        ctx->jpeg_mode = JpegMode::None;
+    }
+    // 本帧跳过了解码
+    if (!frame->data[0])
+        return;
+    AVFrame *yuvFrame = ctx->yuvFrame;
+    ROIConfig &curCfg = ctx->cur_cfg;
+
+    // 常规格式直接裁剪缩放，硬件帧等 swscale 不支持的格式回退到滤镜链
+    bool native = FrameScaler::Supports(frame);
+
+    // 检查配置动态更新（含输入格式在两条路径之间切换、解码分辨率变化、滤镜链输入变化）
+    if (ctx->filter_changed || native != ctx->native_scale || lowres != ctx->cur_lowres || (!native && !ctx->FilterMatches(frame)))
+    {
+        std::lock_guard<std::mutex> lk(ctx->config_mtx);
+        curCfg = ctx->config;
+        ctx->cur_lowres = lowres;
+        if (native)
+        {
+            ctx->ReleaseFilter();
+            ctx->scaler.Reset();
+        }
+        else if (!InitFilterGraph(ctx, ScaleROI(curCfg, lowres, frame->width, frame->height), frame, time_base))
         {
-            std::unique_lock<std::mutex> lk(ctx->pause_mtx);
-            // 如果处于 paused 状态且没有停止，则在此无限等待
-            ctx->cv_pause.wait(lk, [&]
-                               { return !ctx->is_paused || ctx->stop_flag; });
+            spdlog::error("Failed to re-init filter graph");
+            return;
         }
+        ctx->native_scale = native;
+        std::lock_guard<std::mutex> enc_lk(ctx->encode_mtx);
+        ctx->encoder->Reset(curCfg.outW, curCfg.outH, curCfg.quality);
+        ctx->scene_detector.Reset();
+        ctx->filter_changed = false;
+        ctx->encoder_changed = false;
+    }
+    else if (ctx->encoder_changed)
+    {
+        std::lock_guard<std::mutex> lk(ctx->config_mtx);
+        curCfg = ctx->config;
+        std::lock_guard<std::mutex> enc_lk(ctx->encode_mtx);
+        ctx->encoder->Reset(curCfg.outW, curCfg.outH, curCfg.quality);
+        ctx->scene_detector.Reset();
+        ctx->encoder_changed = false;
+    }
 
-        if (ctx->stop_flag)
-            break;
+    if (ctx->native_scale)
+    {
+        // 每帧从帧池取一块缓冲：按需编码模式下 yuv 会被移交给读者，释放后回池
+        av_frame_unref(yuvFrame);
+        yuvFrame->format = ctx->encoder->InputFormat();
+        yuvFrame->width = curCfg.outW;
+        yuvFrame->height = curCfg.outH;
+        ROIConfig roi = ScaleROI(curCfg, lowres, frame->width, frame->height);
+        if (ctx->frame_pool.GetBuffer(yuvFrame) < 0 ||
+            !ctx->scaler.Scale(frame, roi.srcX, roi.srcY, roi.srcW, roi.srcH, yuvFrame))
         {
-            std::unique_lock<std::mutex> lk(ctx->sync_mtx);
-            // spdlog::info("frame busy status {}",ctx->b_frame_busy.load());
-            ctx->cv_decode.wait(lk, [&]
-                                { return !ctx->b_frame_busy || ctx->stop_flag; });
+            spdlog::error("Failed to scale frame");
+            av_frame_unref(yuvFrame);
+            return;
         }
+        yuvFrame->pts = frame->pts;
+        yuvFrame->color_range = AVCOL_RANGE_JPEG;
+        OutputFrame(ctx, yuvFrame, frameTime, outputs);
+        return;
+    }
 
-        if (ctx->stop_flag)
-            break;
+    // spdlog::info("filter process");
+    if (av_buffersrc_add_frame_flags(ctx->buffersrc_ctx, frame, AV_BUFFERSRC_FLAG_KEEP_REF) >= 0)
+    {
+        while (av_buffersink_get_frame(ctx->buffersink_ctx, yuvFrame) == 0)
+            OutputFrame(ctx, yuvFrame, frameTime, outputs);
+    }
+}
 
-        // 如果是图片且已解析过，线程进入无限休眠（除非 stop）
-        if (ctx->is_static && ctx->static_decoded)
+bool MediaManager::PrepareJpeg(const std::shared_ptr<StreamContext> &ctx, const AVPacket *jpeg, const AVFrame *frame, double frameTime, std::vector<ReadyOutput> &outputs)
+{
+    ReadyOutput item;
+    item.ctx = ctx;
+    item.timestamp = static_cast<int64_t>(frameTime * 1000);
+    std::vector<uint8_t> &bytes = ctx->jpeg_out;
+    if (ctx->jpeg_mode == JpegMode::Passthrough)
+    {
+        if (!ctx->jpeg.Passthrough(jpeg->data, jpeg->size, bytes))
+            return false;
+        item.out.width = frame->width;
+        item.out.height = frame->height;
+    }
+    else
+    {
+        ROIConfig cfg;
         {
-            std::unique_lock<std::mutex> lk(ctx->sync_mtx);
-            ctx->cv_decode.wait(lk, [&]
-                                { return ctx->stop_flag.load(); });
-            break;
+            std::lock_guard<std::mutex> lk(ctx->config_mtx);
+            cfg = ctx->config;
         }
+        if (!ctx->jpeg.Crop(jpeg->data, jpeg->size, cfg.srcX, cfg.srcY, cfg.srcW, cfg.srcH, bytes))
+            return false;
+        item.out.width = std::min(cfg.srcW, frame->width - cfg.srcX);
+        item.out.height = std::min(cfg.srcH, frame->height - cfg.srcY);
+    }
+    item.out.data = ctx->jpeg_pool.Copy(bytes.data(), bytes.size());
+    item.out.success = true;
+    item.out.keyframe = true;
+    item.out.codec = AV_CODEC_ID_MJPEG;
+    item.out.timestamp = item.timestamp;
+    ++ctx->jpeg_frames;
+    outputs.push_back(std::move(item));
+    return true;
+}
+
+void MediaManager::OutputFrame(const std::shared_ptr<StreamContext> &ctx, AVFrame *yuv, double frameTime, std::vector<ReadyOutput> &outputs)
+{
+    ReadyOutput item;
+    item.ctx = ctx;
+    item.timestamp = static_cast<int64_t>(frameTime * 1000);
+    // 静态画面检测：与上一次编码的画面比较
+    int threshold = ctx->scene_threshold;
+    item.changed = threshold < 0 || ctx->scene_detector.Update(yuv, threshold);
+    // 附加档位：在主输出被移交 / 释放前从它级联缩小
+    if (!ctx->renditions.empty())
+        OutputRenditions(ctx, yuv, item.changed, item.timestamp, outputs);
+
+    // 按需编码：只留下 YUV，到点后交给读者侧编码
+    if (ctx->encode_on_demand)
+    {
+        item.yuv = av_frame_alloc();
+        av_frame_move_ref(item.yuv, yuv);
+        outputs.push_back(std::move(item));
+        return;
+    }
 
-        // 处理外部 seek 请求
-        if (ctx->seek_requested)
+    if (!item.changed && ctx->inter_frame)
+    {
+        // 帧间编码不重复输出：读者没有新数据，解码端保持上一帧
+        ++ctx->skipped_frames;
+        av_frame_unref(yuv);
+        return;
+    }
+    if (!item.changed && ctx->last_out.success)
+    {
+        // 画面未变化：复用上一帧的编码结果，只更新时间戳
+        item.out = ctx->last_out;
+        ++ctx->skipped_frames;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> enc_lk(ctx->encode_mtx);
+        // 码率控制：按最近几帧的大小给出本帧的 qscale，不重开编码器
+        bool rateControl = ctx->rate.Enabled();
+        if (rateControl)
+            ctx->encoder->Reset(yuv->width, yuv->height, ctx->rate.NextQuality(ctx->cur_cfg.quality));
+        ctx->encoder->Encode(yuv, item.out);
+        if (rateControl && item.out.success)
+            ctx->rate.Update(item.out.data.size(), item.timestamp);
+        ++ctx->encoded_frames;
+        if (threshold >= 0 && !ctx->inter_frame)
+            ctx->last_out = item.out;
+    }
+    item.out.timestamp = item.timestamp;
+    outputs.push_back(std::move(item));
+    av_frame_unref(yuv);
+}
+
+void MediaManager::OutputRenditions(const std::shared_ptr<StreamContext> &ctx, const AVFrame *yuv, bool changed, int64_t timestamp, std::vector<ReadyOutput> &outputs)
+{
+    bool keepLast = ctx->scene_threshold >= 0;
+    const AVFrame *prev = yuv;
+    for (auto &r : ctx->renditions)
+    {
+        ReadyOutput item;
+        item.ctx = ctx;
+        item.rendition = r;
+        item.timestamp = timestamp;
+        item.changed = changed;
+        if (!changed && r->inter_frame)
         {
-            double target;
+            // 帧间编码不重复输出；r->frame 仍是上一次的缩小结果，保留给下一档
+            if (r->frame->data[0])
+                prev = r->frame;
+            continue;
+        }
+        if (!changed && r->last_out.success)
+            item.out = r->last_out; // 画面未变化：复用上一次的编码结果，r->frame 保留给下一档
+        else
+        {
+            av_frame_unref(r->frame);
+            r->frame->format = r->encoder->InputFormat();
+            r->frame->width = r->outW;
+            r->frame->height = r->outH;
+            if (r->frame_pool.GetBuffer(r->frame) < 0 ||
+                !r->scaler.Scale(prev, 0, 0, prev->width, prev->height, r->frame))
             {
-                std::lock_guard<std::mutex> lk(ctx->seek_mtx);
-                target = ctx->seek_target;
+                spdlog::error("Failed to scale rendition {}", r->id);
+                av_frame_unref(r->frame);
+                continue;
             }
-            int64_t seekPts = static_cast<int64_t>(target * AV_TIME_BASE);
-            avformat_seek_file(ctx->fmt_ctx, -1, INT64_MIN, seekPts, seekPts, 0);
-            avcodec_flush_buffers(ctx->dec_ctx);
-            ctx->encoder->Close();
-            ctx->encoder->Open(ctx->config.outW, ctx->config.outH, ctx->config.quality);
-            ctx->ReleaseFilter();
-            this->sync_clock_.resetToTime(target);
-            ctx->seek_requested = false;
-            spdlog::info("SeekTo completed: {}s", target);
+            r->frame->pts = yuv->pts;
+            r->frame->color_range = AVCOL_RANGE_JPEG;
+            r->encoder->Encode(r->frame, item.out);
+            ++r->encoded_frames;
+            if (keepLast && !r->inter_frame)
+                r->last_out = item.out;
         }
+        item.out.timestamp = timestamp;
+        outputs.push_back(std::move(item));
+        if (r->frame->data[0])
+            prev = r->frame;
+    }
+}
+
+void MediaManager::DeliverFrame(ReadyOutput &item, bool late)
+{
+    auto ctx = item.ctx.lock();
+    // 订阅者已删除或在排队期间暂停
+    if (!ctx || ctx->is_paused)
+        return;
+    // 迟到的帧间编码输出已经编好，丢掉会让之后的 P 帧失去参考，读者花屏到下一个 GOP
+    if (late && !(item.rendition ? item.rendition->inter_frame : ctx->inter_frame))
+        return;
+    // 推送订阅只收画面有变化的帧（拷贝只增加引用计数）
+    if (item.rendition)
+    {
+        if (item.changed && !item.rendition->subscribers.Empty())
+            item.rendition->subscribers.Offer(item.out);
+        item.rendition->frame_buffer.Publish(std::move(item.out), item.changed);
+    }
+    else if (item.yuv)
+    {
+        ctx->StashFrame(item.yuv, item.timestamp, item.changed);
+        if (item.changed && !ctx->subscribers.Empty())
+            ctx->subscribers.Touch();
+    }
+    else
+    {
+        if (item.changed && !ctx->subscribers.Empty())
+            ctx->subscribers.Offer(item.out);
+        // 发布最新帧，无需等待读者
+        ctx->frame_buffer.Publish(std::move(item.out), item.changed);
+    }
+}
 
-        if (av_read_frame(ctx->fmt_ctx, pkt) >= 0)
+StepResult MediaManager::DecodeStep(const std::shared_ptr<SourceContext> &src)
+{
+    if (src->stop_flag)
+        return StepResult::Done;
+    // 图片已解析过：挂起，直到有新订阅者加入
+    if (src->is_static && src->static_decoded)
+        return StepResult::Block;
+    // 所有订阅者都暂停：挂起，等 Resume 唤醒
+    if (!src->HasActive())
+        return StepResult::Block;
+
+    // 处理外部 seek 请求
+    if (src->seek_requested)
+    {
+        double target;
         {
-            if (pkt->stream_index == ctx->video_idx)
-            {
-                if (avcodec_send_packet(ctx->dec_ctx, pkt) == 0)
-                {
-                    while (avcodec_receive_frame(ctx->dec_ctx, frame) == 0)
-                    {
-                        double timestamp = static_cast<double>(frame->pts) * av_q2d(ctx->fmt_ctx->streams[ctx->video_idx]->time_base);
-                        // spdlog::info("current time is {}", timestamp);
-
-                        // endTime 检测：到达 endTime 后跳回 startTime
-                        if (ctx->endTime > 0 && timestamp >= ctx->endTime)
-                        {
-                            av_frame_unref(frame);
-                            double seekTo = ctx->startTime > 0 ? ctx->startTime : 0.0;
-                            int64_t seekPts = static_cast<int64_t>(seekTo * AV_TIME_BASE);
-                            avformat_seek_file(ctx->fmt_ctx, -1, INT64_MIN, seekPts, seekPts, 0);
-                            avcodec_flush_buffers(ctx->dec_ctx);
-                            ctx->encoder->Close();
-                            ctx->encoder->Open(ctx->config.outW, ctx->config.outH, ctx->config.quality);
-                            ctx->ReleaseFilter();
-                            this->sync_clock_.resetToTime(seekTo);
-                            goto next_iteration;
-                        }
-
-                        bool currentFrameSend = this->sync_clock_.syncControl(timestamp * 1000);
-                        if (!currentFrameSend)
-                        {
-                            continue;
-                        }
-                        // 检查配置动态更新
-                        if (ctx->filter_changed || !ctx->filter_graph)
-                        {
-                            std::lock_guard<std::mutex> lk(ctx->config_mtx);
-                            curCfg = ctx->config;
-                            if (!InitFilterGraph(ctx, curCfg, frame))
-                            {
-                                spdlog::error("Failed to re-init filter graph");
-                                continue;
-                            }
-                            ctx->encoder->Reset(curCfg.outW, curCfg.outH, curCfg.quality);
-                            ctx->filter_changed = false;
-                            ctx->encoder_changed = false;
-                        }
-                        else if (ctx->encoder_changed)
-                        {
-                            std::lock_guard<std::mutex> lk(ctx->config_mtx);
-                            curCfg = ctx->config;
-                            ctx->encoder->Reset(curCfg.outW, curCfg.outH, curCfg.quality);
-                            ctx->encoder_changed = false;
-                        }
-                        // spdlog::info("filter process");
-                        if (av_buffersrc_add_frame_flags(ctx->buffersrc_ctx, frame, AV_BUFFERSRC_FLAG_KEEP_REF) >= 0)
-                        {
-                            while (av_buffersink_get_frame(ctx->buffersink_ctx, yuvFrame) == 0)
-                            {
-                                EncoderOutput out;
-                                ctx->encoder->Encode(yuvFrame, out);
-                                out.timestamp = static_cast<int64_t>(timestamp * 1000);
-                                // 更新 B 帧并设为忙碌
-                                {
-                                    std::lock_guard<std::mutex> lk(ctx->sync_mtx);
-                                    ctx->frame_buffer.bufferB = std::move(out);
-                                    ctx->b_frame_busy = true;
-                                }
-                                if (ctx->is_static)
-                                    ctx->static_decoded = true;
-                                av_frame_unref(yuvFrame);
-                            }
-                        }
-                    }
-                }
-            }
-            av_packet_unref(pkt);
+            std::lock_guard<std::mutex> lk(src->seek_mtx);
+            target = src->seek_target;
         }
-        else
+        src->seek_requested = false;
+        SeekSource(src, target);
+        spdlog::info("SeekTo completed: {}s", target);
+    }
+
+    // 订阅者配置变化后的解码分辨率切换
+    if (src->lowres_wanted != src->lowres)
+        ApplyLowres(src);
+
+    // 呈现队列已满：已经足够超前，等呈现任务取走后再解码
+    {
+        std::lock_guard<std::mutex> lk(src->ready_mtx);
+        if (src->ReadyFullLocked())
         {
-            // 流结束，跳回 startTime（如果设置了的话，否则跳回 0）
-            double seekTo = ctx->startTime > 0 ? ctx->startTime : 0.0;
-            int64_t seekPts = static_cast<int64_t>(seekTo * AV_TIME_BASE);
-            avformat_seek_file(ctx->fmt_ctx, -1, INT64_MIN, seekPts, seekPts, 0);
-            avcodec_flush_buffers(ctx->dec_ctx);
-            ctx->encoder->Close();
-            ctx->encoder->Open(ctx->config.outW, ctx->config.outH, ctx->config.quality);
-            ctx->ReleaseFilter();
-            this->sync_clock_.resetToTime(seekTo);
+            src->decoder_waiting = true;
+            return StepResult::Block;
         }
-        next_iteration:;
     }
 
-    av_frame_free(&yuvFrame);
-    av_frame_free(&frame);
-    av_packet_free(&pkt);
+    bool starved;
+    if (!ReceiveFrame(src, starved))
+        // 包队列空：挂起，解复用任务入队后唤醒
+        return starved ? StepResult::Block : StepResult::Yield;
+
+    src->frame_time = static_cast<double>(src->frame->pts) * av_q2d(src->fmt_ctx->streams[src->video_idx]->time_base);
+    // spdlog::info("current time is {}", src->frame_time);
+
+    // endTime 检测：到达 endTime 后跳回 startTime
+    if (src->endTime > 0 && src->frame_time >= src->endTime)
+    {
+        SeekSource(src, src->startTime > 0 ? src->startTime : 0.0, true);
+        return StepResult::Yield;
+    }
+
+    // 同步组：先把自己的时钟向 master 校正，再据此判断落后程度
+    if (auto group = src->Group())
+        src->sync_drift = src->clock.followMaster(group->master);
+
+    int64_t pts = static_cast<int64_t>(src->frame_time * 1000);
+    if (!src->is_static)
+    {
+        // 追帧：落后越多，解码器跳过的帧越多，追上后恢复
+        int64_t lag = src->clock.getLag(pts);
+        UpdateDropLevel(src, lag);
+        // 解出来就已经迟到：不再滤镜/编码，直接丢弃
+        if (lag > AllowOffestTime)
+        {
+            ++src->late_frames;
+            return StepResult::Yield;
+        }
+    }
+
+    if (!src->Collect(src->present_list))
+        return StepResult::Yield;
+
+    // 一次解码，分发给每个订阅者各自裁剪/缩放/编码，结果排队等待到点发布
+    ReadyFrame ready;
+    ready.pts_ms = pts;
+    {
+        // 复用已发布帧的 outputs 容器，稳态下不再分配
+        std::lock_guard<std::mutex> lk(src->ready_mtx);
+        if (!src->spare_outputs.empty())
+        {
+            ready.outputs = std::move(src->spare_outputs.back());
+            src->spare_outputs.pop_back();
+        }
+    }
+    AVRational tb = src->fmt_ctx->streams[src->video_idx]->time_base;
+    const AVPacket *jpeg = src->is_mjpeg ? src->jpeg_pkt : nullptr;
+    bool allJpeg = src->is_mjpeg && !src->is_static;
+    for (auto &ctx : src->present_list)
+    {
+        PrepareFrame(ctx, src->frame, jpeg, src->lowres, src->frame_time, tb, ready.outputs);
+        allJpeg = allJpeg && ctx->jpeg_mode != JpegMode::None;
+    }
+    // 所有订阅者都在压缩域直出：之后的包不再送解码器
+    src->skip_decode = allJpeg;
+    // 快照持有订阅者强引用，用完立即释放
+    src->present_list.clear();
+
+    bool wakePacer = false;
+    {
+        std::lock_guard<std::mutex> lk(src->ready_mtx);
+        src->ready.push_back(std::move(ready));
+        wakePacer = src->pacer_waiting;
+        src->pacer_waiting = false;
+    }
+    if (wakePacer)
+        pace_executor_->Wake(src->pace_task);
+    if (src->is_static)
+        src->static_decoded = true;
+    return StepResult::Yield;
+}
+
+StepResult MediaManager::PaceStep(const std::shared_ptr<SourceContext> &src, DecodeTask &task)
+{
+    if (src->stop_flag)
+        return StepResult::Done;
+    // 所有订阅者都暂停：挂起，等 Resume 唤醒
+    if (!src->HasActive())
+        return StepResult::Block;
+
+    bool wakeDecoder = false;
+    {
+        // 判断与发布都在锁内完成，seek 清空队列后不会再发布旧位置的帧
+        std::lock_guard<std::mutex> lk(src->ready_mtx);
+        if (src->ready.empty())
+        {
+            src->pacer_waiting = true;
+            ++src->ready_underruns;
+            return StepResult::Block;
+        }
+        auto &head = src->ready.front();
+        int64_t waitMs = src->clock.syncControl(head.pts_ms);
+        if (waitMs > 0)
+        {
+            // 未到呈现时间：挂到调度器上，到点再发布
+            task.wake_at = DecodeTask::Clock::now() + std::chrono::milliseconds(waitMs);
+            return StepResult::Sleep;
+        }
+        // 静态图片不会再有下一帧，迟到也要发布
+        bool late = waitMs < 0 && !src->is_static;
+        if (late)
+            ++src->late_frames;
+        for (auto &item : head.outputs)
+            DeliverFrame(item, late);
+        head.outputs.clear();
+        if (src->spare_outputs.size() < src->ready_max_frames)
+            src->spare_outputs.push_back(std::move(head.outputs));
+        src->ready.pop_front();
+
+        if (src->decoder_waiting && !src->ReadyFullLocked())
+        {
+            src->decoder_waiting = false;
+            wakeDecoder = true;
+        }
+    }
+    if (wakeDecoder)
+        executor_->Wake(src->task);
+    return StepResult::Yield;
 }
 
 void MediaManager::UpdateConfig(const std::string &devId, int idx, int x, int y, int sw, int sh)
@@ -351,9 +1267,13 @@ void MediaManager::UpdateConfig(const std::string &devId, int idx, int x, int y,
     if (contexts.find(key) != contexts.end())
     {
         auto &ctx = contexts[key];
-        std::lock_guard<std::mutex> cfg_lock(ctx->config_mtx);
-        ctx->config = {x, y, sw, sh, ctx->config.outW, ctx->config.outH, ctx->config.quality};
-        ctx->filter_changed = true;
+        {
+            std::lock_guard<std::mutex> cfg_lock(ctx->config_mtx);
+            ctx->config = {x, y, sw, sh, ctx->config.outW, ctx->config.outH, ctx->config.quality};
+            ctx->filter_changed = true;
+        }
+        UpdateLowresLocked(ctx->source);
+        UpdateJpegModeLocked(ctx);
     }
 }
 
@@ -377,24 +1297,315 @@ void MediaManager::UpdateOutputSize(const std::string &devId, int idx, int outW,
     if (contexts.find(key) != contexts.end())
     {
         auto &ctx = contexts[key];
-        std::lock_guard<std::mutex> cfg_lock(ctx->config_mtx);
-        ctx->config.outW = outW;
-        ctx->config.outH = outH;
-        ctx->filter_changed = true;
+        {
+            std::lock_guard<std::mutex> cfg_lock(ctx->config_mtx);
+            ctx->config.outW = outW;
+            ctx->config.outH = outH;
+            ctx->filter_changed = true;
+        }
+        UpdateLowresLocked(ctx->source);
+        UpdateJpegModeLocked(ctx);
     }
 }
 
-void MediaManager::SeekTo(const std::string &deviceId, int indexCode, double timeSec)
+void MediaManager::SetEncodeOnDemand(const std::string &devId, int idx, bool enabled)
 {
-    auto key = MakeKey(deviceId, indexCode);
+    auto key = MakeKey(devId, idx);
     std::lock_guard<std::mutex> lock(map_mtx);
     if (contexts.find(key) != contexts.end())
     {
         auto &ctx = contexts[key];
-        std::lock_guard<std::mutex> lk(ctx->seek_mtx);
-        ctx->seek_target = timeSec;
-        ctx->seek_requested = true;
+        ctx->encode_on_demand = enabled;
+        // 帧间编码切换输出路径后，读者要从关键帧重新开始
+        if (ctx->inter_frame)
+        {
+            ctx->frame_buffer.ResetToKeyframe();
+            ctx->encoder->RequestKeyframe();
+        }
+        UpdateJpegModeLocked(ctx);
+    }
+}
+
+void MediaManager::SetSceneThreshold(const std::string &devId, int idx, int threshold)
+{
+    auto key = MakeKey(devId, idx);
+    std::lock_guard<std::mutex> lock(map_mtx);
+    if (contexts.find(key) != contexts.end())
+        contexts[key]->scene_threshold = threshold;
+}
+
+bool MediaManager::SetRateControl(const std::string &devId, int idx, double bytesPerSecond, double bytesPerFrame, int minQuality, int maxQuality)
+{
+    auto key = MakeKey(devId, idx);
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto it = contexts.find(key);
+    if (it == contexts.end())
+        return false;
+    auto &ctx = it->second;
+    // 逐帧换 qscale 只对帧内编码成立，帧间编码改质量需要重开编码器
+    if (ctx->encoder->CodecId() != AV_CODEC_ID_MJPEG)
+    {
+        spdlog::warn("[{}] Rate control requires MJPEG output", key);
+        return false;
+    }
+    bool wasEnabled = ctx->rate.Enabled();
+    ctx->rate.Configure(bytesPerSecond, bytesPerFrame, minQuality, maxQuality);
+    // 关闭后恢复配置的固定质量
+    if (wasEnabled && !ctx->rate.Enabled())
+        ctx->encoder_changed = true;
+    spdlog::info("[{}] Rate control: {} B/s, {} B/frame, q {}-{}", key, bytesPerSecond, bytesPerFrame, minQuality, maxQuality);
+    return true;
+}
+
+void MediaManager::SetEncoderThreads(const std::string &devId, int idx, int threads)
+{
+    auto key = MakeKey(devId, idx);
+    threads = std::max(1, threads);
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto it = contexts.find(key);
+    if (it == contexts.end())
+        return;
+    auto &ctx = it->second;
+    ctx->encoder_threads = threads;
+    // 编码器在下一帧编码前按新线程数重开
+    ctx->encoder->SetThreads(threads);
+    std::lock_guard<std::mutex> lk(ctx->rendition_mtx);
+    for (auto &r : ctx->renditions)
+        r->encoder->SetThreads(threads);
+}
+
+int MediaManager::AddRendition(const std::string &devId, int idx, int outW, int outH, int quality, std::unique_ptr<IEncoder> encoder)
+{
+    auto key = MakeKey(devId, idx);
+    if (outW <= 0 || outH <= 0 || !encoder)
+        return -1;
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto it = contexts.find(key);
+    if (it == contexts.end())
+    {
+        spdlog::warn("[{}] AddRendition failed: Key not found", key);
+        return -1;
+    }
+    auto &ctx = it->second;
+    auto r = std::make_shared<Rendition>();
+    r->outW = outW;
+    r->outH = outH;
+    r->quality = quality;
+    r->encoder = std::move(encoder);
+    r->encoder->SetThreads(ctx->encoder_threads);
+    if (!r->encoder->Open(outW, outH, quality))
+    {
+        spdlog::error("[{}] AddRendition failed: cannot open encoder for {}x{}", key, outW, outH);
+        return -1;
+    }
+    r->inter_frame = !r->encoder->IntraOnly();
+    if (r->inter_frame)
+        r->frame_buffer.SetSequential(true);
+    r->frame = av_frame_alloc();
+    {
+        std::lock_guard<std::mutex> present_lk(ctx->present_mtx);
+        std::lock_guard<std::mutex> lk(ctx->rendition_mtx);
+        r->id = ctx->next_rendition++;
+        // 按面积从大到小插入，保证每档都从最近的更大一档缩小
+        auto pos = std::find_if(ctx->renditions.begin(), ctx->renditions.end(), [&](const std::shared_ptr<Rendition> &o)
+                                { return o->outW * o->outH < outW * outH; });
+        ctx->renditions.insert(pos, r);
+    }
+    UpdateJpegModeLocked(ctx);
+    spdlog::info("[{}] Rendition {} added: {}x{} q={}", key, r->id, outW, outH, quality);
+    return r->id;
+}
+
+bool MediaManager::RemoveRendition(const std::string &devId, int idx, int rendition)
+{
+    auto key = MakeKey(devId, idx);
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto it = contexts.find(key);
+    if (it == contexts.end())
+        return false;
+    auto &ctx = it->second;
+    bool removed = false;
+    {
+        std::lock_guard<std::mutex> present_lk(ctx->present_mtx);
+        std::lock_guard<std::mutex> lk(ctx->rendition_mtx);
+        auto pos = std::find_if(ctx->renditions.begin(), ctx->renditions.end(), [&](const std::shared_ptr<Rendition> &o)
+                                { return o->id == rendition; });
+        if (pos != ctx->renditions.end())
+        {
+            CloseOutputLocked((*pos)->subscribers, (*pos)->frame_buffer);
+            ctx->renditions.erase(pos);
+            removed = true;
+        }
+    }
+    if (removed)
+        UpdateJpegModeLocked(ctx);
+    return removed;
+}
+
+StreamStats MediaManager::GetStats(const std::string &devId, int idx)
+{
+    auto key = MakeKey(devId, idx);
+    std::lock_guard<std::mutex> lock(map_mtx);
+    StreamStats stats;
+    auto it = contexts.find(key);
+    if (it == contexts.end())
+        return stats;
+    auto &ctx = it->second;
+    stats.valid = true;
+    stats.encodedFrames = ctx->encoded_frames;
+    stats.skippedFrames = ctx->skipped_frames;
+    stats.rate = ctx->rate.Stats();
+    stats.jpegMode = static_cast<int>(ctx->jpeg_mode.load());
+    stats.jpegFrames = ctx->jpeg_frames;
+    {
+        std::lock_guard<std::mutex> lk(ctx->rendition_mtx);
+        stats.renditions = ctx->renditions.size();
+        for (auto &r : ctx->renditions)
+            stats.renditionEncodedFrames += r->encoded_frames;
+    }
+    auto &src = ctx->source;
+    stats.dropLevel = src->drop_level;
+    stats.droppedPackets = src->dropped_packets;
+    stats.lateFrames = src->late_frames;
+    stats.nonRefSkips = src->nonref_skips;
+    stats.nonKeySkips = src->nonkey_skips;
+    stats.syncDriftMs = src->sync_drift;
+    stats.decodeLowres = src->lowres;
+    stats.wakeJitter = src->pace_task->jitter.Counts();
+    stats.wakeJitterMaxUs = src->pace_task->jitter.MaxUs();
+    auto q = src->packets.Stats();
+    stats.demuxQueueBytes = q.bytes;
+    stats.demuxQueueMs = q.durationMs;
+    stats.demuxQueuePackets = q.packets;
+    stats.demuxMaxBytes = q.maxBytes;
+    stats.demuxMaxMs = q.maxDurationMs;
+    stats.demuxUnderruns = q.underruns;
+    stats.demuxStalls = q.stalls;
+    {
+        std::lock_guard<std::mutex> lk(src->ready_mtx);
+        stats.presentQueueFrames = src->ready.size();
+        stats.presentMaxFrames = src->ready_max_frames;
+        stats.presentMaxMs = src->ready_max_ms;
+    }
+    stats.presentUnderruns = src->ready_underruns;
+    return stats;
+}
+
+void MediaManager::SetDemuxLimits(const std::string &devId, int idx, size_t maxBytes, int64_t maxDurationMs)
+{
+    auto key = MakeKey(devId, idx);
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto it = contexts.find(key);
+    if (it == contexts.end())
+        return;
+    auto &src = it->second->source;
+    if (src->packets.SetLimits(maxBytes, maxDurationMs))
+        io_executor_->Wake(src->demux_task);
+}
+
+void MediaManager::SetPresentQueue(const std::string &devId, int idx, size_t maxFrames, int64_t maxMs)
+{
+    auto key = MakeKey(devId, idx);
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto it = contexts.find(key);
+    if (it == contexts.end())
+        return;
+    auto &src = it->second->source;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lk(src->ready_mtx);
+        // 至少超前一帧，否则解码任务无法推进
+        src->ready_max_frames = std::max<size_t>(1, maxFrames);
+        src->ready_max_ms = std::max<int64_t>(0, maxMs);
+        if (src->decoder_waiting && !src->ReadyFullLocked())
+        {
+            src->decoder_waiting = false;
+            wake = true;
+        }
+    }
+    if (wake)
+        executor_->Wake(src->task);
+}
+
+void MediaManager::SetPacingSpin(int spinUs)
+{
+    scheduler_->SetSpinUs(spinUs);
+}
+
+PacingStats MediaManager::GetPacingStats()
+{
+    auto &scheduler = *scheduler_;
+    PacingStats stats;
+    stats.spinUs = scheduler.SpinUs();
+    stats.wakeJitter = scheduler.Jitter().Counts();
+    stats.wakeJitterMaxUs = scheduler.Jitter().MaxUs();
+    return stats;
+}
+
+void MediaManager::SeekTo(const std::string &deviceId, int indexCode, double timeSec)
+{
+    auto key = MakeKey(deviceId, indexCode);
+    std::shared_ptr<StreamContext> ctx;
+    std::shared_ptr<SourceContext> src;
+    {
+        std::lock_guard<std::mutex> lock(map_mtx);
+        if (contexts.find(key) == contexts.end())
+            return;
+        ctx = contexts[key];
+        src = ctx->source;
+
+        // 同步组成员：整组一起 seek（共享源不再拆分，组内画面保持对齐）
+        if (auto group = src->Group())
+        {
+            group->master.resetToTime(timeSec);
+            if (!group->AnyActive())
+                group->master.pause();
+            std::vector<std::shared_ptr<SourceContext>> members;
+            group->Collect(members);
+            for (auto &m : members)
+            {
+                m->RequestSeek(timeSec);
+                executor_->Wake(m->task);
+            }
+            spdlog::info("[{}] SyncGroup {} seek to {}s", key, group->id, timeSec);
+            return;
+        }
+
+        if (src->is_static || src->SubscriberCount() <= 1)
+        {
+            src->RequestSeek(timeSec);
+            executor_->Wake(src->task);
+            return;
+        }
     }
+
+    // 共享源上 seek 会影响其他订阅者：为该订阅者单独开一个私有源（不参与共享）
+    ROIConfig cfg;
+    {
+        std::lock_guard<std::mutex> lk(ctx->config_mtx);
+        cfg = ctx->config;
+    }
+    auto priv = OpenSource(src->url, src->startTime, src->endTime, cfg);
+    if (!priv)
+    {
+        spdlog::error("[{}] SeekTo failed: cannot open private source for {}", key, src->url);
+        return;
+    }
+    priv->RequestSeek(timeSec);
+    {
+        std::lock_guard<std::mutex> lock(map_mtx);
+        auto it = contexts.find(key);
+        if (it == contexts.end() || it->second != ctx)
+            return; // 期间已被删除或替换
+        DetachLocked(ctx);
+        ctx->source = priv;
+        priv->Attach(ctx);
+        ctx->filter_changed = true;
+    }
+    spdlog::info("[{}] Detached from shared source for seek", key);
+    io_executor_->Wake(priv->demux_task);
+    executor_->Wake(priv->task);
+    pace_executor_->Wake(priv->pace_task);
 }
 
 bool MediaManager::Pause(const std::string &deviceId, int indexCode)
@@ -411,15 +1622,18 @@ bool MediaManager::Pause(const std::string &deviceId, int indexCode)
 
     auto ctx = this->contexts[key];
 
-    // 1. 设置状态
-    {
-        std::lock_guard<std::mutex> lk(ctx->pause_mtx);
-        ctx->is_paused = true;
-    }
+    // 1. 设置状态，该订阅者不再接收新帧；所有订阅者都暂停时源任务挂起
+    ctx->is_paused = true;
 
-    // 2. 通知时钟记录暂停时间
+    // 2. 通知时钟记录暂停时间：只停该源自己的时钟，共享源要等所有订阅者都暂停
     // 注意：要在解码线程挂起前或者同时记录，最好由主控线程立即记录
-    this->sync_clock_.pause();
+    auto &src = ctx->source;
+    if (!src->HasActive())
+        src->clock.pause();
+    // 同步组整组暂停时 master 也停表，恢复后从同一位置继续
+    auto group = src->Group();
+    if (group && !group->AnyActive())
+        group->master.pause();
     return true;
 }
 
@@ -437,19 +1651,112 @@ bool MediaManager::Resume(const std::string &deviceId, int indexCode)
 
     auto ctx = this->contexts[key];
 
-    // 1. 修正时钟（要在唤醒线程之前做）
-    this->sync_clock_.resume();
+    // 1. 修正时钟（要在唤醒线程之前做），未暂停的时钟不受影响
+    // 同步组成员单独暂停后恢复，会在下一帧向 master 对齐
+    auto &src = ctx->source;
+    if (auto group = src->Group())
+        group->master.resume();
+    src->clock.resume();
 
-    // 2. 唤醒解码线程
+    // 2. 帧间编码：暂停期间排队的包已被丢弃，之后的 P 帧缺少参考，读者和订阅都从下一个关键帧重新开始
+    if (ctx->inter_frame)
     {
-        std::lock_guard<std::mutex> lk(ctx->pause_mtx);
-        ctx->is_paused = false;
+        ctx->frame_buffer.ResetToKeyframe();
+        ctx->subscribers.ResetToKeyframe();
+        ctx->encoder->RequestKeyframe();
     }
-    ctx->cv_pause.notify_all();
+    {
+        std::lock_guard<std::mutex> lk(ctx->rendition_mtx);
+        for (auto &r : ctx->renditions)
+        {
+            if (!r->inter_frame)
+                continue;
+            r->frame_buffer.ResetToKeyframe();
+            r->subscribers.ResetToKeyframe();
+            r->encoder->RequestKeyframe();
+        }
+    }
+
+    // 3. 唤醒解码任务
+    ctx->is_paused = false;
+    executor_->Wake(src->task);
+    pace_executor_->Wake(src->pace_task);
+    return true;
+}
+
+bool MediaManager::JoinSyncGroup(const std::string &groupId, const std::string &devId, int idx)
+{
+    auto key = MakeKey(devId, idx);
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto it = contexts.find(key);
+    if (it == contexts.end())
+    {
+        spdlog::warn("[{}] JoinSyncGroup failed: Key not found", key);
+        return false;
+    }
+    auto src = it->second->source;
+    if (src->is_static)
+    {
+        spdlog::warn("[{}] JoinSyncGroup ignored: static image has no timeline", key);
+        return false;
+    }
+
+    auto current = src->Group();
+    if (current && current->id == groupId)
+        return true;
+    if (current)
+        LeaveGroupLocked(src);
+
+    auto &group = groups[groupId];
+    std::vector<std::shared_ptr<SourceContext>> live;
+    if (group)
+        group->Collect(live);
+    else
+    {
+        group = std::make_shared<SyncGroup>();
+        group->id = groupId;
+    }
+    // 以第一个成员的当前位置作为 master 起点
+    if (live.empty())
+        group->master.resetToTime(static_cast<double>(src->clock.position()) / 1000.0);
+    size_t members = group->Join(src);
+    src->SetGroup(group);
+    if (src->SubscriberCount() > 1)
+        spdlog::info("[{}] Source is shared: all its subscribers follow SyncGroup {}", key, groupId);
+    spdlog::info("[{}] Joined SyncGroup {} ({} members)", key, groupId, members);
+    return true;
+}
+
+bool MediaManager::LeaveSyncGroup(const std::string &devId, int idx)
+{
+    auto key = MakeKey(devId, idx);
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto it = contexts.find(key);
+    if (it == contexts.end())
+    {
+        spdlog::warn("[{}] LeaveSyncGroup failed: Key not found", key);
+        return false;
+    }
+    LeaveGroupLocked(it->second->source);
     return true;
 }
 
 std::string MediaManager::MakeKey(std::string devId, int idx)
 {
-    return devId + "_" + std::to_string(idx);
+    std::string key;
+    AppendKey(key, devId, idx);
+    return key;
+}
+
+void MediaManager::AppendKey(std::string &out, const std::string &devId, int idx)
+{
+    out += devId;
+    out += '_';
+    out += std::to_string(idx);
 }
+
+
+std::string MediaManager::MakeSourceKey(const std::string &url, double startTime, double endTime)
+{
+    return url + "|" + std::to_string(startTime) + "|" + std::to_string(endTime);
+}
\ No newline at end of file
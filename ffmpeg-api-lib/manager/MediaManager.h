@@ -1,15 +1,35 @@
 #pragma once
-#include "StreamContext.h"
+#include "SourceContext.h"
 #include <unordered_map>
 #include <string>
-#include "SyncClock.h"
+#include <chrono>
+#include "SyncGroup.h"
+#include "DecodeExecutor.h"
+// 呈现调度器的全局状态（所有流共用一个调度器）
+struct PacingStats
+{
+    int spinUs = 0;
+    std::array<uint64_t, JitterHistogram::kBuckets> wakeJitter{};
+    int64_t wakeJitterMaxUs = 0;
+};
+
+// 批量获取的一项，含义同 GetNextFrame 的参数
+struct FrameRequest
+{
+    std::string deviceId;
+    int indexCode = 0;
+    int rendition = 0;
+    uint64_t lastSeq = 0;
+};
+
 class MediaManager
 {
 public:
     MediaManager();
-    ~MediaManager() = default;
+    ~MediaManager();
 
     // 添加任务：deviceId + indexCode 构成唯一标识
+    // 相同 url + 时间范围的任务共享同一个解码源，只做一次解复用和解码
     bool AddMedia(const std::string &deviceId,
                   int indexCode,
                   const std::string &url,
@@ -23,19 +43,128 @@ public:
     void UpdateQuality(const std::string &devId, int idx, int quality);
     void UpdateOutputSize(const std::string &devId, int idx, int outW, int outH);
     void SeekTo(const std::string &deviceId, int indexCode, double timeSec);
+    // 按需编码：开启后解码任务不再逐帧编码，GetNextFrame 时才编码最新帧
+    void SetEncodeOnDemand(const std::string &devId, int idx, bool enabled);
+    // 静态画面检测阈值 (分片平均亮度差 0-255)，<0 关闭，0 只跳过完全相同的画面
+    void SetSceneThreshold(const std::string &devId, int idx, int threshold);
+    // 附加输出档位：同一 ROI 再输出一种尺寸 / 质量，只增加一次缩小和编码的开销
+    // 返回档位 id（>0，供 GetNextFrame 选择），失败返回 -1
+    int AddRendition(const std::string &devId, int idx, int outW, int outH, int quality, std::unique_ptr<IEncoder> encoder);
+    bool RemoveRendition(const std::string &devId, int idx, int rendition);
+    // 字节预算码率控制（MJPEG 主输出）：逐帧在 [minQuality, maxQuality] 内调整 qscale
+    // bytesPerSecond / bytesPerFrame 都 <=0 时关闭，恢复固定质量
+    bool SetRateControl(const std::string &devId, int idx, double bytesPerSecond, double bytesPerFrame, int minQuality = 2, int maxQuality = 31);
+    // 单帧并行编码线程数（主输出与附加档位），大尺寸输出单线程编码赶不上帧率时调大
+    void SetEncoderThreads(const std::string &devId, int idx, int threads);
+    StreamStats GetStats(const std::string &devId, int idx);
+    // 解复用预读上限（字节 / 毫秒），作用于该流所属的解码源
+    void SetDemuxLimits(const std::string &devId, int idx, size_t maxBytes, int64_t maxDurationMs);
+    // 预解码呈现队列上限（帧数 / 毫秒），作用于该流所属的解码源
+    void SetPresentQueue(const std::string &devId, int idx, size_t maxFrames, int64_t maxMs);
+    // 到期前的自旋窗口（微秒），0 关闭；以少量 CPU 换取更小的唤醒抖动
+    void SetPacingSpin(int spinUs);
+    PacingStats GetPacingStats();
+
+    // 同步组：加入后该流所属解码源的时钟向组内 master 校正，seek / 循环对整组生效
+    // 组在第一个成员加入时创建，最后一个成员离开时销毁
+    bool JoinSyncGroup(const std::string &groupId, const std::string &devId, int idx);
+    bool LeaveSyncGroup(const std::string &devId, int idx);
 
+    // 暂停只影响该流自己的时钟；共享源在所有订阅者都暂停时才停表
     bool Pause(const std::string &deviceId, int indexCode);
 
     bool Resume(const std::string &deviceId, int indexCode);
 
-    // 获取最新帧：A 指针数据
-    EncoderOutput GetNextFrame(std::string deviceId, int indexCode);
+    // 获取最新帧：A 指针数据；rendition 为 0 取主输出，否则取对应的附加档位
+    // 帧间编码的输出返回上次读取之后的全部数据（没有新数据时为空）；
+    // requestKeyframe：新读者要求从关键帧开始，未取走的数据不以关键帧开头时丢弃并强制下一帧为关键帧
+    // lastSeq：读者上次拿到的序号，非 0 且没有新帧时只返回 not_modified，不取帧也不编码
+    EncoderOutput GetNextFrame(std::string deviceId, int indexCode, int rendition = 0, bool requestKeyframe = false, uint64_t lastSeq = 0);
+
+    // 批量获取：一次 map_mtx 查出全部流，再逐个取帧；返回与 requests 一一对应的结果
+    // 流不存在时为空结果，没有新帧时为 not_modified
+    std::vector<EncoderOutput> GetFrames(const std::vector<FrameRequest> &requests);
+
+    // 阻塞到该路输出发布了序号不同于 lastSeq 的帧，代替原生读者的忙轮询；超时、流或档位不存在 / 被删除时返回 false
+    bool WaitForFrame(const std::string &deviceId, int indexCode, uint64_t lastSeq, std::chrono::milliseconds timeout, int rendition = 0);
+
+    // 推送订阅：该路输出发布新帧（画面有变化）后在解码线程上回调 callback，须很快返回；
+    // 回调方处理完每一帧都要调用 FrameSubscription::Release：latestOnly 时此后才收到下一帧，否则最多 8 帧未 Release。流不存在时返回 nullptr
+    std::shared_ptr<FrameSubscription> Subscribe(const std::string &deviceId, int indexCode, int rendition,
+                                                 FrameSubscription::Callback callback, const SubscribeOptions &options);
+    bool Unsubscribe(int subscriptionId);
 
 private:
+    // 分配测试不经解码源，直接驱动单个订阅者的 裁剪缩放 -> 编码 -> 发布
+    friend struct MediaManagerTestAccess;
+
     std::unordered_map<std::string, std::shared_ptr<StreamContext>> contexts;
+    // 源注册表：url + 时间范围 -> 解码源，引用计数即订阅者数量
+    std::unordered_map<std::string, std::weak_ptr<SourceContext>> sources;
+    std::unordered_map<std::string, std::shared_ptr<SyncGroup>> groups;
+    // 推送订阅：析构时统一取消，之后回调方的 Release 不再唤醒已停止的执行器
+    std::unordered_map<int, std::shared_ptr<FrameSubscription>> subscriptions;
+    int next_subscription = 1;
     std::mutex map_mtx;
-    SyncClock sync_clock_;
-    bool InitFilterGraph(std::shared_ptr<StreamContext> ctx, const ROIConfig &cfg, AVFrame *in_frame);
-    void DecodingLoop(std::shared_ptr<StreamContext> ctx);
+    // 打开解复用器与解码器并创建（尚未调度的）解码任务
+    // config 为首个订阅者的配置，用来决定初始的降分辨率解码级别
+    std::shared_ptr<SourceContext> OpenSource(const std::string &url, double startTime, double endTime, const ROIConfig &config);
+    // 订阅者离开源，最后一个离开时停止并注销源（需持有 map_mtx）
+    void DetachLocked(const std::shared_ptr<StreamContext> &ctx);
+    // 订阅者被删除或被同名 AddMedia 替换：取消其各路输出上的推送订阅、唤醒等帧的读者，再从源上摘下（map_mtx 下）
+    void RetireLocked(const std::shared_ptr<StreamContext> &ctx);
+    // 一路输出被删除：取消订阅并从 subscriptions 中移除，唤醒等帧的读者（map_mtx 下）
+    void CloseOutputLocked(SubscriberList &subs, FrameBuffer &buffer);
+    // 源离开所属同步组，组空时注销（需持有 map_mtx）
+    void LeaveGroupLocked(const std::shared_ptr<SourceContext> &src);
+    // 按所有订阅者的 ROI / 输出尺寸重新计算降分辨率解码级别，变化时交给解码任务重开解码器（需持有 map_mtx）
+    void UpdateLowresLocked(const std::shared_ptr<SourceContext> &src);
+    // 解码任务内：以 lowres_wanted 重开解码器
+    void ApplyLowres(const std::shared_ptr<SourceContext> &src);
+    // 按源的编码格式和订阅者的 ROI / 输出尺寸 / 编码器判定能否在压缩域直出（需持有 map_mtx）
+    void UpdateJpegModeLocked(const std::shared_ptr<StreamContext> &ctx);
+    bool InitFilterGraph(std::shared_ptr<StreamContext> ctx, const ROIConfig &cfg, AVFrame *in_frame, AVRational time_base);
+    // 解复用任务的单步：处理 seek，读一个包放入包队列；队列满或到结尾时挂起
+    StepResult DemuxStep(const std::shared_ptr<SourceContext> &src);
+    // 解码任务的单步：取一个包 -> 解码 -> 各订阅者滤镜/编码 -> 放入呈现队列，然后让出线程
+    // 呈现队列满时挂起，不再等时钟
+    StepResult DecodeStep(const std::shared_ptr<SourceContext> &src);
+    // 呈现任务的单步：队首到点则发布给各订阅者，否则挂到调度器上等到点
+    StepResult PaceStep(const std::shared_ptr<SourceContext> &src, DecodeTask &task);
+    // starved 为 true 表示包队列已空，需等解复用任务唤醒
+    bool ReceiveFrame(const std::shared_ptr<SourceContext> &src, bool &starved);
+    // 提前完成滤镜/静态检测/编码，输出追加到 outputs
+    // jpeg: MJPEG 源当前帧的包（其余为 nullptr）；skip_decode 时 frame 只有时间戳和尺寸
+    // lowres: 帧的解码缩小级别，ROI 据此映射到缩小后的坐标系
+    void PrepareFrame(const std::shared_ptr<StreamContext> &ctx, AVFrame *frame, const AVPacket *jpeg, int lowres, double frameTime, AVRational time_base, std::vector<ReadyOutput> &outputs);
+    // 压缩域直出（调用方持有 present_mtx），失败返回 false 由调用方回退到解码 + 编码
+    bool PrepareJpeg(const std::shared_ptr<StreamContext> &ctx, const AVPacket *jpeg, const AVFrame *frame, double frameTime, std::vector<ReadyOutput> &outputs);
+    // 对一帧裁剪缩放后的 yuvj420p 做静态检测/编码（调用方持有 present_mtx），处理完 yuv 被清空
+    void OutputFrame(const std::shared_ptr<StreamContext> &ctx, AVFrame *yuv, double frameTime, std::vector<ReadyOutput> &outputs);
+    // 由主输出级联缩小出各附加档位并编码（调用方持有 present_mtx）
+    void OutputRenditions(const std::shared_ptr<StreamContext> &ctx, const AVFrame *yuv, bool changed, int64_t timestamp, std::vector<ReadyOutput> &outputs);
+    // 到点发布一路输出；late 时帧内编码的输出直接丢弃，帧间编码的照常发布
+    void DeliverFrame(ReadyOutput &item, bool late);
+    // 帧间编码的新读者：从关键帧开始取数据
+    static EncoderOutput LatestFromKeyframe(FrameBuffer &buffer, IEncoder &encoder);
+    // 条件获取没有新帧时的结果
+    static EncoderOutput NotModified(uint64_t seq);
+    // 已查到订阅者后的取帧逻辑，GetNextFrame / GetFrames 共用
+    static EncoderOutput FetchFrame(StreamContext &ctx, int rendition, bool requestKeyframe, uint64_t lastSeq);
+    // loop 为 true 表示播放到结尾后的回绕，同步组成员会带着整组一起跳回
+    void SeekSource(const std::shared_ptr<SourceContext> &src, double target, bool loop = false);
+    // 根据落后程度调整解码器的 skip_frame 等级
+    void UpdateDropLevel(const std::shared_ptr<SourceContext> &src, int64_t lagMs);
     std::string MakeKey(std::string devId, int idx);
+    // 订阅者 key 追加到 out 末尾，批量查找时复用同一个缓冲
+    static void AppendKey(std::string &out, const std::string &devId, int idx);
+    std::string MakeSourceKey(const std::string &url, double startTime, double endTime);
+    // 唯一的呈现调度器，注入到需要定时的执行器；析构时在执行器停止之后再停
+    std::unique_ptr<PresentScheduler> scheduler_;
+    // 析构时先停止各执行器的工作线程，保证任务不会再访问其他成员
+    std::unique_ptr<DecodeExecutor> executor_;
+    // I/O 执行器：只跑解复用任务，阻塞的读取不占用解码线程
+    std::unique_ptr<DecodeExecutor> io_executor_;
+    // 呈现执行器：只跑呈现任务，到点发布不会排在编码后面
+    std::unique_ptr<DecodeExecutor> pace_executor_;
 };
\ No newline at end of file
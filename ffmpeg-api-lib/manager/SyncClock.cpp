@@ -1,19 +1,30 @@
 #include <SyncClock.h>
-#include <TimerSleep.h>
+#include <cstdlib>
 
 int64_t AllowOffestTime = 40;
 
+namespace
+{
+    // 同步组校正：偏差超过 kSnapMs 直接对齐，否则每帧只修正 1/kSlewDiv，避免画面跳动
+    constexpr int64_t kSnapMs = 500;
+    constexpr int64_t kSlewDiv = 8;
+    constexpr int64_t kDeadZoneMs = 2;
+}
+
 void SyncClock::markCurrentTime(int64_t totalTime) {
+    std::lock_guard<std::mutex> lk(this->mtx);
     this->startTime = av_gettime() / 1000;
     this->totalTime = totalTime;
 }
 
 void SyncClock::resetToTime(double timeSec) {
+    std::lock_guard<std::mutex> lk(this->mtx);
     this->startTime = av_gettime() / 1000 - static_cast<int64_t>(timeSec * 1000);
     this->pauseAt = 0;
 }
 
-bool SyncClock::syncControl(int64_t pts) {
+int64_t SyncClock::syncControl(int64_t pts) {
+    std::lock_guard<std::mutex> lk(this->mtx);
     // 获取现在的时刻的偏移
     int64_t base = this->getSyncDrift();
     // 获取理论要睡的时间 pts为视频的偏移
@@ -21,25 +32,58 @@ bool SyncClock::syncControl(int64_t pts) {
     // spdlog::info("SleepMs is {}, pts :{} , base :{}", sleepMs, pts, base);
     if(sleepMs > totalTime){
         startTime = av_gettime() / 1000 - pts;
+        return 0;
     }
     if (sleepMs <= 0 && AllowOffestTime + sleepMs >= 0) {
-        return true;
+        return 0;
     }
     if (sleepMs >= 0) {
-        //睡眠一段时间
-        TimerSleep::sleep_for_ms(sleepMs);
-        return true;
+        // 不在此处睡眠，由调用方按返回值挂起任务
+        return sleepMs;
     }
-    return false;
+    return -1;
+}
+
+int64_t SyncClock::getLag(int64_t pts) const {
+    std::lock_guard<std::mutex> lk(this->mtx);
+    return this->getSyncDrift() - pts;
+}
+
+int64_t SyncClock::position() const {
+    std::lock_guard<std::mutex> lk(this->mtx);
+    return this->getSyncDrift();
+}
+
+int64_t SyncClock::followMaster(const SyncClock &master) {
+    // 先读 master 再锁自己，两把锁不嵌套
+    int64_t target = master.position();
+    std::lock_guard<std::mutex> lk(this->mtx);
+    // 暂停中的成员不校正，恢复后再追上
+    if (this->pauseAt > 0)
+        return 0;
+    int64_t drift = this->getSyncDrift() - target;
+    int64_t fix;
+    if (std::llabs(drift) > kSnapMs)
+        fix = drift;
+    else if (std::llabs(drift) > kDeadZoneMs)
+        fix = drift / kSlewDiv != 0 ? drift / kSlewDiv : (drift > 0 ? 1 : -1);
+    else
+        fix = 0;
+    // 时钟超前则推后起点，落后则提前起点
+    this->startTime += fix;
+    return drift;
 }
 
 void SyncClock::pause()
 {
-    this->pauseAt = av_gettime() / 1000;
+    std::lock_guard<std::mutex> lk(this->mtx);
+    if (this->pauseAt == 0)
+        this->pauseAt = av_gettime() / 1000;
 }
 
 void SyncClock::resume()
 {
+    std::lock_guard<std::mutex> lk(this->mtx);
     if (this->pauseAt > 0) {
         this->startTime += av_gettime() / 1000 - this->pauseAt;
         this->pauseAt = 0;
@@ -47,6 +91,7 @@ void SyncClock::resume()
 }
 
 int64_t SyncClock::getSyncDrift() const {
-    int64_t cur = av_gettime() / 1000;
+    // 暂停期间时钟停在暂停时刻
+    int64_t cur = this->pauseAt > 0 ? this->pauseAt : av_gettime() / 1000;
     return cur - this->startTime;
-}
\ No newline at end of file
+}
@@ -1,9 +1,11 @@
 #pragma once
 /**
  * 同步时钟 用于控制每一个解析器解析时刻的类
+ * 每个解码源各持有一个，暂停 / seek / 循环只影响自己
  * public:
  *      1. 标记起始时间
- *      2. 传入目标时间，判断需要睡眠多久 进行睡眠操作
+ *      2. 传入目标时间，计算需要等待多久 (不阻塞，由解码任务挂起等待)
+ *      3. 同步组成员逐帧向组内 master 时钟校正
  * private:
  *      1. 获取当前的偏移时间
 */
@@ -11,17 +13,29 @@ extern "C"
 {
 #include <libavutil/time.h>
 }
+#include <cstdint>
+#include <mutex>
 extern int64_t AllowOffestTime;
 class SyncClock{
 public:
     void markCurrentTime(int64_t totalTime);
     void resetToTime(double timeSec);
-    bool syncControl(int64_t pts);
+    // 返回值: >0 需等待的毫秒数, 0 立即呈现, <0 落后太多应丢弃
+    int64_t syncControl(int64_t pts);
+    // 当前时钟落后于 pts 的毫秒数，>0 表示该帧已经迟到
+    int64_t getLag(int64_t pts) const;
+    // 当前时钟位置（毫秒），暂停期间停在暂停时刻
+    int64_t position() const;
+    // 向 master 校正，返回校正前的偏差（本时钟 - master，毫秒）
+    int64_t followMaster(const SyncClock &master);
+    // 重复调用只记录第一次暂停的时刻
     void pause();
     void resume();
 private:
     int64_t getSyncDrift() const;
-    int64_t startTime;
-    int64_t totalTime;
+    int64_t startTime = 0;
+    int64_t totalTime = INT64_MAX;
     int64_t pauseAt = 0;
-};
\ No newline at end of file
+    // 解码任务与 API 线程都会访问
+    mutable std::mutex mtx;
+};
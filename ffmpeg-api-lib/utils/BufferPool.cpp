@@ -0,0 +1,111 @@
+#include "BufferPool.h"
+#include <cerrno>
+#include <cstring>
+
+extern "C"
+{
+#include <libavutil/imgutils.h>
+}
+
+BufferPool::~BufferPool()
+{
+    for (auto &pool : classes)
+        av_buffer_pool_uninit(&pool);
+}
+
+AVBufferRef *BufferPool::Get(size_t size)
+{
+    size_t total = size + AV_INPUT_BUFFER_PADDING_SIZE;
+    int level = 0;
+    while (level < kClasses && (static_cast<size_t>(1) << (kMinBits + level)) < total)
+        ++level;
+    if (level == kClasses)
+        return av_buffer_alloc(total);
+
+    AVBufferPool *pool;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (!classes[level])
+            classes[level] = av_buffer_pool_init(static_cast<size_t>(1) << (kMinBits + level), nullptr);
+        pool = classes[level];
+    }
+    return pool ? av_buffer_pool_get(pool) : nullptr;
+}
+
+SharedBuffer BufferPool::Copy(const uint8_t *data, size_t size)
+{
+    if (!data || size == 0)
+        return {};
+    AVBufferRef *buf = Get(size);
+    if (!buf)
+        return {};
+    std::memcpy(buf->data, data, size);
+    return SharedBuffer(buf, size);
+}
+
+void BufferPool::Attach(AVCodecContext *avctx)
+{
+    avctx->opaque = this;
+    avctx->get_encode_buffer = GetEncodeBuffer;
+}
+
+int BufferPool::GetEncodeBuffer(AVCodecContext *avctx, AVPacket *pkt, int /*flags*/)
+{
+    auto *self = static_cast<BufferPool *>(avctx->opaque);
+    AVBufferRef *buf = self->Get(pkt->size);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    pkt->buf = buf;
+    pkt->data = buf->data;
+    std::memset(pkt->data + pkt->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    return 0;
+}
+
+FramePool::~FramePool()
+{
+    av_buffer_pool_uninit(&pool);
+}
+
+int FramePool::GetBuffer(AVFrame *frame)
+{
+    AVPixelFormat fmt = static_cast<AVPixelFormat>(frame->format);
+    int ret = av_image_fill_linesizes(frame->linesize, fmt, FFALIGN(frame->width, kAlign));
+    if (ret < 0)
+        return ret;
+    ptrdiff_t linesizes[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        frame->linesize[i] = FFALIGN(frame->linesize[i], kAlign);
+        linesizes[i] = frame->linesize[i];
+    }
+    // 高度补齐到 32 行，与 av_frame_get_buffer 一致（缩放 / 编码的 SIMD 可能读越过最后一行）
+    int height = FFALIGN(frame->height, 32);
+    size_t sizes[4];
+    if ((ret = av_image_fill_plane_sizes(sizes, fmt, height, linesizes)) < 0)
+        return ret;
+    // 每个平面起点按 kAlign 对齐
+    size_t total = 0;
+    for (size_t s : sizes)
+        total += FFALIGN(s, kAlign);
+
+    if (!pool || pool_size != total)
+    {
+        av_buffer_pool_uninit(&pool);
+        pool = av_buffer_pool_init(total + kAlign, nullptr);
+        pool_size = total;
+        if (!pool)
+            return AVERROR(ENOMEM);
+    }
+    frame->buf[0] = av_buffer_pool_get(pool);
+    if (!frame->buf[0])
+        return AVERROR(ENOMEM);
+
+    uint8_t *p = reinterpret_cast<uint8_t *>(FFALIGN(reinterpret_cast<uintptr_t>(frame->buf[0]->data), kAlign));
+    for (int i = 0; i < 4; ++i)
+    {
+        frame->data[i] = sizes[i] ? p : nullptr;
+        p += FFALIGN(sizes[i], kAlign);
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+/**
+ * 热路径上的缓冲池 (AVBufferPool 实现，线程安全)
+ *      BufferPool: 编码输出的字节缓冲，按 2 的幂分级；也可作为编码器的 get_encode_buffer，
+ *                  包的数据直接落在池中的缓冲上，读者 / JS 释放最后一个引用后自动回池
+ *      FramePool:  固定尺寸的 YUV 帧缓冲，平面布局与 av_frame_get_buffer 相同，尺寸变化时换一个池
+ * 池销毁时仍被引用的缓冲照常可用，最后一个引用释放时才真正回收
+ */
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "SharedBuffer.h"
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+}
+
+class BufferPool
+{
+public:
+    BufferPool() = default;
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+    ~BufferPool();
+
+    // 取一块可写缓冲：至少 size + AV_INPUT_BUFFER_PADDING_SIZE 字节，超出分级上限时直接分配
+    AVBufferRef *Get(size_t size);
+    // 拷入池中的一块，返回只读共享缓冲
+    SharedBuffer Copy(const uint8_t *data, size_t size);
+
+    // 让编码器的输出包从本池取缓冲（avctx->opaque 指向本池，须在 avcodec_open2 之前调用）
+    void Attach(AVCodecContext *avctx);
+
+private:
+    static int GetEncodeBuffer(AVCodecContext *avctx, AVPacket *pkt, int flags);
+
+    static constexpr int kMinBits = 12; // 最小一级 4 KB
+    static constexpr int kClasses = 16; // 最大一级 128 MB
+
+    std::mutex mtx; // 只保护各级池的创建，取用由 AVBufferPool 自身保证线程安全
+    AVBufferPool *classes[kClasses] = {};
+};
+
+class FramePool
+{
+public:
+    FramePool() = default;
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+    ~FramePool();
+
+    // 按 frame 已设置的 format / width / height 分配缓冲，成功返回 0
+    int GetBuffer(AVFrame *frame);
+
+private:
+    static constexpr int kAlign = 64;
+
+    AVBufferPool *pool = nullptr;
+    size_t pool_size = 0;
+};
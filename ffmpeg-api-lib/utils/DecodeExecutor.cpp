@@ -0,0 +1,186 @@
+#include "DecodeExecutor.h"
+#include <algorithm>
+
+namespace
+{
+    // 当前线程所属的工作队列下标，非工作线程为 -1
+    thread_local int t_worker_index = -1;
+}
+
+DecodeExecutor::DecodeExecutor(unsigned threadCount, PresentScheduler *scheduler) : scheduler_(scheduler)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 0; i < threadCount; ++i)
+        queues_.push_back(std::make_unique<WorkerQueue>());
+    for (unsigned i = 0; i < threadCount; ++i)
+        workers_.emplace_back(&DecodeExecutor::WorkerLoop, this, i);
+}
+
+DecodeExecutor::~DecodeExecutor()
+{
+    Shutdown();
+}
+
+void DecodeExecutor::Shutdown()
+{
+    stop_ = true;
+    {
+        std::lock_guard<std::mutex> lk(idle_mtx_);
+    }
+    idle_cv_.notify_all();
+
+    for (auto &t : workers_)
+        if (t.joinable())
+            t.join();
+    // 工作线程都已退出，不会再有任务挂到调度器上；之后的定时回调只入队不执行
+    scheduler_ = nullptr;
+    own_scheduler_.reset();
+}
+
+void DecodeExecutor::Wake(const std::shared_ptr<DecodeTask> &task)
+{
+    if (!task)
+        return;
+    task->notified = true;
+    if (!task->scheduled.exchange(true))
+    {
+        Push(task);
+        return;
+    }
+    // 正在睡眠：抢到凭证就提前入队，调度器上的条目到期时发现凭证已失效会直接丢弃
+    uint64_t token = task->sleep_token.load();
+    if (token != 0 && task->sleep_token.compare_exchange_strong(token, 0))
+        Push(task);
+}
+
+void DecodeExecutor::Push(std::shared_ptr<DecodeTask> task)
+{
+    // 工作线程优先放入自己的队列，外部线程轮询分发
+    unsigned idx = t_worker_index >= 0
+                       ? static_cast<unsigned>(t_worker_index)
+                       : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lk(queues_[idx]->mtx);
+        queues_[idx]->tasks.push_back(std::move(task));
+    }
+    pending_.fetch_add(1);
+    if (idle_.load() > 0)
+    {
+        std::lock_guard<std::mutex> lk(idle_mtx_);
+        idle_cv_.notify_one();
+    }
+}
+
+bool DecodeExecutor::Pop(unsigned self, std::shared_ptr<DecodeTask> &out)
+{
+    // 1. 自己的队列：从头部取，保证本地多路流轮转
+    {
+        auto &q = *queues_[self];
+        std::lock_guard<std::mutex> lk(q.mtx);
+        if (!q.tasks.empty())
+        {
+            out = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            pending_.fetch_sub(1);
+            return true;
+        }
+    }
+    // 2. 窃取：从其他队列尾部取
+    const unsigned n = static_cast<unsigned>(queues_.size());
+    for (unsigned i = 1; i < n; ++i)
+    {
+        auto &q = *queues_[(self + i) % n];
+        std::unique_lock<std::mutex> lk(q.mtx, std::try_to_lock);
+        if (!lk.owns_lock() || q.tasks.empty())
+            continue;
+        out = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        pending_.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void DecodeExecutor::Run(std::shared_ptr<DecodeTask> task)
+{
+    task->notified = false;
+    StepResult r = task->step(*task);
+    switch (r)
+    {
+    case StepResult::Yield:
+        Push(std::move(task));
+        break;
+    case StepResult::Sleep:
+        AddTimer(std::move(task));
+        break;
+    case StepResult::Block:
+        // 先释放调度权，再检查执行期间是否有人 Wake 过，避免丢失唤醒
+        task->scheduled = false;
+        if (task->notified && !task->scheduled.exchange(true))
+            Push(std::move(task));
+        break;
+    case StepResult::Done:
+        // scheduled 保持为 true，后续 Wake 不再入队
+        break;
+    }
+}
+
+void DecodeExecutor::AddTimer(std::shared_ptr<DecodeTask> task)
+{
+    PresentScheduler *scheduler = scheduler_.load();
+    if (!scheduler)
+    {
+        // 没有注入共用调度器：只有真的需要定时的执行器才多出一个调度线程
+        std::call_once(own_scheduler_once_, [this]
+                       {
+            own_scheduler_ = std::make_unique<PresentScheduler>(&DecodeExecutor::Fire);
+            scheduler_ = own_scheduler_.get(); });
+        scheduler = scheduler_.load();
+    }
+    uint64_t token = next_token_.fetch_add(1);
+    task->sleeper = this;
+    task->sleep_token = token;
+    scheduler->Schedule(task->wake_at, token, task);
+    // 执行期间已有人 Wake（seek / stop 等）：不必睡满，立即重新入队
+    if (task->notified && task->sleep_token.compare_exchange_strong(token, 0))
+        Push(std::move(task));
+}
+
+void DecodeExecutor::Fire(std::shared_ptr<DecodeTask> task, uint64_t token, int64_t lateUs)
+{
+    DecodeExecutor *owner = task->sleeper;
+    if (owner)
+        owner->OnTimer(std::move(task), token, lateUs);
+}
+
+void DecodeExecutor::OnTimer(std::shared_ptr<DecodeTask> task, uint64_t token, int64_t lateUs)
+{
+    // 凭证不符说明已被提前唤醒（甚至已再次入睡），本条目作废
+    if (!task->sleep_token.compare_exchange_strong(token, 0))
+        return;
+    task->jitter.Record(lateUs);
+    Push(std::move(task));
+}
+
+void DecodeExecutor::WorkerLoop(unsigned self)
+{
+    t_worker_index = static_cast<int>(self);
+    std::shared_ptr<DecodeTask> task;
+    while (!stop_)
+    {
+        if (Pop(self, task))
+        {
+            Run(std::move(task));
+            task.reset();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(idle_mtx_);
+        idle_.fetch_add(1);
+        idle_cv_.wait(lk, [&]
+                      { return stop_ || pending_.load() > 0; });
+        idle_.fetch_sub(1);
+    }
+}
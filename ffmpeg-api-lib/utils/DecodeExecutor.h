@@ -0,0 +1,106 @@
+#pragma once
+/**
+ * 解码执行器 固定数量的工作线程 + 工作窃取，替代"每路流一个线程"
+ * 每路流被包装成一个可重入的 DecodeTask，每次 step 只处理一小段工作
+ * (读一个包 -> 解码 -> 滤镜 -> 编码) 然后让出线程
+ * step 返回值:
+ *      Yield  还有工作，重新入队
+ *      Sleep  交给呈现调度器，等到 wake_at 再执行 (帧同步)；期间的 Wake 会提前唤醒
+ *      Block  等待外部 Wake (暂停等)
+ *      Done   任务结束，不再调度
+ */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PresentScheduler.h"
+
+class DecodeExecutor;
+
+enum class StepResult
+{
+    Yield,
+    Sleep,
+    Block,
+    Done
+};
+
+struct DecodeTask
+{
+    using Clock = std::chrono::steady_clock;
+
+    explicit DecodeTask(std::function<StepResult(DecodeTask &)> fn) : step(std::move(fn)) {}
+
+    std::function<StepResult(DecodeTask &)> step;
+    // Sleep 时由 step 填写的唤醒时刻
+    Clock::time_point wake_at{};
+
+    // 调度状态：scheduled=true 表示任务已在队列/定时器中或正在执行
+    std::atomic<bool> scheduled{false};
+    // 执行期间收到的 Wake，Block 之后据此决定是否立即重新入队
+    std::atomic<bool> notified{false};
+    // 睡眠凭证：非 0 表示正挂在调度器上，定时到期与提前唤醒谁先把它换成 0 谁负责入队
+    std::atomic<uint64_t> sleep_token{0};
+    // 让任务睡眠的执行器，调度器到期后交回给它（多个执行器共用一个调度器）
+    DecodeExecutor *sleeper = nullptr;
+    // 该任务每次定时唤醒的抖动
+    JitterHistogram jitter;
+};
+
+class DecodeExecutor
+{
+public:
+    // threadCount 为 0 时按 CPU 核数创建；scheduler 为共用的呈现调度器（到期回调须为 Fire），
+    // 由调用方持有，须在本执行器 Shutdown 之后、析构之前停止；为空时第一次有任务 Sleep 才自建一个
+    explicit DecodeExecutor(unsigned threadCount = 0, PresentScheduler *scheduler = nullptr);
+    ~DecodeExecutor();
+
+    DecodeExecutor(const DecodeExecutor &) = delete;
+    DecodeExecutor &operator=(const DecodeExecutor &) = delete;
+
+    // 停止并回收所有线程，之后的 Wake 只入队不执行；析构时自动调用
+    void Shutdown();
+
+    // 唤醒任务：未调度则入队，正在睡眠则提前唤醒，正在执行则标记 notified
+    void Wake(const std::shared_ptr<DecodeTask> &task);
+
+    unsigned ThreadCount() const { return static_cast<unsigned>(workers_.size()); }
+
+    // 共用调度器的到期回调：交回给让任务睡眠的执行器
+    static void Fire(std::shared_ptr<DecodeTask> task, uint64_t token, int64_t lateUs);
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mtx;
+        std::deque<std::shared_ptr<DecodeTask>> tasks;
+    };
+
+    void Push(std::shared_ptr<DecodeTask> task);
+    bool Pop(unsigned self, std::shared_ptr<DecodeTask> &out);
+    void Run(std::shared_ptr<DecodeTask> task);
+    void AddTimer(std::shared_ptr<DecodeTask> task);
+    void OnTimer(std::shared_ptr<DecodeTask> task, uint64_t token, int64_t lateUs);
+    void WorkerLoop(unsigned self);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<unsigned> next_queue_{0};
+    std::atomic<int> pending_{0};
+    std::atomic<int> idle_{0};
+    std::mutex idle_mtx_;
+    std::condition_variable idle_cv_;
+
+    // 共用的调度器，或第一次 Sleep 时自建的 own_scheduler_；只在工作线程上使用
+    std::atomic<PresentScheduler *> scheduler_{nullptr};
+    std::unique_ptr<PresentScheduler> own_scheduler_;
+    std::once_flag own_scheduler_once_;
+    std::atomic<uint64_t> next_token_{1};
+
+    std::atomic<bool> stop_{false};
+};
@@ -0,0 +1,725 @@
+#include "FrameScaler.h"
+#include <algorithm>
+#include <utility>
+
+extern "C"
+{
+#include <libavutil/imgutils.h>
+}
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCALER_USE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCALER_USE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCALER_USE_NEON 1
+#endif
+
+namespace
+{
+#if defined(SCALER_USE_SSE2)
+    // 16 个字节两两相加，得到 8 个 16 位和
+    inline __m128i PairSums(__m128i v)
+    {
+        const __m128i lo = _mm_set1_epi16(0x00FF);
+        return _mm_add_epi16(_mm_and_si128(v, lo), _mm_srli_epi16(v, 8));
+    }
+#endif
+#if defined(SCALER_USE_AVX2)
+    inline __m256i PairSums(__m256i v)
+    {
+        const __m256i lo = _mm256_set1_epi16(0x00FF);
+        return _mm256_add_epi16(_mm256_and_si256(v, lo), _mm256_srli_epi16(v, 8));
+    }
+#endif
+
+    // 2:1 盒式平均：dst[i] = (2x2 块之和 + 2) >> 2
+    void Box2Row(const uint8_t *r0, const uint8_t *r1, uint8_t *dst, int w)
+    {
+        int i = 0;
+#if defined(SCALER_USE_AVX2)
+        const __m256i two256 = _mm256_set1_epi16(2);
+        for (; i + 32 <= w; i += 32)
+        {
+            const uint8_t *a = r0 + 2 * i;
+            const uint8_t *b = r1 + 2 * i;
+            __m256i s0 = _mm256_add_epi16(PairSums(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a))),
+                                          PairSums(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b))));
+            __m256i s1 = _mm256_add_epi16(PairSums(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + 32))),
+                                          PairSums(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + 32))));
+            s0 = _mm256_srli_epi16(_mm256_add_epi16(s0, two256), 2);
+            s1 = _mm256_srli_epi16(_mm256_add_epi16(s1, two256), 2);
+            // packus 按 128 位通道交错，重排回顺序
+            __m256i out = _mm256_permute4x64_epi64(_mm256_packus_epi16(s0, s1), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), out);
+        }
+#endif
+#if defined(SCALER_USE_SSE2)
+        const __m128i two = _mm_set1_epi16(2);
+        for (; i + 16 <= w; i += 16)
+        {
+            const uint8_t *a = r0 + 2 * i;
+            const uint8_t *b = r1 + 2 * i;
+            __m128i s0 = _mm_add_epi16(PairSums(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a))),
+                                       PairSums(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b))));
+            __m128i s1 = _mm_add_epi16(PairSums(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + 16))),
+                                       PairSums(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + 16))));
+            s0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+            s1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(s0, s1));
+        }
+#elif defined(SCALER_USE_NEON)
+        for (; i + 16 <= w; i += 16)
+        {
+            const uint8_t *a = r0 + 2 * i;
+            const uint8_t *b = r1 + 2 * i;
+            uint16x8_t s0 = vpadalq_u8(vpaddlq_u8(vld1q_u8(a)), vld1q_u8(b));
+            uint16x8_t s1 = vpadalq_u8(vpaddlq_u8(vld1q_u8(a + 16)), vld1q_u8(b + 16));
+            vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(s0, 2), vrshrn_n_u16(s1, 2)));
+        }
+#endif
+        for (; i < w; ++i)
+        {
+            const uint8_t *a = r0 + 2 * i;
+            const uint8_t *b = r1 + 2 * i;
+            dst[i] = static_cast<uint8_t>((a[0] + a[1] + b[0] + b[1] + 2) >> 2);
+        }
+    }
+
+    // 4:1 盒式平均：dst[i] = (4x4 块之和 + 8) >> 4
+    void Box4Row(const uint8_t *const r[4], uint8_t *dst, int w)
+    {
+        int i = 0;
+#if defined(SCALER_USE_AVX2)
+        const __m256i ones256 = _mm256_set1_epi16(1);
+        const __m256i eight256 = _mm256_set1_epi32(8);
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        for (; i + 32 <= w; i += 32)
+        {
+            __m256i q[4];
+            for (int k = 0; k < 4; ++k)
+            {
+                int off = 4 * i + 32 * k;
+                __m256i s = PairSums(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(r[0] + off)));
+                for (int row = 1; row < 4; ++row)
+                    s = _mm256_add_epi16(s, PairSums(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(r[row] + off))));
+                q[k] = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(s, ones256), eight256), 4);
+            }
+            __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(q[0], q[1]), _mm256_packs_epi32(q[2], q[3]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_permutevar8x32_epi32(packed, order));
+        }
+#endif
+#if defined(SCALER_USE_SSE2)
+        const __m128i ones = _mm_set1_epi16(1);
+        const __m128i eight = _mm_set1_epi32(8);
+        for (; i + 16 <= w; i += 16)
+        {
+            __m128i q[4];
+            for (int k = 0; k < 4; ++k)
+            {
+                int off = 4 * i + 16 * k;
+                __m128i s = PairSums(_mm_loadu_si128(reinterpret_cast<const __m128i *>(r[0] + off)));
+                for (int row = 1; row < 4; ++row)
+                    s = _mm_add_epi16(s, PairSums(_mm_loadu_si128(reinterpret_cast<const __m128i *>(r[row] + off))));
+                q[k] = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(s, ones), eight), 4);
+            }
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), packed);
+        }
+#elif defined(SCALER_USE_NEON)
+        for (; i + 16 <= w; i += 16)
+        {
+            uint16x4_t q[4];
+            for (int k = 0; k < 4; ++k)
+            {
+                int off = 4 * i + 16 * k;
+                uint16x8_t s = vpaddlq_u8(vld1q_u8(r[0] + off));
+                s = vpadalq_u8(s, vld1q_u8(r[1] + off));
+                s = vpadalq_u8(s, vld1q_u8(r[2] + off));
+                s = vpadalq_u8(s, vld1q_u8(r[3] + off));
+                q[k] = vrshrn_n_u32(vpaddlq_u16(s), 4);
+            }
+            vst1q_u8(dst + i, vcombine_u8(vmovn_u16(vcombine_u16(q[0], q[1])), vmovn_u16(vcombine_u16(q[2], q[3]))));
+        }
+#endif
+        for (; i < w; ++i)
+        {
+            unsigned sum = 0;
+            for (int row = 0; row < 4; ++row)
+                for (int k = 0; k < 4; ++k)
+                    sum += r[row][4 * i + k];
+            dst[i] = static_cast<uint8_t>((sum + 8) >> 4);
+        }
+    }
+
+    // 双线性水平插值：输出 8.8 定点
+    void HLerpRow(const uint8_t *src, const int *xi, const uint16_t *xf, uint16_t *dst, int w)
+    {
+        for (int i = 0; i < w; ++i)
+        {
+            const uint8_t *p = src + xi[i];
+            dst[i] = static_cast<uint16_t>(p[0] * (256 - xf[i]) + p[1] * xf[i]);
+        }
+    }
+
+    // 双线性垂直插值：fy 取 (0, 256)，两端由调用方走 NarrowRow
+    void VLerpRow(const uint16_t *a, const uint16_t *b, int fy, uint8_t *dst, int w)
+    {
+        const auto w0 = static_cast<uint16_t>((256 - fy) << 8);
+        const auto w1 = static_cast<uint16_t>(fy << 8);
+        int i = 0;
+#if defined(SCALER_USE_AVX2)
+        const __m256i vw0_256 = _mm256_set1_epi16(static_cast<short>(w0));
+        const __m256i vw1_256 = _mm256_set1_epi16(static_cast<short>(w1));
+        const __m256i half256 = _mm256_set1_epi16(128);
+        for (; i + 32 <= w; i += 32)
+        {
+            __m256i s[2];
+            for (int k = 0; k < 2; ++k)
+            {
+                __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 16 * k));
+                __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i + 16 * k));
+                __m256i v = _mm256_add_epi16(_mm256_mulhi_epu16(x, vw0_256), _mm256_mulhi_epu16(y, vw1_256));
+                s[k] = _mm256_srli_epi16(_mm256_add_epi16(v, half256), 8);
+            }
+            __m256i out = _mm256_permute4x64_epi64(_mm256_packus_epi16(s[0], s[1]), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), out);
+        }
+#endif
+#if defined(SCALER_USE_SSE2)
+        const __m128i vw0 = _mm_set1_epi16(static_cast<short>(w0));
+        const __m128i vw1 = _mm_set1_epi16(static_cast<short>(w1));
+        const __m128i half = _mm_set1_epi16(128);
+        for (; i + 16 <= w; i += 16)
+        {
+            __m128i s[2];
+            for (int k = 0; k < 2; ++k)
+            {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 8 * k));
+                __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i + 8 * k));
+                __m128i v = _mm_add_epi16(_mm_mulhi_epu16(x, vw0), _mm_mulhi_epu16(y, vw1));
+                s[k] = _mm_srli_epi16(_mm_add_epi16(v, half), 8);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(s[0], s[1]));
+        }
+#elif defined(SCALER_USE_NEON)
+        const uint16x4_t vw0 = vdup_n_u16(w0);
+        const uint16x4_t vw1 = vdup_n_u16(w1);
+        for (; i + 16 <= w; i += 16)
+        {
+            uint8x8_t s[2];
+            for (int k = 0; k < 2; ++k)
+            {
+                uint16x8_t x = vld1q_u16(a + i + 8 * k);
+                uint16x8_t y = vld1q_u16(b + i + 8 * k);
+                uint16x8_t hx = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(x), vw0), 16),
+                                             vshrn_n_u32(vmull_u16(vget_high_u16(x), vw0), 16));
+                uint16x8_t hy = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(y), vw1), 16),
+                                             vshrn_n_u32(vmull_u16(vget_high_u16(y), vw1), 16));
+                s[k] = vrshrn_n_u16(vaddq_u16(hx, hy), 8);
+            }
+            vst1q_u8(dst + i, vcombine_u8(s[0], s[1]));
+        }
+#endif
+        for (; i < w; ++i)
+        {
+            unsigned v = ((a[i] * unsigned{w0}) >> 16) + ((b[i] * unsigned{w1}) >> 16);
+            dst[i] = static_cast<uint8_t>((v + 128) >> 8);
+        }
+    }
+
+    void NarrowRow(const uint16_t *a, uint8_t *dst, int w)
+    {
+        for (int i = 0; i < w; ++i)
+            dst[i] = static_cast<uint8_t>((a[i] + 128u) >> 8);
+    }
+
+    // 源坐标映射 (像素中心对齐)：16.16 定点 -> 整数下标 + 8 位小数
+    // 保证 idx + 1 不越界，最后一个像素用 idx = n - 2, frac = 256 表示
+    void MapAxis(int src, int dst, int i, int &idx, int &frac)
+    {
+        int64_t step = (static_cast<int64_t>(src) << 16) / dst;
+        int64_t pos = step / 2 - 0x8000 + step * i;
+        if (pos < 0)
+            pos = 0;
+        idx = static_cast<int>(pos >> 16);
+        frac = static_cast<int>((pos >> 8) & 0xFF);
+        if (idx >= src - 1)
+        {
+            idx = src - 2;
+            frac = 256;
+        }
+    }
+
+    // 两行取平均 (4:2:2 色度纵向抽取)
+    void AvgRows(const uint8_t *a, const uint8_t *b, uint8_t *dst, int w)
+    {
+        int i = 0;
+#if defined(SCALER_USE_SSE2)
+        for (; i + 16 <= w; i += 16)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+            __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_avg_epu8(x, y));
+        }
+#elif defined(SCALER_USE_NEON)
+        for (; i + 16 <= w; i += 16)
+            vst1q_u8(dst + i, vrhaddq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+#endif
+        for (; i < w; ++i)
+            dst[i] = static_cast<uint8_t>((a[i] + b[i] + 1) >> 1);
+    }
+
+    // 从交错的 UV 行中取出一个分量 (NV12 / NV21)
+    void DeinterleaveRow(const uint8_t *src, int comp, uint8_t *dst, int w)
+    {
+        int i = 0;
+#if defined(SCALER_USE_SSE2)
+        const __m128i lo = _mm_set1_epi16(0x00FF);
+        for (; i + 16 <= w; i += 16)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i + 16));
+            if (comp)
+            {
+                a = _mm_srli_epi16(a, 8);
+                b = _mm_srli_epi16(b, 8);
+            }
+            else
+            {
+                a = _mm_and_si128(a, lo);
+                b = _mm_and_si128(b, lo);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(a, b));
+        }
+#elif defined(SCALER_USE_NEON)
+        for (; i + 16 <= w; i += 16)
+            vst1q_u8(dst + i, vld2q_u8(src + 2 * i).val[comp]);
+#endif
+        for (; i < w; ++i)
+            dst[i] = src[2 * i + comp];
+    }
+
+    void ApplyLut(const uint8_t *src, uint8_t *dst, const uint8_t *lut, int w)
+    {
+        for (int i = 0; i < w; ++i)
+            dst[i] = lut[src[i]];
+    }
+
+    // 有限范围 -> 全范围，作用在缩放后的输出行上，省掉一遍整帧转换
+    struct RangeLut
+    {
+        uint8_t luma[256];
+        uint8_t chroma[256];
+        RangeLut()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                luma[i] = static_cast<uint8_t>(std::clamp(((i - 16) * 255 * 2 + 219) / (219 * 2), 0, 255));
+                int c = (i - 128) * 255 * 2;
+                c = c >= 0 ? (c + 224) / (224 * 2) : -((-c + 224) / (224 * 2));
+                chroma[i] = static_cast<uint8_t>(std::clamp(c + 128, 0, 255));
+            }
+        }
+    };
+
+    const RangeLut &Range()
+    {
+        static const RangeLut lut;
+        return lut;
+    }
+
+    // 行来源：把各种输入平面统一成 "第 r 行的 8 位样本"
+    // 需要变换的来源写进 4 行的环形暂存区，足够 4:1 盒式平均同时持有 4 行
+    struct PlaneRows
+    {
+        const uint8_t *base;
+        int stride;
+        const uint8_t *Row(int r) const { return base + static_cast<ptrdiff_t>(r) * stride; }
+    };
+
+    // 4:2:2 色度：相邻两行取平均，与裁剪一起完成 4:2:2 -> 4:2:0
+    struct DecimatedRows
+    {
+        const uint8_t *base;
+        int stride;
+        int w;
+        int rows; // 源行数，奇数时最后一行与自身平均
+        uint8_t *scratch;
+        const uint8_t *Row(int r) const
+        {
+            uint8_t *out = scratch + static_cast<ptrdiff_t>(r & 3) * w;
+            const uint8_t *a = base + static_cast<ptrdiff_t>(2 * r) * stride;
+            const uint8_t *b = base + static_cast<ptrdiff_t>(std::min(2 * r + 1, rows - 1)) * stride;
+            AvgRows(a, b, out, w);
+            return out;
+        }
+    };
+
+    struct InterleavedRows
+    {
+        const uint8_t *base;
+        int stride;
+        int w;
+        int comp;
+        uint8_t *scratch;
+        const uint8_t *Row(int r) const
+        {
+            uint8_t *out = scratch + static_cast<ptrdiff_t>(r & 3) * w;
+            DeinterleaveRow(base + static_cast<ptrdiff_t>(r) * stride, comp, out, w);
+            return out;
+        }
+    };
+
+    // 调色板索引经查表得到 Y / U / V 之一
+    struct PaletteRows
+    {
+        const uint8_t *base;
+        int stride;
+        int w;
+        const uint8_t *lut;
+        uint8_t *scratch;
+        const uint8_t *Row(int r) const
+        {
+            uint8_t *out = scratch + static_cast<ptrdiff_t>(r & 3) * w;
+            ApplyLut(base + static_cast<ptrdiff_t>(r) * stride, out, lut, w);
+            return out;
+        }
+    };
+
+    // yuvj 系列在 swscale 中已弃用：换成对应的 yuv 格式并显式给出全范围
+    AVPixelFormat Unjpeg(AVPixelFormat fmt, bool &fullRange)
+    {
+        switch (fmt)
+        {
+        case AV_PIX_FMT_YUVJ420P:
+            fullRange = true;
+            return AV_PIX_FMT_YUV420P;
+        case AV_PIX_FMT_YUVJ422P:
+            fullRange = true;
+            return AV_PIX_FMT_YUV422P;
+        case AV_PIX_FMT_YUVJ444P:
+            fullRange = true;
+            return AV_PIX_FMT_YUV444P;
+        default:
+            return fmt;
+        }
+    }
+}
+
+FrameScaler::~FrameScaler()
+{
+    Reset();
+}
+
+void FrameScaler::Reset()
+{
+    sws_freeContext(sws_);
+    sws_ = nullptr;
+    std::fill(sws_key_, sws_key_ + 8, 0);
+    convert_ = nullptr;
+    sel_fmt_ = AV_PIX_FMT_NONE;
+}
+
+bool FrameScaler::Supports(const AVFrame *in)
+{
+    auto fmt = static_cast<AVPixelFormat>(in->format);
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM)))
+        return false;
+    return sws_isSupportedInput(fmt) > 0;
+}
+
+FrameScaler::Kernel FrameScaler::Pick(int sw, int sh, int dw, int dh)
+{
+    if (sw == dw && sh == dh)
+        return Kernel::Copy;
+    if (sw == 2 * dw && sh == 2 * dh)
+        return Kernel::Box2;
+    if (sw == 4 * dw && sh == 4 * dh)
+        return Kernel::Box4;
+    // 缩小不超过 2 倍时双线性不会漏采样，再往下交给 swscale
+    if (sw >= 2 && sh >= 2 && sw >= dw && sw <= 2 * dw && sh >= dh && sh <= 2 * dh)
+        return Kernel::Bilinear;
+    return Kernel::None;
+}
+
+FrameScaler::ConvertFn FrameScaler::Select(AVPixelFormat fmt, bool fullRange)
+{
+    switch (fmt)
+    {
+    case AV_PIX_FMT_YUV420P:
+        return fullRange ? &FrameScaler::Convert<Layout::Planar420, false> : &FrameScaler::Convert<Layout::Planar420, true>;
+    case AV_PIX_FMT_YUV422P:
+        return fullRange ? &FrameScaler::Convert<Layout::Planar422, false> : &FrameScaler::Convert<Layout::Planar422, true>;
+    case AV_PIX_FMT_YUV444P:
+        return fullRange ? &FrameScaler::Convert<Layout::Planar444, false> : &FrameScaler::Convert<Layout::Planar444, true>;
+    case AV_PIX_FMT_NV12:
+        return fullRange ? &FrameScaler::Convert<Layout::SemiUV, false> : &FrameScaler::Convert<Layout::SemiUV, true>;
+    case AV_PIX_FMT_NV21:
+        return fullRange ? &FrameScaler::Convert<Layout::SemiVU, false> : &FrameScaler::Convert<Layout::SemiVU, true>;
+    case AV_PIX_FMT_PAL8:
+        return &FrameScaler::Convert<Layout::Palette, false>;
+    default:
+        return nullptr;
+    }
+}
+
+bool FrameScaler::Scale(const AVFrame *in, int x, int y, int w, int h, AVFrame *out)
+{
+    auto fmt = static_cast<AVPixelFormat>(in->format);
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    if (!desc)
+        return false;
+
+    // 1. 裁剪：起点对齐色度网格，区域夹到帧内
+    x &= ~((1 << desc->log2_chroma_w) - 1);
+    y &= ~((1 << desc->log2_chroma_h) - 1);
+    w = std::min(w, in->width - x);
+    h = std::min(h, in->height - y);
+    if (x < 0 || y < 0 || w <= 0 || h <= 0)
+        return false;
+
+    int steps[4];
+    av_image_fill_max_pixsteps(steps, nullptr, desc);
+    const uint8_t *src[4] = {};
+    int stride[4] = {};
+    for (int p = 0; p < 4; ++p)
+    {
+        if (!in->data[p])
+            break;
+        stride[p] = in->linesize[p];
+        // 调色板不是图像平面，原样传递
+        if (p == 1 && (desc->flags & AV_PIX_FMT_FLAG_PAL))
+        {
+            src[p] = in->data[p];
+            continue;
+        }
+        bool chroma = p == 1 || p == 2;
+        int sx = chroma ? x >> desc->log2_chroma_w : x;
+        int sy = chroma ? y >> desc->log2_chroma_h : y;
+        src[p] = in->data[p] + static_cast<ptrdiff_t>(sy) * in->linesize[p] + static_cast<ptrdiff_t>(sx) * steps[p];
+    }
+
+    // 2. 按 (格式, 范围) 选定专用转换，只在输入变化时重新选择
+    bool fullRange = in->color_range == AVCOL_RANGE_JPEG;
+    AVPixelFormat base = Unjpeg(fmt, fullRange);
+    if (in->format != sel_fmt_ || fullRange != sel_range_)
+    {
+        convert_ = Select(base, fullRange);
+        sel_fmt_ = in->format;
+        sel_range_ = fullRange;
+    }
+    // 3. 比例不在手写内核范围内、没有专用转换的格式或 rgba 输出，交给 swscale
+    if (convert_ && out->format != AV_PIX_FMT_RGBA && (this->*convert_)(src, stride, w, h, out))
+        return true;
+    return ScaleSws(in, src, stride, w, h, out);
+}
+
+template <FrameScaler::Layout L, bool Expand>
+bool FrameScaler::Convert(const uint8_t *const src[4], const int stride[4], int w, int h, AVFrame *out)
+{
+    // 4:4:4 与调色板的色度是全分辨率，其余按 4:2:0 几何 (4:2:2 纵向抽取后)
+    constexpr bool fullChroma = L == Layout::Planar444 || L == Layout::Palette;
+    int cw = fullChroma ? w : (w + 1) >> 1;
+    int ch = fullChroma ? h : (h + 1) >> 1;
+    int dw[2] = {out->width, (out->width + 1) >> 1};
+    int dh[2] = {out->height, (out->height + 1) >> 1};
+    Kernel ky = Pick(w, h, dw[0], dh[0]);
+    Kernel kc = Pick(cw, ch, dw[1], dh[1]);
+    if (ky == Kernel::None || kc == Kernel::None)
+        return false;
+
+    const uint8_t *lumaLut = Expand ? Range().luma : nullptr;
+    const uint8_t *chromaLut = Expand ? Range().chroma : nullptr;
+    bool semi = out->format == AV_PIX_FMT_NV12;
+    auto chromaPlane = [&](int p, auto rows)
+    {
+        if (semi)
+            ScalePlane(kc, rows, cw, ch, Planar(p - 1, dw[1], dh[1]), dw[1], dw[1], dh[1], chromaLut);
+        else
+            ScalePlane(kc, rows, cw, ch, out->data[p], out->linesize[p], dw[1], dh[1], chromaLut);
+    };
+
+    if constexpr (L == Layout::Palette)
+    {
+        BuildPalette(reinterpret_cast<const uint32_t *>(src[1]));
+        ScalePlane(ky, PaletteRows{src[0], stride[0], w, pal_[0], Scratch(0, w)}, w, h,
+                   out->data[0], out->linesize[0], dw[0], dh[0], nullptr);
+        for (int p = 1; p < 3; ++p)
+            chromaPlane(p, PaletteRows{src[0], stride[0], w, pal_[p], Scratch(p, w)});
+    }
+    else
+    {
+        ScalePlane(ky, PlaneRows{src[0], stride[0]}, w, h, out->data[0], out->linesize[0], dw[0], dh[0], lumaLut);
+        for (int p = 1; p < 3; ++p)
+        {
+            if constexpr (L == Layout::Planar422)
+                chromaPlane(p, DecimatedRows{src[p], stride[p], cw, h, Scratch(p, cw)});
+            else if constexpr (L == Layout::SemiUV || L == Layout::SemiVU)
+                chromaPlane(p, InterleavedRows{src[1], stride[1], cw, (p == 1) == (L == Layout::SemiUV) ? 0 : 1, Scratch(p, cw)});
+            else
+                chromaPlane(p, PlaneRows{src[p], stride[p]});
+        }
+    }
+    if (semi)
+        InterleaveChroma(out, dw[1], dh[1]);
+    return true;
+}
+
+template <class Rows>
+void FrameScaler::ScalePlane(Kernel k, const Rows &rows, int sw, int sh, uint8_t *dst, int dstStride, int dw, int dh, const uint8_t *lut)
+{
+    // 范围转换紧跟在每个输出行之后，数据还在缓存里
+    for (int r = 0; k != Kernel::Bilinear && r < dh; ++r)
+    {
+        uint8_t *out = dst + static_cast<ptrdiff_t>(r) * dstStride;
+        switch (k)
+        {
+        case Kernel::Copy:
+            if (lut)
+            {
+                ApplyLut(rows.Row(r), out, lut, dw);
+                continue;
+            }
+            std::copy_n(rows.Row(r), dw, out);
+            break;
+        case Kernel::Box2:
+        {
+            const uint8_t *r0 = rows.Row(2 * r);
+            Box2Row(r0, rows.Row(2 * r + 1), out, dw);
+            break;
+        }
+        case Kernel::Box4:
+        {
+            const uint8_t *r4[4] = {rows.Row(4 * r), rows.Row(4 * r + 1), rows.Row(4 * r + 2), rows.Row(4 * r + 3)};
+            Box4Row(r4, out, dw);
+            break;
+        }
+        default:
+            break;
+        }
+        if (lut)
+            ApplyLut(out, out, lut, dw);
+    }
+    if (k == Kernel::Bilinear)
+        Bilinear(rows, sw, sh, dst, dstStride, dw, dh, lut);
+}
+
+template <class Rows>
+void FrameScaler::Bilinear(const Rows &rows, int sw, int sh, uint8_t *dst, int dstStride, int dw, int dh, const uint8_t *lut)
+{
+    xi_.resize(dw);
+    xf_.resize(dw);
+    for (int i = 0; i < dw; ++i)
+    {
+        int idx, frac;
+        MapAxis(sw, dw, i, idx, frac);
+        xi_[i] = idx;
+        xf_[i] = static_cast<uint16_t>(frac);
+    }
+    rows_[0].resize(dw);
+    rows_[1].resize(dw);
+
+    // 两行缓存：输出行单调下移，相邻输出行通常共用源行
+    int cached[2] = {-1, -1};
+    auto row = [&](int slot, int srcRow)
+    {
+        if (cached[slot] != srcRow)
+        {
+            HLerpRow(rows.Row(srcRow), xi_.data(), xf_.data(), rows_[slot].data(), dw);
+            cached[slot] = srcRow;
+        }
+        return rows_[slot].data();
+    };
+
+    for (int r = 0; r < dh; ++r)
+    {
+        int y0, fy;
+        MapAxis(sh, dh, r, y0, fy);
+        if (cached[1] == y0)
+        {
+            std::swap(rows_[0], rows_[1]);
+            std::swap(cached[0], cached[1]);
+        }
+        uint8_t *out = dst + static_cast<ptrdiff_t>(r) * dstStride;
+        if (fy == 0)
+            NarrowRow(row(0, y0), out, dw);
+        else if (fy == 256)
+            NarrowRow(row(1, y0 + 1), out, dw);
+        else
+            VLerpRow(row(0, y0), row(1, y0 + 1), fy, out, dw);
+        if (lut)
+            ApplyLut(out, out, lut, dw);
+    }
+}
+
+void FrameScaler::BuildPalette(const uint32_t *pal)
+{
+    // ARGB 调色板 -> 全范围 BT.601，与 swscale 对 RGB 输入的默认矩阵一致
+    for (int i = 0; i < 256; ++i)
+    {
+        int r = static_cast<int>((pal[i] >> 16) & 0xFF);
+        int g = static_cast<int>((pal[i] >> 8) & 0xFF);
+        int b = static_cast<int>(pal[i] & 0xFF);
+        pal_[0][i] = static_cast<uint8_t>(std::clamp((19595 * r + 38470 * g + 7471 * b + 32768) >> 16, 0, 255));
+        pal_[1][i] = static_cast<uint8_t>(std::clamp((-11059 * r - 21709 * g + 32768 * b + (128 << 16) + 32768) >> 16, 0, 255));
+        pal_[2][i] = static_cast<uint8_t>(std::clamp((32768 * r - 27439 * g - 5329 * b + (128 << 16) + 32768) >> 16, 0, 255));
+    }
+}
+
+uint8_t *FrameScaler::Scratch(int plane, int w)
+{
+    auto &buf = scratch_[plane];
+    buf.resize(static_cast<size_t>(w) * 4);
+    return buf.data();
+}
+
+uint8_t *FrameScaler::Planar(int plane, int w, int h)
+{
+    auto &buf = planar_[plane];
+    buf.resize(static_cast<size_t>(w) * h);
+    return buf.data();
+}
+
+void FrameScaler::InterleaveChroma(AVFrame *out, int w, int h)
+{
+    // 色度只有亮度的一半数据量，暂存仍在缓存里
+    for (int r = 0; r < h; ++r)
+    {
+        const uint8_t *u = planar_[0].data() + static_cast<size_t>(r) * w;
+        const uint8_t *v = planar_[1].data() + static_cast<size_t>(r) * w;
+        uint8_t *dst = out->data[1] + static_cast<ptrdiff_t>(r) * out->linesize[1];
+        for (int i = 0; i < w; ++i)
+        {
+            dst[2 * i] = u[i];
+            dst[2 * i + 1] = v[i];
+        }
+    }
+}
+
+bool FrameScaler::ScaleSws(const AVFrame *in, const uint8_t *const src[4], const int stride[4], int w, int h, AVFrame *out)
+{
+    bool fullRange = in->color_range == AVCOL_RANGE_JPEG;
+    AVPixelFormat fmt = Unjpeg(static_cast<AVPixelFormat>(in->format), fullRange);
+    // yuvj420p 输出按 yuv420p + 全范围设置，其余输出格式原样交给 swscale
+    AVPixelFormat dst = out->format == AV_PIX_FMT_YUVJ420P ? AV_PIX_FMT_YUV420P : static_cast<AVPixelFormat>(out->format);
+    // 与原滤镜链一致：bicubic 缩放，只做范围转换，色彩矩阵沿用输入
+    sws_ = sws_getCachedContext(sws_, w, h, fmt, out->width, out->height, dst,
+                                SWS_BICUBIC, nullptr, nullptr, nullptr);
+    if (!sws_)
+        return false;
+
+    int key[8] = {w, h, fmt, out->width, out->height, fullRange, in->colorspace, dst};
+    if (!std::equal(key, key + 8, sws_key_))
+    {
+        const int *coeffs = sws_getCoefficients(in->colorspace);
+        sws_setColorspaceDetails(sws_, coeffs, fullRange, coeffs, 1, 0, 1 << 16, 1 << 16);
+        std::copy(key, key + 8, sws_key_);
+    }
+    return sws_scale(sws_, src, stride, 0, h, out->data, out->linesize) > 0;
+}
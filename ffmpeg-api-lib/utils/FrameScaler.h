@@ -0,0 +1,97 @@
+#pragma once
+/**
+ * 原生裁剪 + 缩放，替代 crop -> scale -> format 滤镜链
+ *      1. 裁剪: 按像素格式的子采样和像素步长偏移各平面指针，不拷贝数据
+ *      2. 常见输入格式按 (pix_fmt, 范围) 选定一个模板特化的转换，输入不变就不再重新选择:
+ *         yuv420p / 422p / 444p、nv12 / nv21、pal8；有限范围在缩放后的输出行上查表扩展，
+ *         4:2:2 色度在取行时纵向抽取，nv12 在取行时解交错，pal8 经调色板查表得到 YUV
+ *      3. 缩放内核 (SSE2 / AVX2 / NEON): 1:1 拷贝、2:1 与 4:1 盒式平均、1~2 倍之间的双线性
+ *      4. 其余格式或比例交给缓存的 SwsContext (bicubic，同时完成格式和范围转换)
+ * 输出为 yuvj420p、全范围 nv12 或 rgba（由 out->format 决定）：
+ *      nv12 的色度缩放到平面暂存后交织；rgba 由 swscale 一次完成裁剪、缩放与色彩转换
+ * 硬件帧、位流格式等 swscale 不支持的输入由调用方回退到滤镜链
+ */
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+class FrameScaler
+{
+public:
+    FrameScaler() = default;
+    ~FrameScaler();
+    FrameScaler(const FrameScaler &) = delete;
+    FrameScaler &operator=(const FrameScaler &) = delete;
+
+    // 输入帧能否走原生路径
+    static bool Supports(const AVFrame *in);
+
+    // 把 in 的 (x, y, w, h) 区域缩放到 out；out 由调用方按输出尺寸和格式分配好缓冲
+    // 子采样格式的 x / y 向下对齐到色度网格（与 crop 滤镜一致）
+    bool Scale(const AVFrame *in, int x, int y, int w, int h, AVFrame *out);
+
+    // 释放缓存的 SwsContext
+    void Reset();
+
+private:
+    enum class Kernel
+    {
+        None,
+        Copy,
+        Box2,
+        Box4,
+        Bilinear
+    };
+
+    // 专用转换支持的输入布局
+    enum class Layout
+    {
+        Planar420,
+        Planar422,
+        Planar444,
+        SemiUV, // nv12
+        SemiVU, // nv21
+        Palette
+    };
+
+    // 返回 false 表示比例不在内核范围内，由调用方改走 swscale
+    using ConvertFn = bool (FrameScaler::*)(const uint8_t *const src[4], const int stride[4], int w, int h, AVFrame *out);
+    static ConvertFn Select(AVPixelFormat fmt, bool fullRange);
+    template <Layout L, bool Expand>
+    bool Convert(const uint8_t *const src[4], const int stride[4], int w, int h, AVFrame *out);
+
+    static Kernel Pick(int sw, int sh, int dw, int dh);
+    template <class Rows>
+    void ScalePlane(Kernel k, const Rows &rows, int sw, int sh, uint8_t *dst, int dstStride, int dw, int dh, const uint8_t *lut);
+    template <class Rows>
+    void Bilinear(const Rows &rows, int sw, int sh, uint8_t *dst, int dstStride, int dw, int dh, const uint8_t *lut);
+    void BuildPalette(const uint32_t *pal);
+    uint8_t *Scratch(int plane, int w);
+    // nv12 输出：先把 U / V 缩放到平面暂存，再交织写入 out->data[1]
+    uint8_t *Planar(int plane, int w, int h);
+    void InterleaveChroma(AVFrame *out, int w, int h);
+    bool ScaleSws(const AVFrame *in, const uint8_t *const src[4], const int stride[4], int w, int h, AVFrame *out);
+
+    ConvertFn convert_ = nullptr;
+    int sel_fmt_ = AV_PIX_FMT_NONE;
+    bool sel_range_ = false;
+
+    SwsContext *sws_ = nullptr;
+    // 上次设置色彩参数时的输入条件，变化时才重新调用 sws_setColorspaceDetails
+    int sws_key_[8] = {};
+
+    // 双线性：水平插值表与两行 8.8 定点的中间结果
+    std::vector<int> xi_;
+    std::vector<uint16_t> xf_;
+    std::vector<uint16_t> rows_[2];
+    // 需要变换的行来源 (抽取 / 解交错 / 查表) 的暂存行，每个平面 4 行
+    std::vector<uint8_t> scratch_[3];
+    std::vector<uint8_t> planar_[2];
+    uint8_t pal_[3][256] = {};
+};
@@ -0,0 +1,735 @@
+#include "JpegTranscoder.h"
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstring>
+
+namespace
+{
+    // ITU-T T.81 Annex K.3 的标准 Huffman 表（MJPEG 省略 DHT 时即使用这一组）
+    const uint8_t kDcLumaBits[17] = {0, 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+    const uint8_t kDcChromaBits[17] = {0, 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+    const uint8_t kDcVals[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+    const uint8_t kAcLumaBits[17] = {0, 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+    const uint8_t kAcLumaVals[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa};
+
+    const uint8_t kAcChromaBits[17] = {0, 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+    const uint8_t kAcChromaVals[162] = {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+        0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+        0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+        0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+        0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa};
+
+    struct StdSpec
+    {
+        int tcth; // DHT 中的 (Tc << 4) | Th
+        const uint8_t *bits;
+        const uint8_t *vals;
+        int count;
+    };
+    const StdSpec kStdSpecs[4] = {
+        {0x00, kDcLumaBits, kDcVals, 12},
+        {0x01, kDcChromaBits, kDcVals, 12},
+        {0x10, kAcLumaBits, kAcLumaVals, 162},
+        {0x11, kAcChromaBits, kAcChromaVals, 162},
+    };
+
+    // 0: DC 亮度 / 1: DC 色度 / 2: AC 亮度 / 3: AC 色度，首次使用时构建
+    const JpegTranscoder::HuffTable &StdTable(int i)
+    {
+        static const auto tables = []
+        {
+            std::array<JpegTranscoder::HuffTable, 4> t;
+            for (int k = 0; k < 4; ++k)
+            {
+                memcpy(t[k].bits, kStdSpecs[k].bits, 17);
+                memcpy(t[k].vals, kStdSpecs[k].vals, kStdSpecs[k].count);
+                t[k].Build();
+            }
+            return t;
+        }();
+        return tables[i];
+    }
+
+    void AppendStdDht(std::vector<uint8_t> &out)
+    {
+        size_t len = 2;
+        for (const auto &s : kStdSpecs)
+            len += 17 + s.count;
+        out.push_back(0xFF);
+        out.push_back(0xC4);
+        out.push_back(static_cast<uint8_t>(len >> 8));
+        out.push_back(static_cast<uint8_t>(len));
+        for (const auto &s : kStdSpecs)
+        {
+            out.push_back(static_cast<uint8_t>(s.tcth));
+            out.insert(out.end(), s.bits + 1, s.bits + 17);
+            out.insert(out.end(), s.vals, s.vals + s.count);
+        }
+    }
+
+    // 熵编码数据读取：去掉 0xFF00 填充，遇到标记后补 0 并记录补了多少位
+    struct BitReader
+    {
+        const uint8_t *p;
+        const uint8_t *end;
+        uint64_t acc = 0;
+        int cnt = 0;
+        int zeros = 0;
+        bool marker = false;
+
+        BitReader(const uint8_t *begin, const uint8_t *stop) : p(begin), end(stop) {}
+
+        void Fill()
+        {
+            while (cnt <= 56)
+            {
+                unsigned b = 0;
+                if (marker || p >= end)
+                    zeros += 8;
+                else if (*p != 0xFF)
+                    b = *p++;
+                else if (p + 1 < end && p[1] == 0x00)
+                {
+                    b = 0xFF;
+                    p += 2;
+                }
+                else
+                {
+                    marker = true;
+                    zeros += 8;
+                }
+                acc = (acc << 8) | b;
+                cnt += 8;
+            }
+        }
+
+        int Bits(int n)
+        {
+            if (n == 0)
+                return 0;
+            if (cnt < n)
+                Fill();
+            cnt -= n;
+            return static_cast<int>((acc >> cnt) & ((1u << n) - 1));
+        }
+
+        int Decode(const JpegTranscoder::HuffTable &t)
+        {
+            if (cnt < 16)
+                Fill();
+            uint16_t e = t.lookup[(acc >> (cnt - 9)) & 0x1FF];
+            if (e)
+            {
+                cnt -= e >> 8;
+                return e & 0xFF;
+            }
+            for (int l = 10; l <= 16; ++l)
+            {
+                int32_t code = static_cast<int32_t>((acc >> (cnt - l)) & ((1u << l) - 1));
+                if (code <= t.maxcode[l])
+                {
+                    cnt -= l;
+                    return t.vals[(t.valptr[l] + code - t.mincode[l]) & 0xFF];
+                }
+            }
+            return -1;
+        }
+
+        // 读到了标记之后的补位，说明数据被截断
+        bool Overrun() const { return zeros > cnt; }
+
+        // 丢弃字节内剩余的位，越过 RSTn
+        bool Restart()
+        {
+            if (Overrun())
+                return false;
+            acc = 0;
+            cnt = 0;
+            zeros = 0;
+            while (!marker && p + 1 < end && !(p[0] == 0xFF && p[1] != 0x00))
+                ++p;
+            while (p + 1 < end && p[0] == 0xFF && p[1] == 0xFF)
+                ++p;
+            if (p + 1 >= end || p[0] != 0xFF || p[1] < 0xD0 || p[1] > 0xD7)
+                return false;
+            p += 2;
+            marker = false;
+            return true;
+        }
+    };
+
+    struct BitWriter
+    {
+        std::vector<uint8_t> &out;
+        uint32_t acc = 0;
+        int cnt = 0;
+
+        explicit BitWriter(std::vector<uint8_t> &o) : out(o) {}
+
+        void Put(uint32_t bits, int n)
+        {
+            if (n == 0)
+                return;
+            acc = (acc << n) | (bits & ((1u << n) - 1));
+            cnt += n;
+            while (cnt >= 8)
+            {
+                cnt -= 8;
+                uint8_t b = static_cast<uint8_t>(acc >> cnt);
+                out.push_back(b);
+                if (b == 0xFF)
+                    out.push_back(0x00);
+            }
+        }
+
+        // 末尾不满一字节的部分用 1 填充
+        void Finish()
+        {
+            if (cnt)
+                Put(0x7F, 8 - cnt);
+        }
+    };
+
+    inline int Extend(int v, int s)
+    {
+        return v < (1 << (s - 1)) ? v - (1 << s) + 1 : v;
+    }
+
+    inline int Category(int v)
+    {
+        unsigned a = static_cast<unsigned>(v < 0 ? -v : v);
+        int n = 0;
+        while (a)
+        {
+            ++n;
+            a >>= 1;
+        }
+        return n;
+    }
+
+    inline void PutSegment(std::vector<uint8_t> &out, const uint8_t *data, size_t size)
+    {
+        out.insert(out.end(), data, data + size);
+    }
+}
+
+bool JpegTranscoder::HuffTable::Build()
+{
+    memset(lookup, 0, sizeof(lookup));
+    memset(size, 0, sizeof(size));
+    int code = 0;
+    int k = 0;
+    for (int l = 1; l <= 16; ++l)
+    {
+        valptr[l] = k;
+        mincode[l] = code;
+        for (int i = 0; i < bits[l]; ++i, ++k, ++code)
+        {
+            if (k >= 256 || code >= (1 << l))
+                return defined = false;
+            uint8_t sym = vals[k];
+            this->code[sym] = static_cast<uint16_t>(code);
+            size[sym] = static_cast<uint8_t>(l);
+            if (l <= 9)
+            {
+                uint16_t entry = static_cast<uint16_t>((l << 8) | sym);
+                for (int j = code << (9 - l); j < (code + 1) << (9 - l); ++j)
+                    lookup[j] = entry;
+            }
+        }
+        maxcode[l] = bits[l] ? code - 1 : -1;
+        code <<= 1;
+    }
+    maxcode[17] = INT_MAX;
+    return defined = true;
+}
+
+bool JpegTranscoder::McuSize(AVPixelFormat fmt, int &mcuW, int &mcuH)
+{
+    switch (fmt)
+    {
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUV420P:
+        mcuW = 16;
+        mcuH = 16;
+        return true;
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUV422P:
+        // 4:2:2 既有 2x1 也有 2x2 / 1x2 的写法（如 FFmpeg 的编码器），按较大的 MCU 判断
+        mcuW = 16;
+        mcuH = 16;
+        return true;
+    case AV_PIX_FMT_YUVJ440P:
+    case AV_PIX_FMT_YUV440P:
+        mcuW = 8;
+        mcuH = 16;
+        return true;
+    case AV_PIX_FMT_YUVJ444P:
+    case AV_PIX_FMT_YUV444P:
+    case AV_PIX_FMT_GRAY8:
+        mcuW = 8;
+        mcuH = 8;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool JpegTranscoder::Passthrough(const uint8_t *data, size_t size, std::vector<uint8_t> &out)
+{
+    if (!data || size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return false;
+    const uint8_t *p = data + 2;
+    const uint8_t *end = data + size;
+    bool hasDht = false;
+    while (p + 4 <= end && p[0] == 0xFF)
+    {
+        uint8_t m = p[1];
+        if (m == 0xFF)
+        {
+            ++p;
+            continue;
+        }
+        if (m == 0xDA)
+        {
+            if (hasDht)
+                out.assign(data, end);
+            else
+            {
+                // MJPEG 常省略 DHT，补上标准表后才是完整的 JPEG
+                out.assign(data, p);
+                AppendStdDht(out);
+                out.insert(out.end(), p, end);
+            }
+            return true;
+        }
+        if (m == 0xC4)
+            hasDht = true;
+        p += 2 + ((p[2] << 8) | p[3]);
+    }
+    return false;
+}
+
+bool JpegTranscoder::Parse(const uint8_t *data, size_t size, Header &hdr)
+{
+    if (!data || size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return false;
+    for (int i = 0; i < 4; ++i)
+    {
+        dc_[i].defined = false;
+        ac_[i].defined = false;
+    }
+
+    std::vector<Component> frame;
+    const uint8_t *p = data + 2;
+    const uint8_t *end = data + size;
+    while (p + 4 <= end)
+    {
+        if (p[0] != 0xFF)
+            return false;
+        uint8_t m = p[1];
+        if (m == 0xFF)
+        {
+            ++p;
+            continue;
+        }
+        if (m == 0x01 || (m >= 0xD0 && m <= 0xD7))
+        {
+            p += 2;
+            continue;
+        }
+        if (m == 0xD8 || m == 0xD9)
+            return false;
+        size_t len = (p[2] << 8) | p[3];
+        if (len < 2 || static_cast<size_t>(end - p) < len + 2)
+            return false;
+        const uint8_t *q = p + 4;
+        const uint8_t *qe = p + 2 + len;
+        Segment seg{p, len + 2};
+
+        if (m == 0xC4)
+        {
+            hdr.dht.push_back(seg);
+            while (q < qe)
+            {
+                if (qe - q < 17)
+                    return false;
+                int tc = q[0] >> 4;
+                int th = q[0] & 0x0F;
+                if (tc > 1 || th > 3)
+                    return false;
+                HuffTable &t = tc ? ac_[th] : dc_[th];
+                int total = 0;
+                for (int l = 1; l <= 16; ++l)
+                {
+                    t.bits[l] = q[l];
+                    total += q[l];
+                }
+                if (total > 256 || qe - q < 17 + total)
+                    return false;
+                memcpy(t.vals, q + 17, total);
+                if (!t.Build())
+                    return false;
+                q += 17 + total;
+            }
+        }
+        else if (m == 0xDB)
+            hdr.dqt.push_back(seg);
+        else if (m == 0xDD)
+        {
+            if (len < 4)
+                return false;
+            hdr.restart = (q[0] << 8) | q[1];
+        }
+        else if (m == 0xC0 || m == 0xC1)
+        {
+            if (len < 8 || q[0] != 8)
+                return false;
+            hdr.height = (q[1] << 8) | q[2];
+            hdr.width = (q[3] << 8) | q[4];
+            int nf = q[5];
+            if (nf < 1 || nf > 4 || len < static_cast<size_t>(8 + 3 * nf))
+                return false;
+            frame.clear();
+            for (int i = 0; i < nf; ++i)
+            {
+                Component c;
+                c.id = q[6 + 3 * i];
+                c.h = q[7 + 3 * i] >> 4;
+                c.v = q[7 + 3 * i] & 0x0F;
+                if (c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4)
+                    return false;
+                hdr.hmax = std::max(hdr.hmax, c.h);
+                hdr.vmax = std::max(hdr.vmax, c.v);
+                frame.push_back(c);
+            }
+            hdr.sof = seg;
+            hdr.baseline = true;
+        }
+        else if (m == 0xDA)
+        {
+            if (!hdr.baseline || len < 6)
+                return false;
+            int ns = q[0];
+            if (ns < 1 || len < static_cast<size_t>(6 + 2 * ns))
+                return false;
+            for (int i = 0; i < ns; ++i)
+            {
+                auto it = std::find_if(frame.begin(), frame.end(), [&](const Component &c)
+                                       { return c.id == q[1 + 2 * i]; });
+                if (it == frame.end())
+                    return false;
+                Component c = *it;
+                c.td = q[2 + 2 * i] >> 4;
+                c.ta = q[2 + 2 * i] & 0x0F;
+                if (c.td > 3 || c.ta > 3)
+                    return false;
+                hdr.comps.push_back(c);
+            }
+            // 只处理单次扫描包含全部分量的情况
+            if (hdr.comps.size() != frame.size() || hdr.width <= 0 || hdr.height <= 0)
+                return false;
+            hdr.sos = seg;
+            hdr.scan = qe;
+            hdr.end = end;
+            // 未定义的 0 / 1 号表按 MJPEG 惯例使用标准表
+            for (const auto &c : hdr.comps)
+            {
+                if (!dc_[c.td].defined && c.td < 2)
+                    dc_[c.td] = StdTable(c.td);
+                if (!ac_[c.ta].defined && c.ta < 2)
+                    ac_[c.ta] = StdTable(2 + c.ta);
+                if (!dc_[c.td].defined || !ac_[c.ta].defined)
+                    return false;
+            }
+            return true;
+        }
+        else if ((m >= 0xE0 && m <= 0xEF) || m == 0xFE)
+            hdr.misc.push_back(seg);
+        else if ((m >= 0xC2 && m <= 0xCF) && m != 0xC4 && m != 0xC8)
+            return false; // 渐进式 / 无损 / 算术编码 / DAC
+        p = qe;
+    }
+    return false;
+}
+
+JpegTranscoder::Result JpegTranscoder::Scan(const Header &hdr, int x0, int y0, int x1, int y1, bool stdTables, std::vector<uint8_t> &out)
+{
+    const bool interleaved = hdr.comps.size() > 1;
+    const int mcuW = interleaved ? 8 * hdr.hmax : 8;
+    const int mcusX = (hdr.width + mcuW - 1) / mcuW;
+    const int nc = static_cast<int>(hdr.comps.size());
+
+    const HuffTable *decDc[4], *decAc[4], *encDc[4], *encAc[4];
+    int blocks[4];
+    for (int i = 0; i < nc; ++i)
+    {
+        const Component &c = hdr.comps[i];
+        decDc[i] = &dc_[c.td];
+        decAc[i] = &ac_[c.ta];
+        encDc[i] = stdTables ? &StdTable(i ? 1 : 0) : decDc[i];
+        encAc[i] = stdTables ? &StdTable(i ? 3 : 2) : decAc[i];
+        blocks[i] = interleaved ? c.h * c.v : 1;
+    }
+
+    BitReader rd(hdr.scan, hdr.end);
+    BitWriter wr(out);
+    int predIn[4] = {};
+    int predOut[4] = {};
+    int mcu = 0;
+    for (int my = 0; my < y1; ++my)
+    {
+        for (int mx = 0; mx < mcusX; ++mx, ++mcu)
+        {
+            if (hdr.restart && mcu && mcu % hdr.restart == 0)
+            {
+                if (!rd.Restart())
+                    return Result::Corrupt;
+                memset(predIn, 0, sizeof(predIn));
+            }
+            const bool keep = my >= y0 && mx >= x0 && mx < x1;
+            for (int ci = 0; ci < nc; ++ci)
+            {
+                const HuffTable &dc = *decDc[ci];
+                const HuffTable &ac = *decAc[ci];
+                const HuffTable &edc = *encDc[ci];
+                const HuffTable &eac = *encAc[ci];
+                for (int b = 0; b < blocks[ci]; ++b)
+                {
+                    // DC：解出绝对值，保留的块按输出顺序重新差分
+                    int s = rd.Decode(dc);
+                    if (s < 0 || s > 11)
+                        return Result::Corrupt;
+                    predIn[ci] += s ? Extend(rd.Bits(s), s) : 0;
+                    if (keep)
+                    {
+                        int diff = predIn[ci] - predOut[ci];
+                        predOut[ci] = predIn[ci];
+                        int cat = Category(diff);
+                        if (cat > 11 || !edc.size[cat])
+                            return Result::Missing;
+                        wr.Put(edc.code[cat], edc.size[cat]);
+                        wr.Put(static_cast<uint32_t>(diff < 0 ? diff - 1 : diff), cat);
+                    }
+                    // AC：符号与附加位原样转写
+                    for (int k = 1; k < 64;)
+                    {
+                        int rs = rd.Decode(ac);
+                        if (rs < 0)
+                            return Result::Corrupt;
+                        int run = rs >> 4;
+                        int size = rs & 0x0F;
+                        int extra = rd.Bits(size);
+                        if (keep)
+                        {
+                            if (!eac.size[rs])
+                                return Result::Missing;
+                            wr.Put(eac.code[rs], eac.size[rs]);
+                            wr.Put(static_cast<uint32_t>(extra), size);
+                        }
+                        if (size == 0 && run != 15)
+                            break; // EOB
+                        k += run + 1;
+                        if (k > 64)
+                            return Result::Corrupt;
+                    }
+                }
+            }
+        }
+    }
+    if (rd.Overrun())
+        return Result::Corrupt;
+    wr.Finish();
+    return Result::Ok;
+}
+
+bool JpegTranscoder::Crop(const uint8_t *data, size_t size, int x, int y, int w, int h, std::vector<uint8_t> &out)
+{
+    Header hdr;
+    if (!Parse(data, size, hdr))
+        return false;
+    const bool interleaved = hdr.comps.size() > 1;
+    const int mcuW = interleaved ? 8 * hdr.hmax : 8;
+    const int mcuH = interleaved ? 8 * hdr.vmax : 8;
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x % mcuW || y % mcuH || x >= hdr.width || y >= hdr.height)
+        return false;
+    w = std::min(w, hdr.width - x);
+    h = std::min(h, hdr.height - y);
+    const int x0 = x / mcuW;
+    const int y0 = y / mcuH;
+    const int x1 = (x + w + mcuW - 1) / mcuW;
+    const int y1 = (y + h + mcuH - 1) / mcuH;
+
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        const bool stdTables = attempt > 0;
+        out.clear();
+        out.reserve(size);
+        out.push_back(0xFF);
+        out.push_back(0xD8);
+        for (const auto &s : hdr.misc)
+            PutSegment(out, s.data, s.size);
+        for (const auto &s : hdr.dqt)
+            PutSegment(out, s.data, s.size);
+        // SOF：只改宽高
+        size_t sof = out.size();
+        PutSegment(out, hdr.sof.data, hdr.sof.size);
+        out[sof + 5] = static_cast<uint8_t>(h >> 8);
+        out[sof + 6] = static_cast<uint8_t>(h);
+        out[sof + 7] = static_cast<uint8_t>(w >> 8);
+        out[sof + 8] = static_cast<uint8_t>(w);
+        if (stdTables || hdr.dht.empty())
+            AppendStdDht(out);
+        else
+            for (const auto &s : hdr.dht)
+                PutSegment(out, s.data, s.size);
+        if (stdTables)
+        {
+            // 换用标准表时重写 SOS 的表选择：第一个分量用亮度表，其余用色度表
+            const size_t nc = hdr.comps.size();
+            const size_t len = 6 + 2 * nc;
+            out.push_back(0xFF);
+            out.push_back(0xDA);
+            out.push_back(static_cast<uint8_t>(len >> 8));
+            out.push_back(static_cast<uint8_t>(len));
+            out.push_back(static_cast<uint8_t>(nc));
+            for (size_t i = 0; i < nc; ++i)
+            {
+                out.push_back(static_cast<uint8_t>(hdr.comps[i].id));
+                out.push_back(i ? 0x11 : 0x00);
+            }
+            out.push_back(0);
+            out.push_back(63);
+            out.push_back(0);
+        }
+        else
+            PutSegment(out, hdr.sos.data, hdr.sos.size);
+
+        Result r = Scan(hdr, x0, y0, x1, y1, stdTables, out);
+        if (r == Result::Ok)
+        {
+            out.push_back(0xFF);
+            out.push_back(0xD9);
+            return true;
+        }
+        if (r == Result::Corrupt)
+            break;
+    }
+    out.clear();
+    return false;
+}
+
+size_t JpegTranscoder::StitchBound(const std::vector<Span> &strips)
+{
+    size_t total = 0;
+    for (const auto &s : strips)
+        total += s.size;
+    return total + 2 * strips.size() + 8;
+}
+
+size_t JpegTranscoder::Stitch(const std::vector<Span> &strips, uint8_t *out, size_t capacity)
+{
+    if (strips.empty() || !out || capacity < StitchBound(strips))
+        return 0;
+
+    auto sameSegments = [](const std::vector<Segment> &a, const std::vector<Segment> &b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const Segment &x, const Segment &y)
+                                                  { return x.size == y.size && memcmp(x.data, y.data, x.size) == 0; });
+    };
+
+    Header first;
+    int height = 0;
+    int interval = 0;
+    std::vector<std::pair<const uint8_t *, const uint8_t *>> scans;
+    for (size_t i = 0; i < strips.size(); ++i)
+    {
+        Header hdr;
+        if (!Parse(strips[i].data, strips[i].size, hdr) || hdr.restart)
+            return 0;
+        const bool interleaved = hdr.comps.size() > 1;
+        const int mcuW = interleaved ? 8 * hdr.hmax : 8;
+        const int mcuH = interleaved ? 8 * hdr.vmax : 8;
+        const int mcus = (hdr.width + mcuW - 1) / mcuW * ((hdr.height + mcuH - 1) / mcuH);
+        if (i == 0)
+        {
+            first = hdr;
+            interval = mcus;
+        }
+        else if (hdr.width != first.width || !sameSegments(hdr.dqt, first.dqt) || !sameSegments(hdr.dht, first.dht) ||
+                 hdr.sos.size != first.sos.size || memcmp(hdr.sos.data, first.sos.data, hdr.sos.size) != 0)
+            return 0;
+        // 重启间隔按 MCU 个数计：前面的条带必须刚好是整数个 MCU 行且大小一致
+        if (i + 1 < strips.size() && (hdr.height % mcuH || mcus != interval))
+            return 0;
+        if (mcus > interval || interval > 0xFFFF)
+            return 0;
+        // 熵编码数据到 EOI 为止，编码器输出已按字节对齐并用 1 填充
+        const uint8_t *end = hdr.end;
+        if (end - hdr.scan >= 2 && end[-2] == 0xFF && end[-1] == 0xD9)
+            end -= 2;
+        scans.emplace_back(hdr.scan, end);
+        height += hdr.height;
+    }
+    if (height > 0xFFFF)
+        return 0;
+
+    // 输出不超过 StitchBound：头部取自第一条，其余各条只取扫描数据
+    uint8_t *p = out;
+    auto put = [&p](const uint8_t *data, size_t size)
+    {
+        memcpy(p, data, size);
+        p += size;
+    };
+    const uint8_t soi[2] = {0xFF, 0xD8};
+    put(soi, 2);
+    for (const auto &s : first.misc)
+        put(s.data, s.size);
+    for (const auto &s : first.dqt)
+        put(s.data, s.size);
+    // SOF：只改高度
+    uint8_t *sof = p;
+    put(first.sof.data, first.sof.size);
+    sof[5] = static_cast<uint8_t>(height >> 8);
+    sof[6] = static_cast<uint8_t>(height);
+    for (const auto &s : first.dht)
+        put(s.data, s.size);
+    if (strips.size() > 1)
+    {
+        const uint8_t dri[6] = {0xFF, 0xDD, 0x00, 0x04, static_cast<uint8_t>(interval >> 8), static_cast<uint8_t>(interval)};
+        put(dri, 6);
+    }
+    put(first.sos.data, first.sos.size);
+    for (size_t i = 0; i < scans.size(); ++i)
+    {
+        if (i > 0)
+        {
+            const uint8_t rst[2] = {0xFF, static_cast<uint8_t>(0xD0 + (i - 1) % 8)};
+            put(rst, 2);
+        }
+        put(scans[i].first, static_cast<size_t>(scans[i].second - scans[i].first));
+    }
+    const uint8_t eoi[2] = {0xFF, 0xD9};
+    put(eoi, 2);
+    return static_cast<size_t>(p - out);
+}
@@ -0,0 +1,102 @@
+#pragma once
+/**
+ * MJPEG 压缩域处理：不解码像素，直接在码流上完成
+ *      Passthrough: 原样输出；缺少 DHT 的 MJPEG 帧补上标准 Huffman 表（独立的 JPEG 解码器需要）
+ *      Crop: 与 jpegtran -crop 相同的无损裁剪，只支持基线 Huffman (SOF0 / SOF1, 8 bit)
+ *            1. 逐块 Huffman 解码出量化系数，ROI 之后的 MCU 行不再解析
+ *            2. 保留 ROI 内的块，DC 差分按新的块顺序重算，用原来的表重新编码
+ *            3. 起点必须对齐 MCU，宽高任意（末尾不满一个 MCU 的部分本来就是填充）
+ *      Stitch: 把自上而下的多个条带 JPEG 拼成一帧，条带之间插入 RSTn，用于分条并行编码
+ * 渐进式 / 算术编码 / 多扫描 / 原表缺少所需符号时返回 false，由调用方回退到解码 + 编码
+ */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/pixfmt.h>
+}
+
+class JpegTranscoder
+{
+public:
+    // 由 MJPEG 的像素格式推断 MCU 尺寸，不认识的格式返回 false
+    static bool McuSize(AVPixelFormat fmt, int &mcuW, int &mcuH);
+
+    bool Passthrough(const uint8_t *data, size_t size, std::vector<uint8_t> &out);
+    bool Crop(const uint8_t *data, size_t size, int x, int y, int w, int h, std::vector<uint8_t> &out);
+    // 一段只读的输入数据（如编码器输出的包）
+    struct Span
+    {
+        const uint8_t *data;
+        size_t size;
+    };
+    // 拼接结果的大小上限：各条之和加上插入的 DRI / RSTn / SOI / EOI
+    static size_t StitchBound(const std::vector<Span> &strips);
+    // 条带要求：同宽、同一组量化表和 Huffman 表、没有重启间隔；除最后一条外高度相同且对齐 MCU
+    // 直接写入 out（容量不小于 StitchBound），返回写入的字节数，失败返回 0
+    size_t Stitch(const std::vector<Span> &strips, uint8_t *out, size_t capacity);
+
+    struct HuffTable
+    {
+        bool defined = false;
+        uint8_t bits[17] = {};  // bits[n]: 长度为 n 的码字个数
+        uint8_t vals[256] = {};
+        // 解码：9 位查表 + 长码逐级比较
+        uint16_t lookup[1 << 9] = {}; // (长度 << 8) | 符号，0 表示码长超过 9
+        int32_t maxcode[18] = {};
+        int32_t mincode[17] = {};
+        int valptr[17] = {};
+        // 编码：符号 -> 码字 / 码长（码长 0 表示表里没有该符号）
+        uint16_t code[256] = {};
+        uint8_t size[256] = {};
+
+        bool Build();
+    };
+
+private:
+    struct Component
+    {
+        int id = 0;
+        int h = 1, v = 1;
+        int td = 0, ta = 0; // 扫描使用的 DC / AC 表
+    };
+
+    // 按出现顺序记录的段（含 0xFF 标记与长度）
+    struct Segment
+    {
+        const uint8_t *data;
+        size_t size;
+    };
+
+    struct Header
+    {
+        std::vector<Segment> misc; // APPn / COM
+        std::vector<Segment> dqt;
+        std::vector<Segment> dht;
+        Segment sof{nullptr, 0};
+        Segment sos{nullptr, 0};
+        bool baseline = false;
+        int width = 0, height = 0;
+        int hmax = 1, vmax = 1;
+        std::vector<Component> comps; // 按扫描顺序
+        int restart = 0;
+        const uint8_t *scan = nullptr; // 熵编码数据起点
+        const uint8_t *end = nullptr;
+    };
+
+    enum class Result
+    {
+        Ok,
+        Missing, // 原表缺少重算后的 DC 符号，换标准表重试
+        Corrupt
+    };
+
+    bool Parse(const uint8_t *data, size_t size, Header &hdr);
+    // 解析 [0, y1) 行 MCU，输出 [x0, x1) x [y0, y1) 范围内的块
+    Result Scan(const Header &hdr, int x0, int y0, int x1, int y1, bool stdTables, std::vector<uint8_t> &out);
+
+    HuffTable dc_[4];
+    HuffTable ac_[4];
+};
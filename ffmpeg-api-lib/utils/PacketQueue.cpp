@@ -0,0 +1,155 @@
+#include "PacketQueue.h"
+
+namespace
+{
+    // 字节和时长都算不出来（如 0 字节包）时的兜底上限
+    constexpr size_t kMaxPackets = 4096;
+}
+
+PacketQueue::~PacketQueue()
+{
+    ClearLocked();
+}
+
+void PacketQueue::SetTimeBase(AVRational tb)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    time_base_ = tb;
+}
+
+bool PacketQueue::SetLimits(size_t maxBytes, int64_t maxDurationMs)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    max_bytes_ = maxBytes;
+    max_duration_ms_ = maxDurationMs;
+    if (!producer_waiting_ || FullLocked())
+        return false;
+    producer_waiting_ = false;
+    return true;
+}
+
+bool PacketQueue::TakeSeek(double &target, int &serial)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    serial = serial_;
+    if (!seek_pending_)
+        return false;
+    seek_pending_ = false;
+    target = seek_target_;
+    return true;
+}
+
+bool PacketQueue::WaitIfFull()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (!FullLocked())
+        return false;
+    producer_waiting_ = true;
+    ++stalls_;
+    return true;
+}
+
+bool PacketQueue::Push(AVPacket *pkt, int serial, bool &wakeConsumer)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    wakeConsumer = false;
+    if (serial != serial_)
+    {
+        av_packet_free(&pkt);
+        return false;
+    }
+    entries_.push_back({pkt, pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts, pkt->duration});
+    bytes_ += static_cast<size_t>(pkt->size);
+    wakeConsumer = consumer_waiting_;
+    consumer_waiting_ = false;
+    return true;
+}
+
+bool PacketQueue::PushEof(int serial, bool &wakeConsumer)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    wakeConsumer = false;
+    if (serial != serial_)
+        return false;
+    entries_.push_back({nullptr, AV_NOPTS_VALUE, 0});
+    wakeConsumer = consumer_waiting_;
+    consumer_waiting_ = false;
+    return true;
+}
+
+PacketQueue::PopResult PacketQueue::Pop(AVPacket *&pkt, bool &wakeProducer)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    wakeProducer = false;
+    if (entries_.empty())
+    {
+        consumer_waiting_ = true;
+        ++underruns_;
+        return PopResult::Empty;
+    }
+    Entry e = entries_.front();
+    entries_.pop_front();
+    if (producer_waiting_ && !FullLocked())
+    {
+        producer_waiting_ = false;
+        wakeProducer = true;
+    }
+    if (!e.pkt)
+        return PopResult::Eof;
+    bytes_ -= static_cast<size_t>(e.pkt->size);
+    pkt = e.pkt;
+    return PopResult::Packet;
+}
+
+void PacketQueue::Flush(double target)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    ClearLocked();
+    ++serial_;
+    producer_waiting_ = false;
+    seek_pending_ = true;
+    seek_target_ = target;
+}
+
+PacketQueueStats PacketQueue::Stats()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    PacketQueueStats s;
+    s.bytes = bytes_;
+    s.durationMs = DurationLocked();
+    s.packets = entries_.size();
+    s.maxBytes = max_bytes_;
+    s.maxDurationMs = max_duration_ms_;
+    s.underruns = underruns_;
+    s.stalls = stalls_;
+    return s;
+}
+
+bool PacketQueue::FullLocked() const
+{
+    if (entries_.empty())
+        return false;
+    return bytes_ >= max_bytes_ || DurationLocked() >= max_duration_ms_ || entries_.size() >= kMaxPackets;
+}
+
+int64_t PacketQueue::DurationLocked() const
+{
+    // 队首到队尾的解码时间戳跨度，再加上队尾包自身的时长
+    auto front = entries_.begin();
+    while (front != entries_.end() && front->dts == AV_NOPTS_VALUE)
+        ++front;
+    if (front == entries_.end())
+        return 0;
+    auto back = entries_.end() - 1;
+    while (back->dts == AV_NOPTS_VALUE)
+        --back;
+    return static_cast<int64_t>(static_cast<double>(back->dts - front->dts + back->duration) * av_q2d(time_base_) * 1000);
+}
+
+void PacketQueue::ClearLocked()
+{
+    for (auto &e : entries_)
+        av_packet_free(&e.pkt);
+    entries_.clear();
+    bytes_ = 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+/**
+ * 解复用 -> 解码之间的有界包队列 (单生产者 / 单消费者)
+ * 上限同时按字节数和时长计算，任一超出即视为满，解复用侧挂起
+ * serial: 每次 Flush (seek / 循环) 加一，旧 serial 的包入队时直接丢弃，
+ *         seek 请求与 serial 在同一把锁内取出，保证 seek 前读到的包不会混进新位置
+ * 等待标记: 队列空时消费者、队列满时生产者各自登记，另一侧据此决定是否需要唤醒对方
+ */
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+extern "C"
+{
+#include <libavcodec/packet.h>
+#include <libavutil/avutil.h>
+}
+
+struct PacketQueueStats
+{
+    size_t bytes = 0;
+    int64_t durationMs = 0;
+    size_t packets = 0;
+    size_t maxBytes = 0;
+    int64_t maxDurationMs = 0;
+    uint64_t underruns = 0; // 解码侧取包时队列为空
+    uint64_t stalls = 0;    // 解复用侧因队列满而挂起
+};
+
+class PacketQueue
+{
+public:
+    enum class PopResult
+    {
+        Packet,
+        Eof,
+        Empty
+    };
+
+    PacketQueue() = default;
+    ~PacketQueue();
+    PacketQueue(const PacketQueue &) = delete;
+    PacketQueue &operator=(const PacketQueue &) = delete;
+
+    void SetTimeBase(AVRational tb);
+    // 返回 true 表示解复用侧正因满而等待且放宽后已不满，需要唤醒
+    bool SetLimits(size_t maxBytes, int64_t maxDurationMs);
+
+    // 解复用侧：取出待执行的 seek（有则返回 true）以及当前 serial
+    bool TakeSeek(double &target, int &serial);
+    // 解复用侧：已满则登记等待并返回 true
+    bool WaitIfFull();
+    // 解复用侧：入队并接管 pkt；serial 过期时释放 pkt 并返回 false
+    // wakeConsumer 为 true 表示解码侧正在等包，需要唤醒
+    bool Push(AVPacket *pkt, int serial, bool &wakeConsumer);
+    bool PushEof(int serial, bool &wakeConsumer);
+
+    // 解码侧：Packet 时 pkt 归调用方所有；wakeProducer 为 true 表示解复用侧正因满而等待
+    PopResult Pop(AVPacket *&pkt, bool &wakeProducer);
+    // 解码侧：丢弃所有包并请求解复用侧 seek 到 target（调用方随后唤醒解复用侧）
+    void Flush(double target);
+
+    PacketQueueStats Stats();
+
+private:
+    struct Entry
+    {
+        AVPacket *pkt; // nullptr 表示 EOF 标记
+        int64_t dts;
+        int64_t duration;
+    };
+
+    bool FullLocked() const;
+    int64_t DurationLocked() const;
+    void ClearLocked();
+
+    std::deque<Entry> entries_;
+    size_t bytes_ = 0;
+    int serial_ = 0;
+    bool seek_pending_ = false;
+    double seek_target_ = 0.0;
+    bool consumer_waiting_ = false;
+    bool producer_waiting_ = false;
+
+    AVRational time_base_{1, 1000};
+    size_t max_bytes_ = 4 * 1024 * 1024;
+    int64_t max_duration_ms_ = 500;
+    uint64_t underruns_ = 0;
+    uint64_t stalls_ = 0;
+    std::mutex mtx_;
+};
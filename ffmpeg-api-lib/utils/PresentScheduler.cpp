@@ -0,0 +1,270 @@
+#include "PresentScheduler.h"
+#include <algorithm>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+void JitterHistogram::Record(int64_t lateUs)
+{
+    if (lateUs < 0)
+        lateUs = 0;
+    int b = 0;
+    while (b < kBuckets - 1 && lateUs >= kUpperUs[b])
+        ++b;
+    counts_[b].fetch_add(1, std::memory_order_relaxed);
+
+    int64_t prev = max_us_.load(std::memory_order_relaxed);
+    while (lateUs > prev && !max_us_.compare_exchange_weak(prev, lateUs, std::memory_order_relaxed))
+        ;
+}
+
+std::array<uint64_t, JitterHistogram::kBuckets> JitterHistogram::Counts() const
+{
+    std::array<uint64_t, kBuckets> out{};
+    for (int i = 0; i < kBuckets; ++i)
+        out[i] = counts_[i].load(std::memory_order_relaxed);
+    return out;
+}
+
+PresentScheduler::PresentScheduler(FireFn onFire, int spinUs) : on_fire_(std::move(onFire)), spin_us_(spinUs < 0 ? 0 : spinUs)
+{
+    cur_tick_ = ToTick(Clock::now());
+#if defined(__linux__)
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+    thread_ = std::thread(&PresentScheduler::Loop, this);
+}
+
+PresentScheduler::~PresentScheduler()
+{
+    stop_ = true;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+    }
+    Interrupt();
+    if (thread_.joinable())
+        thread_.join();
+#if defined(__linux__)
+    if (timer_fd_ >= 0)
+        close(timer_fd_);
+    if (event_fd_ >= 0)
+        close(event_fd_);
+#endif
+}
+
+int64_t PresentScheduler::ToTick(Clock::time_point tp)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+}
+
+void PresentScheduler::Schedule(Clock::time_point due, uint64_t token, std::shared_ptr<DecodeTask> task)
+{
+    bool interrupt;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        // 时间轮为空时调度线程可能已长时间未推进，直接对齐到当前刻度
+        bool empty = near_.empty();
+        for (size_t n : level_count_)
+            empty = empty && n == 0;
+        if (empty)
+            cur_tick_ = std::max(cur_tick_, ToTick(Clock::now()));
+        Insert({due, token, std::move(task)});
+        interrupt = due < next_wake_;
+    }
+    if (interrupt)
+        Interrupt();
+}
+
+void PresentScheduler::Insert(Entry &&e)
+{
+    int64_t t = ToTick(e.due);
+    if (t <= cur_tick_)
+    {
+        InsertNear(std::move(e));
+        return;
+    }
+    int64_t delta = t - cur_tick_;
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (int64_t{1} << (kSlotBits * (level + 1))))
+        ++level;
+    // 超出最高层范围：先挂在最远的槽位，级联时再按真实到期时刻重新放置
+    if (delta >= (int64_t{1} << (kSlotBits * kLevels)))
+        t = cur_tick_ + (int64_t{1} << (kSlotBits * kLevels)) - 1;
+    auto idx = static_cast<size_t>((t >> (kSlotBits * level)) & (kSlots - 1));
+    wheel_[level][idx].push_back(std::move(e));
+    ++level_count_[level];
+}
+
+void PresentScheduler::InsertNear(Entry &&e)
+{
+    auto pos = std::upper_bound(near_.begin(), near_.end(), e.due,
+                                [](Clock::time_point due, const Entry &x)
+                                { return due < x.due; });
+    near_.insert(pos, std::move(e));
+}
+
+void PresentScheduler::Advance(int64_t tick)
+{
+    while (cur_tick_ < tick)
+    {
+        size_t pending = 0;
+        for (size_t n : level_count_)
+            pending += n;
+        if (pending == 0)
+        {
+            cur_tick_ = tick;
+            return;
+        }
+
+        ++cur_tick_;
+        // 从高层往低层级联，高层下放的条目可能落进本刻度要处理的低层槽位
+        int top = 0;
+        while (top + 1 < kLevels && (cur_tick_ & ((int64_t{1} << (kSlotBits * (top + 1))) - 1)) == 0)
+            ++top;
+        for (int level = top; level >= 1; --level)
+        {
+            auto &slot = wheel_[level][(cur_tick_ >> (kSlotBits * level)) & (kSlots - 1)];
+            if (slot.empty())
+                continue;
+            scratch_.swap(slot);
+            level_count_[level] -= scratch_.size();
+            for (auto &e : scratch_)
+                Insert(std::move(e));
+            scratch_.clear();
+        }
+
+        auto &slot0 = wheel_[0][cur_tick_ & (kSlots - 1)];
+        level_count_[0] -= slot0.size();
+        for (auto &e : slot0)
+            InsertNear(std::move(e));
+        slot0.clear();
+    }
+}
+
+PresentScheduler::Clock::time_point PresentScheduler::NextDue() const
+{
+    if (!near_.empty())
+        return near_.front().due;
+
+    size_t higher = 0;
+    for (int level = 1; level < kLevels; ++level)
+        higher += level_count_[level];
+    if (level_count_[0] == 0 && higher == 0)
+        return Clock::time_point::max();
+
+    for (int64_t t = cur_tick_ + 1; t < cur_tick_ + kSlots; ++t)
+    {
+        // 级联边界：高层有条目时需要醒来下放
+        if ((t & (kSlots - 1)) == 0 && higher > 0)
+            return Clock::time_point(std::chrono::milliseconds(t));
+        auto &slot = wheel_[0][t & (kSlots - 1)];
+        if (slot.empty())
+            continue;
+        auto due = slot.front().due;
+        for (auto &e : slot)
+            due = std::min(due, e.due);
+        return due;
+    }
+    return Clock::time_point(std::chrono::milliseconds((cur_tick_ | (kSlots - 1)) + 1));
+}
+
+void PresentScheduler::Loop()
+{
+    std::vector<Entry> fired;
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (!stop_)
+    {
+        auto now = Clock::now();
+        Advance(ToTick(now));
+
+        // 1. 取出所有已到期的条目，解锁后回调
+        auto end = std::find_if(near_.begin(), near_.end(), [&](const Entry &e)
+                                { return e.due > now; });
+        if (end != near_.begin())
+        {
+            std::move(near_.begin(), end, std::back_inserter(fired));
+            near_.erase(near_.begin(), end);
+            lk.unlock();
+            for (auto &e : fired)
+            {
+                int64_t lateUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - e.due).count();
+                jitter_.Record(lateUs);
+                on_fire_(std::move(e.task), e.token, lateUs);
+            }
+            fired.clear();
+            lk.lock();
+            continue;
+        }
+
+        // 2. 离下一个到期时刻不足自旋窗口：让出式自旋，不进内核等待
+        auto next = NextDue();
+        auto spin = std::chrono::microseconds(spin_us_.load());
+        if (spin.count() > 0 && next != Clock::time_point::max() && next - now <= spin)
+        {
+            lk.unlock();
+            while (!stop_ && Clock::now() < next)
+                std::this_thread::yield();
+            lk.lock();
+            continue;
+        }
+
+        // 3. 睡到下一个到期时刻（留出自旋窗口）
+        next_wake_ = next == Clock::time_point::max() ? next : next - spin;
+        WaitUntil(lk, next_wake_);
+        next_wake_ = Clock::time_point::min();
+    }
+}
+
+#if defined(__linux__)
+void PresentScheduler::WaitUntil(std::unique_lock<std::mutex> &lk, Clock::time_point tp)
+{
+    itimerspec its{};
+    if (tp != Clock::time_point::max())
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+        // 0 表示撤销定时器，已过期的时刻至少给 1ns
+        if (ns <= 0)
+            ns = 1;
+        its.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+        its.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+    }
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &its, nullptr);
+
+    lk.unlock();
+    pollfd fds[2] = {{timer_fd_, POLLIN, 0}, {event_fd_, POLLIN, 0}};
+    if (!stop_)
+        poll(fds, 2, -1);
+    uint64_t drain;
+    while (read(timer_fd_, &drain, sizeof(drain)) > 0)
+        ;
+    while (read(event_fd_, &drain, sizeof(drain)) > 0)
+        ;
+    lk.lock();
+}
+
+void PresentScheduler::Interrupt()
+{
+    uint64_t one = 1;
+    [[maybe_unused]] auto n = write(event_fd_, &one, sizeof(one));
+}
+#else
+void PresentScheduler::WaitUntil(std::unique_lock<std::mutex> &lk, Clock::time_point tp)
+{
+    if (stop_)
+        return;
+    if (tp == Clock::time_point::max())
+        cv_.wait(lk);
+    else
+        cv_.wait_until(lk, tp);
+}
+
+void PresentScheduler::Interrupt()
+{
+    cv_.notify_one();
+}
+#endif
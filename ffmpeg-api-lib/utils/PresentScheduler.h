@@ -0,0 +1,102 @@
+#pragma once
+/**
+ * 呈现调度器 所有流共用一个，不再为每一帧创建 / 销毁内核定时器，也不占用解码线程睡眠
+ * 分层时间轮 (4 层 x 64 槽，1ms 刻度) 保存到期时刻，由一个线程驱动:
+ *      Linux   timerfd 按绝对时刻等待，有更早的到期时刻插入时用 eventfd 打断
+ *      其他    condition_variable::wait_until
+ * 可选自旋：到期前 spin_us 微秒内改为让出式自旋，用少量 CPU 换取精度
+ * 每次触发记录实际唤醒晚于到期时刻的微秒数 (抖动直方图)
+ */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct DecodeTask;
+
+// 唤醒抖动直方图：按固定上界分桶计数，可多线程并发写入
+struct JitterHistogram
+{
+    static constexpr int kBuckets = 9;
+    // 各桶上界（微秒），最后一桶为 >= 10ms
+    static constexpr int64_t kUpperUs[kBuckets - 1] = {50, 100, 200, 500, 1000, 2000, 5000, 10000};
+
+    void Record(int64_t lateUs);
+    std::array<uint64_t, kBuckets> Counts() const;
+    int64_t MaxUs() const { return max_us_.load(std::memory_order_relaxed); }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+    std::atomic<int64_t> max_us_{0};
+};
+
+class PresentScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    // 到期回调：在调度线程上执行，不持锁；lateUs 为实际唤醒晚于到期时刻的微秒数
+    using FireFn = std::function<void(std::shared_ptr<DecodeTask> task, uint64_t token, int64_t lateUs)>;
+
+    explicit PresentScheduler(FireFn onFire, int spinUs = 0);
+    ~PresentScheduler();
+
+    PresentScheduler(const PresentScheduler &) = delete;
+    PresentScheduler &operator=(const PresentScheduler &) = delete;
+
+    // token 原样交给回调，用于识别已被取消 / 提前唤醒的条目
+    void Schedule(Clock::time_point due, uint64_t token, std::shared_ptr<DecodeTask> task);
+
+    void SetSpinUs(int us) { spin_us_ = us < 0 ? 0 : us; }
+    int SpinUs() const { return spin_us_; }
+    const JitterHistogram &Jitter() const { return jitter_; }
+
+private:
+    struct Entry
+    {
+        Clock::time_point due;
+        uint64_t token;
+        std::shared_ptr<DecodeTask> task;
+    };
+
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 6;
+    static constexpr int kSlots = 1 << kSlotBits;
+
+    static int64_t ToTick(Clock::time_point tp);
+    void Insert(Entry &&e);
+    void InsertNear(Entry &&e);
+    // 推进到 tick：高层槽位逐级下放，到期的 0 层槽位移入 near_
+    void Advance(int64_t tick);
+    // 下一次需要醒来的时刻（最早的到期时刻或下一个级联边界）
+    Clock::time_point NextDue() const;
+    void Loop();
+    void WaitUntil(std::unique_lock<std::mutex> &lk, Clock::time_point tp);
+    void Interrupt();
+
+    FireFn on_fire_;
+    std::atomic<int> spin_us_;
+
+    std::array<std::array<std::vector<Entry>, kSlots>, kLevels> wheel_;
+    std::array<size_t, kLevels> level_count_{};
+    std::vector<Entry> scratch_;
+    // 当前刻度内（或已过期）的条目，按到期时刻排序
+    std::vector<Entry> near_;
+    int64_t cur_tick_ = 0;
+    // 调度线程本次等待的截止时刻，醒着时为 min，插入更早的条目才需要打断
+    Clock::time_point next_wake_ = Clock::time_point::min();
+
+    JitterHistogram jitter_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    int timer_fd_ = -1;
+    int event_fd_ = -1;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
@@ -0,0 +1,93 @@
+#include "RateController.h"
+#include <algorithm>
+#include <cmath>
+
+void RateController::Configure(double bytesPerSecond, double bytesPerFrame, int minQ, int maxQ)
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    bytes_per_second = std::max(0.0, bytesPerSecond);
+    bytes_per_frame = std::max(0.0, bytesPerFrame);
+    min_q = std::clamp(minQ, 1, 31);
+    max_q = std::clamp(maxQ, min_q, 31);
+    // 预算变化后重新积累偏差，复杂度与帧间隔仍然有效
+    bucket = 0;
+    if (bytes_per_second <= 0 && bytes_per_frame <= 0)
+        q = 0; // 关闭后重新开启时从配置的质量起步
+    else if (q)
+        q = std::clamp(q, min_q, max_q);
+}
+
+bool RateController::Enabled() const
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    return bytes_per_second > 0 || bytes_per_frame > 0;
+}
+
+double RateController::TargetLocked() const
+{
+    double target = 0;
+    if (bytes_per_second > 0)
+    {
+        // 还没有测到帧间隔时按 25fps 估计
+        double interval = avg_interval_ms > 0 ? avg_interval_ms : 40.0;
+        target = bytes_per_second * interval / 1000.0;
+    }
+    if (bytes_per_frame > 0)
+        target = target > 0 ? std::min(target, bytes_per_frame) : bytes_per_frame;
+    return target;
+}
+
+int RateController::NextQuality(int base)
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!q)
+        q = std::clamp(base, min_q, max_q);
+    double target = TargetLocked();
+    if (complexity <= 0 || target <= 0)
+        return q;
+
+    // 漏桶修正：超出的部分在 kDrainFrames 帧内还清，预算至少保留 1/4
+    double budget = std::max(target - bucket / kDrainFrames, target / 4);
+    int desired = static_cast<int>(std::lround(complexity / budget));
+    int step = std::max(1, q / 4);
+    q = std::clamp(std::clamp(desired, q - step, q + step), min_q, max_q);
+    return q;
+}
+
+void RateController::Update(size_t bytes, int64_t timestampMs)
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!q)
+        return;
+    double size = static_cast<double>(bytes);
+    double sample = size * q;
+    complexity = complexity > 0 ? complexity * 0.7 + sample * 0.3 : sample;
+    avg_bytes = avg_bytes > 0 ? avg_bytes * 0.9 + size * 0.1 : size;
+
+    // seek / 循环造成的时间戳跳变不计入帧间隔
+    int64_t dt = timestampMs - last_ts;
+    if (has_ts && dt > 0 && dt < 2000)
+        avg_interval_ms = avg_interval_ms > 0 ? avg_interval_ms * 0.9 + dt * 0.1 : static_cast<double>(dt);
+    last_ts = timestampMs;
+    has_ts = true;
+
+    // 已经压到边界仍然超出（或仍有结余）时不再累计：这部分偏差靠调 qscale 消化不了
+    double target = TargetLocked();
+    bool saturated = (q >= max_q && size > target) || (q <= min_q && size < target);
+    if (target > 0 && !saturated)
+        bucket = std::clamp(bucket + size - target, -kMaxSavedFrames * target, kDrainFrames * target);
+}
+
+RateStats RateController::Stats() const
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    RateStats stats;
+    stats.enabled = bytes_per_second > 0 || bytes_per_frame > 0;
+    stats.quality = q;
+    stats.targetBytes = TargetLocked();
+    stats.avgBytes = avg_bytes;
+    if (avg_interval_ms > 0)
+        stats.bytesPerSecond = avg_bytes * 1000.0 / avg_interval_ms;
+    stats.bucketBytes = bucket;
+    return stats;
+}
@@ -0,0 +1,58 @@
+#pragma once
+/**
+ * 按字节预算逐帧调整 qscale 的闭环码率控制 (MJPEG)
+ *      1. 模型: JPEG 大小近似与 qscale 成反比，复杂度 = 帧大小 x qscale，按最近几帧做指数平均
+ *      2. 每帧预算: 字节/秒按实测帧间隔折算，与字节/帧同时给出时取较小者
+ *      3. 漏桶: 累计超出（或节省）的字节分摊到后续若干帧的预算里，避免长期偏离
+ *      4. qscale 每帧最多变化约 1/4，限制在 [minQ, maxQ]
+ * 只在编码阶段使用（调用方持锁），配置与统计可从其他线程访问
+ */
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+struct RateStats
+{
+    bool enabled = false;
+    int quality = 0;              // 最近一帧使用的 qscale
+    double targetBytes = 0;       // 当前每帧预算
+    double avgBytes = 0;          // 最近帧大小的平均
+    double bytesPerSecond = 0;    // 按实测帧间隔折算的输出码率
+    double bucketBytes = 0;       // 漏桶中累计超出预算的字节，负数表示有结余
+};
+
+class RateController
+{
+public:
+    // 两个预算都 <=0 时关闭
+    void Configure(double bytesPerSecond, double bytesPerFrame, int minQ, int maxQ);
+    bool Enabled() const;
+
+    // 下一帧使用的 qscale；base 为尚无样本时的起点
+    int NextQuality(int base);
+    // 记录刚编码完的一帧（timestampMs 用于估计帧间隔）
+    void Update(size_t bytes, int64_t timestampMs);
+
+    RateStats Stats() const;
+
+private:
+    double TargetLocked() const;
+
+    // 超出的字节分摊到这么多帧内消化；结余最多攒这么多帧的预算
+    static constexpr double kDrainFrames = 8.0;
+    static constexpr double kMaxSavedFrames = 2.0;
+
+    mutable std::mutex mtx;
+    double bytes_per_second = 0;
+    double bytes_per_frame = 0;
+    int min_q = 2;
+    int max_q = 31;
+
+    int q = 0;               // 最近一次给出的 qscale
+    double complexity = 0;   // 帧大小 x qscale 的平均，0 表示还没有样本
+    double avg_bytes = 0;
+    double avg_interval_ms = 0;
+    int64_t last_ts = 0;
+    bool has_ts = false;
+    double bucket = 0;
+};
@@ -0,0 +1,109 @@
+#include "SceneDetector.h"
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCENE_USE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCENE_USE_NEON 1
+#endif
+
+namespace
+{
+    constexpr int kBlock = 8;
+    constexpr int kTile = 4;
+
+    // 一行 8x8 块的均值：每块取第 0/2/4/6 行共 32 个像素
+    void BlockRowMeans(const uint8_t *src, int stride, int cols, uint8_t *out)
+    {
+        int c = 0;
+#if defined(SCENE_USE_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        for (; c + 2 <= cols; c += 2)
+        {
+            const uint8_t *p = src + c * kBlock;
+            __m128i acc = _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), zero);
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 2 * stride)), zero));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 4 * stride)), zero));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 6 * stride)), zero));
+            out[c] = static_cast<uint8_t>(_mm_cvtsi128_si32(acc) >> 5);
+            out[c + 1] = static_cast<uint8_t>(_mm_cvtsi128_si32(_mm_srli_si128(acc, 8)) >> 5);
+        }
+#elif defined(SCENE_USE_NEON)
+        for (; c + 2 <= cols; c += 2)
+        {
+            const uint8_t *p = src + c * kBlock;
+            uint16x8_t acc = vpaddlq_u8(vld1q_u8(p));
+            acc = vpadalq_u8(acc, vld1q_u8(p + 2 * stride));
+            acc = vpadalq_u8(acc, vld1q_u8(p + 4 * stride));
+            acc = vpadalq_u8(acc, vld1q_u8(p + 6 * stride));
+            uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(acc));
+            out[c] = static_cast<uint8_t>(vgetq_lane_u64(sums, 0) >> 5);
+            out[c + 1] = static_cast<uint8_t>(vgetq_lane_u64(sums, 1) >> 5);
+        }
+#endif
+        for (; c < cols; ++c)
+        {
+            const uint8_t *p = src + c * kBlock;
+            unsigned sum = 0;
+            for (int r = 0; r < kBlock; r += 2)
+                for (int x = 0; x < kBlock; ++x)
+                    sum += p[r * stride + x];
+            out[c] = static_cast<uint8_t>(sum >> 5);
+        }
+    }
+}
+
+bool SceneDetector::Update(const AVFrame *yuv, int threshold)
+{
+    // rgba 输出没有亮度平面：按字节当作亮度处理，一个块覆盖 2 个像素宽
+    int bytes = yuv->format == AV_PIX_FMT_RGBA ? yuv->width * 4 : yuv->width;
+    int cols = bytes / kBlock;
+    int rows = yuv->height / kBlock;
+    if (cols <= 0 || rows <= 0)
+        return true;
+
+    cur_.resize(static_cast<size_t>(cols) * rows);
+    for (int r = 0; r < rows; ++r)
+        BlockRowMeans(yuv->data[0] + static_cast<ptrdiff_t>(r) * kBlock * yuv->linesize[0],
+                      yuv->linesize[0], cols, cur_.data() + static_cast<size_t>(r) * cols);
+
+    bool changed = cols != cols_ || rows != rows_ || ref_.size() != cur_.size();
+    if (!changed)
+    {
+        // 分片 SAD：任一 4x4 分片的平均差超过阈值即视为变化
+        for (int ty = 0; ty < rows && !changed; ty += kTile)
+        {
+            for (int tx = 0; tx < cols && !changed; tx += kTile)
+            {
+                int th = std::min(kTile, rows - ty);
+                int tw = std::min(kTile, cols - tx);
+                int sad = 0;
+                for (int y = ty; y < ty + th; ++y)
+                {
+                    const uint8_t *a = cur_.data() + static_cast<size_t>(y) * cols;
+                    const uint8_t *b = ref_.data() + static_cast<size_t>(y) * cols;
+                    for (int x = tx; x < tx + tw; ++x)
+                        sad += std::abs(a[x] - b[x]);
+                }
+                changed = sad > threshold * th * tw;
+            }
+        }
+    }
+
+    if (changed)
+    {
+        std::swap(cur_, ref_);
+        cols_ = cols;
+        rows_ = rows;
+    }
+    return changed;
+}
+
+void SceneDetector::Reset()
+{
+    ref_.clear();
+    cols_ = rows_ = 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+/**
+ * 静态画面检测 用于跳过未变化帧的编码
+ *      1. 把亮度平面按 8x8 块求均值得到缩略图 (隔行采样，SIMD 加速)
+ *      2. 缩略图按 4x4 分片 (对应原图 32x32) 与参考帧求 SAD
+ *      3. 任一分片的平均差超过阈值即认为画面变化，并把当前帧设为新的参考
+ * 参考帧只在判定变化时更新，缓慢的渐变最终也会累积触发
+ */
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+}
+
+class SceneDetector
+{
+public:
+    // 返回 true 表示画面有变化（第一帧、尺寸变化时总是 true）
+    // threshold: 分片平均亮度差阈值 (0-255)，0 表示只跳过完全相同的画面
+    bool Update(const AVFrame *yuv, int threshold);
+    void Reset();
+
+private:
+    std::vector<uint8_t> cur_;
+    std::vector<uint8_t> ref_;
+    int cols_ = 0;
+    int rows_ = 0;
+};
@@ -0,0 +1,100 @@
+#include "SharedBuffer.h"
+#include <utility>
+
+namespace
+{
+    void FreeVector(void *opaque, uint8_t *)
+    {
+        delete static_cast<std::vector<uint8_t> *>(opaque);
+    }
+}
+
+SharedBuffer::SharedBuffer(std::vector<uint8_t> &&bytes)
+{
+    if (bytes.empty())
+        return;
+    auto *owned = new std::vector<uint8_t>(std::move(bytes));
+    _buf = av_buffer_create(owned->data(), owned->size(), FreeVector, owned, AV_BUFFER_FLAG_READONLY);
+    if (!_buf)
+    {
+        delete owned;
+        return;
+    }
+    _data = _buf->data;
+    _size = _buf->size;
+}
+
+SharedBuffer::SharedBuffer(AVBufferRef *buf, size_t size) : _buf(buf)
+{
+    if (!_buf)
+        return;
+    _data = _buf->data;
+    _size = size;
+}
+
+SharedBuffer::SharedBuffer(const SharedBuffer &other)
+    : _buf(other._buf ? av_buffer_ref(other._buf) : nullptr), _data(other._data), _size(other._size)
+{
+    if (other._buf && !_buf)
+    {
+        _data = nullptr;
+        _size = 0;
+    }
+}
+
+SharedBuffer::SharedBuffer(SharedBuffer &&other) noexcept
+    : _buf(std::exchange(other._buf, nullptr)), _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0))
+{
+}
+
+SharedBuffer &SharedBuffer::operator=(const SharedBuffer &other)
+{
+    if (this != &other)
+        *this = SharedBuffer(other);
+    return *this;
+}
+
+SharedBuffer &SharedBuffer::operator=(SharedBuffer &&other) noexcept
+{
+    if (this != &other)
+    {
+        clear();
+        _buf = std::exchange(other._buf, nullptr);
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+SharedBuffer::~SharedBuffer()
+{
+    clear();
+}
+
+SharedBuffer SharedBuffer::FromPacket(const AVPacket *pkt)
+{
+    SharedBuffer out;
+    if (!pkt || pkt->size <= 0)
+        return out;
+    if (!pkt->buf)
+        return SharedBuffer(std::vector<uint8_t>(pkt->data, pkt->data + pkt->size));
+    out._buf = av_buffer_ref(pkt->buf);
+    if (!out._buf)
+        return out;
+    // 包的数据可能只是缓冲区中的一段（编码器预留的填充等）
+    out._data = pkt->data;
+    out._size = pkt->size;
+    return out;
+}
+
+void SharedBuffer::clear()
+{
+    av_buffer_unref(&_buf);
+    _data = nullptr;
+    _size = 0;
+}
+
+int SharedBuffer::UseCount() const
+{
+    return _buf ? av_buffer_get_ref_count(_buf) : 0;
+}
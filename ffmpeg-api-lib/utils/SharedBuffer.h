@@ -0,0 +1,50 @@
+#pragma once
+/**
+ * 编码结果的只读共享缓冲区 (基于 AVBufferRef 引用计数)
+ *      1. 编码器输出的包直接接管 pkt->buf 的引用，不再拷贝到 vector
+ *      2. 复制只增加引用计数：双缓冲、多个读者、JS 外部 Buffer 共享同一块内存
+ *      3. 内容创建后不再修改，需要改写时另建一个新的缓冲区
+ */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#include <libavcodec/packet.h>
+#include <libavutil/buffer.h>
+}
+
+class SharedBuffer
+{
+public:
+    SharedBuffer() = default;
+    // 接管 vector 的内存（不拷贝），最后一个引用释放时销毁
+    SharedBuffer(std::vector<uint8_t> &&bytes);
+    // 接管 buf 的引用（池中取出的缓冲等），有效数据为前 size 字节
+    SharedBuffer(AVBufferRef *buf, size_t size);
+    SharedBuffer(const SharedBuffer &other);
+    SharedBuffer(SharedBuffer &&other) noexcept;
+    SharedBuffer &operator=(const SharedBuffer &other);
+    SharedBuffer &operator=(SharedBuffer &&other) noexcept;
+    ~SharedBuffer();
+
+    // 引用包的数据；包不是引用计数的（极少见）时退回拷贝
+    static SharedBuffer FromPacket(const AVPacket *pkt);
+
+    const uint8_t *data() const { return _data; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    const uint8_t *begin() const { return _data; }
+    const uint8_t *end() const { return _data + _size; }
+    const uint8_t &operator[](size_t i) const { return _data[i]; }
+    void clear();
+
+    // 当前被多少个 SharedBuffer / 外部持有者引用（0 表示空）
+    int UseCount() const;
+
+private:
+    AVBufferRef *_buf = nullptr;
+    const uint8_t *_data = nullptr;
+    size_t _size = 0;
+};
@@ -0,0 +1,47 @@
+#pragma once
+/**
+ * 无等待三缓冲 (单生产者 / 单消费者)
+ * 三个槽位分别归写者 (back)、中转 (middle)、读者 (front) 所有
+ *      1. 写者写完 back 后与 middle 原子交换并打上 fresh 标记，永不等待
+ *      2. 读者发现 fresh 时用 front 与 middle 原子交换，拿到最新数据
+ * 任意时刻写者和读者操作的槽位互不相同，因此无需加锁
+ */
+#include <atomic>
+#include <cstdint>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    // 写者：当前可写槽位
+    T &Back() { return slots_[back_]; }
+
+    // 写者：发布 back 槽位
+    void Publish()
+    {
+        uint8_t prev = middle_.exchange(static_cast<uint8_t>(back_ | kFresh), std::memory_order_acq_rel);
+        back_ = prev & kIndexMask;
+    }
+
+    // 读者：如有新数据则交换到 front，返回是否更新
+    bool Update()
+    {
+        if (!(middle_.load(std::memory_order_acquire) & kFresh))
+            return false;
+        uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & kIndexMask;
+        return true;
+    }
+
+    // 读者：当前读取槽位
+    const T &Front() const { return slots_[front_]; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFresh = 0x4;
+
+    T slots_[3];
+    uint8_t back_ = 0;
+    uint8_t front_ = 1;
+    std::atomic<uint8_t> middle_{2};
+};
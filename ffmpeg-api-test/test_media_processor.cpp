@@ -4,7 +4,95 @@
 #include "../ffmpeg-api-lib/utils/MediaProcessor.h" // 引用你的静态库头文件
 #include <filesystem>
 #include <MediaManager.h>
+#include <PacketQueue.h>
+#include <FrameScaler.h>
+#include <JpegTranscoder.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+extern "C"
+{
+#include <libavutil/opt.h>
+#include <libavutil/buffer.h>
+}
 namespace fs = std::filesystem;
+
+// 分配计数：打开期间统计 operator new 与 malloc 族的调用次数，用于断言热路径不向堆申请内存
+// FFmpeg 的 av_malloc / av_realloc 走 posix_memalign / realloc，不经过 operator new
+static std::atomic<bool> g_count_allocs{false};
+static std::atomic<size_t> g_allocs{0};
+// 引用计数的记账结构（av_buffer_ref / av_buffer_pool_get 每次新建一个 AVBufferRef）无法池化，不计入；
+// 帧、包及其数据缓冲都大于它
+static constexpr size_t kRefStructSize = sizeof(AVBufferRef);
+static void CountAlloc(size_t size)
+{
+    if (g_count_allocs && size > kRefStructSize)
+        ++g_allocs;
+}
+void *operator new(std::size_t size)
+{
+    if (g_count_allocs)
+        ++g_allocs;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+#if defined(__GLIBC__)
+// 可执行文件里的定义会覆盖共享库（libavutil 等）对 malloc 族的引用，转发给 glibc 的实现
+extern "C"
+{
+    void *__libc_malloc(size_t size) noexcept;
+    void *__libc_calloc(size_t n, size_t size) noexcept;
+    void *__libc_realloc(void *p, size_t size) noexcept;
+    void *__libc_memalign(size_t align, size_t size) noexcept;
+
+    void *malloc(size_t size) noexcept
+    {
+        CountAlloc(size);
+        return __libc_malloc(size);
+    }
+    void *calloc(size_t n, size_t size) noexcept
+    {
+        CountAlloc(n * size);
+        return __libc_calloc(n, size);
+    }
+    void *realloc(void *p, size_t size) noexcept
+    {
+        CountAlloc(size);
+        return __libc_realloc(p, size);
+    }
+    void *memalign(size_t align, size_t size) noexcept
+    {
+        CountAlloc(size);
+        return __libc_memalign(align, size);
+    }
+    void *aligned_alloc(size_t align, size_t size) noexcept
+    {
+        CountAlloc(size);
+        return __libc_memalign(align, size);
+    }
+    int posix_memalign(void **out, size_t align, size_t size) noexcept
+    {
+        if (align < sizeof(void *) || (align & (align - 1)) != 0)
+            return EINVAL;
+        CountAlloc(size);
+        void *p = __libc_memalign(align, size);
+        if (!p)
+            return ENOMEM;
+        *out = p;
+        return 0;
+    }
+}
+#endif
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
 std::string GetTestAssetPath(const std::string& relative_path) {
     // fs::current_path() 获取的是进程启动时的当前工作目录
     // fs::absolute 会将其转换为绝对路径
@@ -96,4 +184,698 @@ TEST(MediaManagerTest, FixedOutputDynamicROITest) {
     // 检查 BufferAB 的稳定性
     EXPECT_EQ(f1.data.size() > 0, true);
     EXPECT_EQ(f2.data.size() > 0, true);
-}
\ No newline at end of file
+}
+
+// 场景：批量获取的结果与请求一一对应，不存在的流为空，读者已有最新帧时为 not_modified
+TEST(MediaManagerTest, GetFramesBatchSkipsUnchangedAndMissing) {
+    MediaManager manager;
+    std::string devId = "device_A";
+    int index = 1001;
+    std::string videoPath = GetTestAssetPath("test.mp4");
+    ROIConfig config(0, 0, 640, 480, 320, 240);
+    ASSERT_TRUE(manager.AddMedia(devId, index, videoPath, config, std::make_unique<MjpegEncoder>()));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    auto first = manager.GetFrames({{devId, index}, {"device_missing", 1}});
+    ASSERT_EQ(first.size(), 2u);
+    ASSERT_TRUE(first[0].success);
+    EXPECT_EQ(first[0].width, 320);
+    EXPECT_EQ(first[0].height, 240);
+    EXPECT_FALSE(first[1].success);
+
+    auto batch = manager.GetFrames({{devId, index, 0, first[0].seq}, {"device_missing", 1}});
+    ASSERT_EQ(batch.size(), 2u);
+    EXPECT_TRUE(batch[0].not_modified || (batch[0].success && batch[0].seq > first[0].seq));
+    EXPECT_FALSE(batch[1].success);
+}
+// 场景：验证解码执行器的 Yield / Block / Wake 语义
+TEST(DecodeExecutorTest, BlockedTaskResumesOnWake) {
+    DecodeExecutor executor(2);
+    std::atomic<int> steps{0};
+    std::atomic<bool> gate{false};
+    auto task = std::make_shared<DecodeTask>([&](DecodeTask &) {
+        int n = ++steps;
+        if (n == 3 && !gate)
+            return StepResult::Block;
+        return n >= 5 ? StepResult::Done : StepResult::Yield;
+    });
+
+    executor.Wake(task);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(steps.load(), 3); // 停在 Block，不会被重复调度
+
+    gate = true;
+    executor.Wake(task);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(steps.load(), 5); // Done 之后不再执行
+
+    executor.Wake(task);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(steps.load(), 5);
+}
+
+// 场景：三缓冲写者持续发布，读者只看到最新且完整的数据
+TEST(TripleBufferTest, ReaderSeesLatestPublished) {
+    TripleBuffer<std::vector<int>> tb;
+    EXPECT_FALSE(tb.Update());
+
+    tb.Back() = {1};
+    tb.Publish();
+    tb.Back() = {2};
+    tb.Publish();
+    ASSERT_TRUE(tb.Update());
+    EXPECT_EQ(tb.Front(), std::vector<int>{2});
+    EXPECT_FALSE(tb.Update()); // 没有新数据时保持不变
+
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (int i = 1; i <= 20000; ++i) {
+            tb.Back().assign(8, i);
+            tb.Publish();
+        }
+        done = true;
+    });
+    int last = 0;
+    while (!done || tb.Update()) {
+        tb.Update();
+        const auto &v = tb.Front();
+        ASSERT_EQ(v.size(), 8u);
+        EXPECT_GE(v[0], last); // 序号单调不回退
+        EXPECT_EQ(v[0], v[7]); // 读到的槽位没有被写者改动
+        last = v[0];
+    }
+    writer.join();
+    EXPECT_EQ(tb.Front()[0], 20000);
+}
+
+// 场景：静态画面检测只在亮度明显变化时报告变化
+TEST(SceneDetectorTest, DetectsLocalChangeOnly) {
+    AVFrame *frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUVJ420P;
+    frame->width = 320;
+    frame->height = 240;
+    ASSERT_GE(av_frame_get_buffer(frame, 0), 0);
+    for (int y = 0; y < frame->height; ++y)
+        memset(frame->data[0] + y * frame->linesize[0], 100, frame->width);
+
+    SceneDetector detector;
+    EXPECT_TRUE(detector.Update(frame, 4));  // 第一帧总是变化
+    EXPECT_FALSE(detector.Update(frame, 4)); // 完全相同
+    EXPECT_FALSE(detector.Update(frame, 0));
+
+    // 轻微噪声：低于阈值
+    frame->data[0][5 * frame->linesize[0] + 5] = 110;
+    EXPECT_FALSE(detector.Update(frame, 4));
+
+    // 局部 32x32 区域明显变化：即便只占画面很小一部分也要检测到
+    for (int y = 64; y < 96; ++y)
+        memset(frame->data[0] + y * frame->linesize[0] + 128, 200, 32);
+    EXPECT_TRUE(detector.Update(frame, 4));
+    EXPECT_FALSE(detector.Update(frame, 4)); // 参考帧已更新
+
+    av_frame_free(&frame);
+}
+
+// 场景：同步组成员小偏差逐帧缓慢校正，大偏差直接对齐，暂停的时钟互不影响
+TEST(SyncClockTest, FollowMasterCorrectsDrift) {
+    SyncClock master, member;
+    master.resetToTime(10.0);
+    member.resetToTime(10.2);
+
+    int64_t drift = member.followMaster(master);
+    EXPECT_NEAR(drift, 200, 20);
+    // 只修正一部分，仍然超前
+    EXPECT_GT(member.position() - master.position(), 100);
+    for (int i = 0; i < 100; ++i)
+        member.followMaster(master);
+    EXPECT_NEAR(member.position() - master.position(), 0, 20);
+
+    member.resetToTime(13.0);
+    member.followMaster(master);
+    EXPECT_NEAR(member.position() - master.position(), 0, 20);
+
+    master.pause();
+    int64_t frozen = master.position();
+    member.pause();
+    member.resume();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_EQ(master.position(), frozen);
+    EXPECT_GE(member.position() - frozen, 20);
+}
+
+// 场景：睡眠中的任务被 Wake 时立即重新执行，不必等到定时到期（seek / stop 不被帧同步拖住）
+TEST(DecodeExecutorTest, WakeCutsSleepShort) {
+    DecodeExecutor executor(2);
+    std::atomic<int> runs{0};
+    auto task = std::make_shared<DecodeTask>([&](DecodeTask &t) {
+        if (++runs >= 2)
+            return StepResult::Done;
+        t.wake_at = DecodeTask::Clock::now() + std::chrono::seconds(10);
+        return StepResult::Sleep;
+    });
+
+    executor.Wake(task);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(runs, 1);
+
+    auto start = std::chrono::steady_clock::now();
+    executor.Wake(task);
+    while (runs < 2 && std::chrono::steady_clock::now() - start < std::chrono::seconds(1))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(runs, 2);
+}
+
+// 场景：包队列按时长判满；seek 之后旧位置读到的包 (旧 serial) 不会混进队列
+TEST(PacketQueueTest, BoundsAndSerial) {
+    PacketQueue queue;
+    queue.SetTimeBase({1, 1000});
+    queue.SetLimits(1 << 20, 100);
+
+    double target;
+    int serial;
+    EXPECT_FALSE(queue.TakeSeek(target, serial));
+
+    bool wake = false;
+    for (int i = 0; i < 4; ++i) {
+        AVPacket *pkt = av_packet_alloc();
+        ASSERT_GE(av_new_packet(pkt, 100), 0);
+        pkt->dts = i * 40;
+        pkt->duration = 40;
+        EXPECT_TRUE(queue.Push(pkt, serial, wake));
+    }
+    // 0..160ms 已超过 100ms 上限
+    EXPECT_TRUE(queue.WaitIfFull());
+    EXPECT_EQ(queue.Stats().durationMs, 160);
+
+    AVPacket *out = nullptr;
+    bool wakeProducer = false;
+    ASSERT_EQ(queue.Pop(out, wakeProducer), PacketQueue::PopResult::Packet);
+    av_packet_free(&out);
+    ASSERT_EQ(queue.Pop(out, wakeProducer), PacketQueue::PopResult::Packet);
+    av_packet_free(&out);
+    EXPECT_TRUE(wakeProducer); // 降到上限以下，唤醒等待中的解复用侧
+
+    // seek：清空队列，旧 serial 的包被拒绝
+    queue.Flush(5.0);
+    AVPacket *stale = av_packet_alloc();
+    ASSERT_GE(av_new_packet(stale, 100), 0);
+    EXPECT_FALSE(queue.Push(stale, serial, wake));
+    int newSerial;
+    ASSERT_TRUE(queue.TakeSeek(target, newSerial));
+    EXPECT_DOUBLE_EQ(target, 5.0);
+    EXPECT_NE(newSerial, serial);
+
+    // 消费者等包时，入队会要求唤醒它
+    EXPECT_EQ(queue.Pop(out, wakeProducer), PacketQueue::PopResult::Empty);
+    EXPECT_TRUE(queue.PushEof(newSerial, wake));
+    EXPECT_TRUE(wake);
+    EXPECT_EQ(queue.Pop(out, wakeProducer), PacketQueue::PopResult::Eof);
+}
+
+TEST(FrameScalerTest, CropAndHalveFullRange) {
+    AVFrame *in = av_frame_alloc();
+    in->format = AV_PIX_FMT_YUVJ420P;
+    in->width = 128;
+    in->height = 64;
+    ASSERT_GE(av_frame_get_buffer(in, 0), 0);
+    // 亮度按列递增，色度填常量
+    for (int y = 0; y < in->height; ++y)
+        for (int x = 0; x < in->width; ++x)
+            in->data[0][y * in->linesize[0] + x] = static_cast<uint8_t>(x);
+    for (int p = 1; p < 3; ++p)
+        for (int y = 0; y < in->height / 2; ++y)
+            memset(in->data[p] + y * in->linesize[p], 100 + p, in->width / 2);
+
+    AVFrame *out = av_frame_alloc();
+    out->format = AV_PIX_FMT_YUVJ420P;
+    out->width = 32;
+    out->height = 16;
+    ASSERT_GE(av_frame_get_buffer(out, 0), 0);
+
+    // 从 x=16 裁出 64x32 再 2:1 缩小：第 i 列是源列 16+2i 与 17+2i 的均值
+    FrameScaler scaler;
+    ASSERT_TRUE(scaler.Scale(in, 16, 8, 64, 32, out));
+    for (int x = 0; x < out->width; ++x)
+        EXPECT_EQ(out->data[0][5 * out->linesize[0] + x], (16 + 2 * x + 17 + 2 * x + 1) / 2);
+    EXPECT_EQ(out->data[1][3 * out->linesize[1] + 7], 101);
+    EXPECT_EQ(out->data[2][3 * out->linesize[2] + 7], 102);
+
+    av_frame_free(&in);
+    av_frame_free(&out);
+}
+
+// 场景：原始像素输出由裁剪缩放直接产出 nv12，输出附带各平面的偏移与步长
+TEST(RawEncoderTest, Nv12FromScalerWithPlaneLayout) {
+    AVFrame *in = av_frame_alloc();
+    in->format = AV_PIX_FMT_YUVJ420P;
+    in->width = 64;
+    in->height = 32;
+    ASSERT_GE(av_frame_get_buffer(in, 0), 0);
+    memset(in->data[0], 50, in->linesize[0] * in->height);
+    memset(in->data[1], 101, in->linesize[1] * in->height / 2);
+    memset(in->data[2], 102, in->linesize[2] * in->height / 2);
+
+    // 缩放时直接输出 nv12，色度交织为 UVUV
+    RawEncoder encoder(RawEncoder::Format::NV12);
+    ASSERT_TRUE(encoder.Open(32, 16));
+    AVFrame *out = av_frame_alloc();
+    out->format = encoder.InputFormat();
+    out->width = 32;
+    out->height = 16;
+    ASSERT_GE(av_frame_get_buffer(out, 0), 0);
+    FrameScaler scaler;
+    ASSERT_TRUE(scaler.Scale(in, 0, 0, 64, 32, out));
+
+    EncoderOutput result;
+    encoder.Encode(out, result);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.format, AV_PIX_FMT_NV12);
+    EXPECT_EQ(result.planes, 2);
+    EXPECT_EQ(result.offset[1], static_cast<size_t>(result.linesize[0]) * 16);
+    EXPECT_EQ(result.data.size(), result.offset[1] + static_cast<size_t>(result.linesize[1]) * 8);
+    const uint8_t *uv = result.data.data() + result.offset[1] + 3 * result.linesize[1];
+    EXPECT_EQ(result.data[5 * result.linesize[0] + 7], 50);
+    EXPECT_EQ(uv[14], 101);
+    EXPECT_EQ(uv[15], 102);
+
+    av_frame_free(&in);
+    av_frame_free(&out);
+}
+
+// 场景：输出尺寸来回切换时取回之前打开的编码器，切回后仍能正常编码，编码结果的拷贝不复制数据
+TEST(MjpegEncoderTest, ResetReusesPooledContext) {
+    MjpegEncoder encoder;
+    ASSERT_TRUE(encoder.Open(64, 32));
+    AVCodecContext *first = encoder.GetCodecContext();
+    ASSERT_TRUE(encoder.Reset(32, 16));
+    EXPECT_NE(encoder.GetCodecContext(), first);
+    ASSERT_TRUE(encoder.Reset(64, 32, 12));
+    EXPECT_EQ(encoder.GetCodecContext(), first);
+
+    AVFrame *frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUVJ420P;
+    frame->width = 64;
+    frame->height = 32;
+    ASSERT_GE(av_frame_get_buffer(frame, 0), 0);
+    memset(frame->data[0], 80, frame->linesize[0] * frame->height);
+    memset(frame->data[1], 128, frame->linesize[1] * frame->height / 2);
+    memset(frame->data[2], 128, frame->linesize[2] * frame->height / 2);
+    EncoderOutput out;
+    encoder.Encode(frame, out);
+    EXPECT_TRUE(out.success);
+    EXPECT_EQ(out.width, 64);
+
+    // 编码结果引用包的缓冲区，拷贝只增加引用计数
+    EncoderOutput copy = out;
+    EXPECT_EQ(copy.data.data(), out.data.data());
+    EXPECT_EQ(out.data.UseCount(), 2);
+    out = {};
+    EXPECT_EQ(copy.data.UseCount(), 1);
+    EXPECT_EQ(copy.data[0], 0xFF);
+    av_frame_free(&frame);
+}
+
+// 解码任务对单个订阅者的一步：与 DecodeStep / PaceStep 相同的 PrepareFrame + DeliverFrame
+struct MediaManagerTestAccess
+{
+    static void Present(MediaManager &manager, const std::shared_ptr<StreamContext> &ctx, AVFrame *frame, double frameTime, std::vector<ReadyOutput> &outputs)
+    {
+        manager.PrepareFrame(ctx, frame, nullptr, 0, frameTime, AVRational{1, 1000}, outputs);
+        for (auto &item : outputs)
+            manager.DeliverFrame(item, false);
+        // 与呈现任务回收 spare_outputs 一样保留容量
+        outputs.clear();
+    }
+};
+
+// 场景：稳态的 裁剪缩放 -> 编码 -> 发布 -> 读取 不再向堆申请内存（含 FFmpeg 经 av_malloc 的分配），
+// 帧与输出包的缓冲都从池中循环取用
+TEST(BufferPoolTest, SteadyStateEncodeWithoutAllocations) {
+    MediaManager manager;
+    ROIConfig config(16, 8, 96, 48, 64, 32);
+    auto ctx = std::make_shared<StreamContext>();
+    ctx->config = config;
+    ctx->cur_cfg = config;
+    ctx->encoder = std::make_unique<MjpegEncoder>();
+    ASSERT_TRUE(ctx->encoder->Open(config.outW, config.outH, config.quality));
+    ctx->yuvFrame = av_frame_alloc();
+    ctx->lazy_frame = av_frame_alloc();
+    ctx->lazy_work = av_frame_alloc();
+
+    // 解码器输出：一块缓冲反复改写内容
+    AVFrame *decoded = av_frame_alloc();
+    decoded->format = AV_PIX_FMT_YUV420P;
+    decoded->width = 128;
+    decoded->height = 64;
+    ASSERT_GE(av_frame_get_buffer(decoded, 0), 0);
+    std::vector<ReadyOutput> outputs;
+    outputs.reserve(4);
+    const uint8_t *firstOut = nullptr;
+    bool reused = false;
+    auto step = [&](int i)
+    {
+        memset(decoded->data[0], 40 + i % 8, decoded->linesize[0] * decoded->height);
+        memset(decoded->data[1], 128, decoded->linesize[1] * decoded->height / 2);
+        memset(decoded->data[2], 128, decoded->linesize[2] * decoded->height / 2);
+        decoded->pts = i * 40;
+        MediaManagerTestAccess::Present(manager, ctx, decoded, i * 0.04, outputs);
+        EncoderOutput latest = ctx->frame_buffer.Latest();
+        if (!firstOut)
+            firstOut = latest.data.data();
+        else
+            reused = reused || latest.data.data() == firstOut;
+        return latest.success && latest.width == config.outW && latest.height == config.outH;
+    };
+    // 预热：缩放器、各级池与三缓冲的槽位都已建立
+    for (int i = 0; i < 8; ++i)
+        ASSERT_TRUE(step(i));
+    g_allocs = 0;
+    g_count_allocs = true;
+    bool ok = true;
+    for (int i = 8; i < 40; ++i)
+        ok = step(i) && ok;
+    g_count_allocs = false;
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(g_allocs.load(), 0u);
+    EXPECT_EQ(ctx->encoded_frames.load(), 40u);
+    // 读者释放后输出缓冲回池，后续帧复用同一块
+    EXPECT_TRUE(reused);
+    av_frame_free(&decoded);
+}
+
+// 场景：发布序号只在画面变化时递增，等待者在新帧发布或输出关闭时醒来
+TEST(FrameBufferTest, SeqAdvancesOnChangeAndWakesWaiter) {
+    auto make = []
+    {
+        EncoderOutput out;
+        out.success = true;
+        out.data = SharedBuffer(std::vector<uint8_t>{1, 2, 3});
+        return out;
+    };
+    FrameBuffer buffer;
+    EXPECT_EQ(buffer.Seq(), 0u);
+    buffer.Publish(make());
+    EXPECT_EQ(buffer.Seq(), 1u);
+    EXPECT_EQ(buffer.Latest().seq, 1u);
+    // 静态画面复用上一帧：时间戳更新但序号不变
+    buffer.Publish(make(), false);
+    EXPECT_EQ(buffer.Seq(), 1u);
+    EXPECT_FALSE(buffer.WaitNewer(1, std::chrono::milliseconds(10)));
+
+    std::thread writer([&]
+                       {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        buffer.Publish(make()); });
+    EXPECT_TRUE(buffer.WaitNewer(1, std::chrono::seconds(5)));
+    writer.join();
+    EXPECT_EQ(buffer.Latest().seq, 2u);
+
+    buffer.Close();
+    EXPECT_FALSE(buffer.WaitNewer(2, std::chrono::seconds(5)));
+}
+
+// 场景：帧间编码的推送订阅。关键帧之前的数据丢弃，未投递的帧按顺序拼接；latestOnly 时 Release 之前不再投递
+TEST(FrameSubscriptionTest, InterFrameConcatenatesUntilReleased) {
+    auto make = [](std::vector<uint8_t> bytes, bool key)
+    {
+        EncoderOutput out;
+        out.success = true;
+        out.keyframe = key;
+        out.data = SharedBuffer(std::move(bytes));
+        return out;
+    };
+    std::vector<std::vector<uint8_t>> got;
+    FrameSubscription sub(1, [&](EncoderOutput &&out)
+                          { got.emplace_back(out.data.begin(), out.data.end()); }, SubscribeOptions{}, true);
+    DecodeTask task([](DecodeTask &)
+                    { return StepResult::Done; });
+
+    sub.Offer(make({9}, false));
+    EXPECT_EQ(sub.Step(task), StepResult::Block);
+    sub.Offer(make({1, 2}, true));
+    sub.Offer(make({3}, false));
+    sub.Offer(make({4}, false));
+    EXPECT_EQ(sub.Step(task), StepResult::Yield);
+    ASSERT_EQ(got.size(), 1u);
+    EXPECT_EQ(got[0], (std::vector<uint8_t>{1, 2, 3, 4}));
+
+    // 上一帧未 Release：新数据只排队
+    sub.Offer(make({5}, false));
+    EXPECT_EQ(sub.Step(task), StepResult::Block);
+    sub.Release();
+    EXPECT_EQ(sub.Step(task), StepResult::Yield);
+    ASSERT_EQ(got.size(), 2u);
+    EXPECT_EQ(got[1], (std::vector<uint8_t>{5}));
+    EXPECT_EQ(sub.dropped.load(), 1u);
+
+    sub.Cancel();
+    EXPECT_EQ(sub.Step(task), StepResult::Done);
+}
+
+// 场景：latestOnly 关闭时按顺序投递，但已投递未 Release 的不超过 8 帧，回调方慢时积压留在订阅里按溢出规则丢弃
+TEST(FrameSubscriptionTest, QueuedDeliveryBoundsInFlightFrames) {
+    std::vector<int64_t> got;
+    SubscribeOptions options;
+    options.latestOnly = false;
+    FrameSubscription sub(1, [&](EncoderOutput &&out)
+                          { got.push_back(out.timestamp); }, options, false);
+    DecodeTask task([](DecodeTask &)
+                    { return StepResult::Done; });
+
+    auto offer = [&](int64_t ts)
+    {
+        EncoderOutput out;
+        out.success = true;
+        out.keyframe = true;
+        out.timestamp = ts;
+        out.data = SharedBuffer(std::vector<uint8_t>{1});
+        sub.Offer(out);
+    };
+    for (int i = 0; i < 20; ++i)
+    {
+        offer(i);
+        while (sub.Step(task) == StepResult::Yield)
+            ;
+    }
+    // 8 帧在途，之后的 12 帧里只保留最新的 8 帧
+    ASSERT_EQ(got.size(), 8u);
+    EXPECT_EQ(got.back(), 7);
+    EXPECT_EQ(sub.dropped.load(), 4u);
+
+    sub.Release();
+    EXPECT_EQ(sub.Step(task), StepResult::Yield);
+    EXPECT_EQ(sub.Step(task), StepResult::Block);
+    ASSERT_EQ(got.size(), 9u);
+    EXPECT_EQ(got.back(), 12);
+}
+
+// 场景：MJPEG 在 DCT 域无损裁剪，起点需对齐 MCU，解码结果与直接解码后裁出的区域逐像素一致
+TEST(JpegTranscoderTest, LosslessCropMatchesDecodedRegion) {
+    AVFrame *in = av_frame_alloc();
+    in->format = AV_PIX_FMT_YUVJ420P;
+    in->width = 128;
+    in->height = 64;
+    ASSERT_GE(av_frame_get_buffer(in, 0), 0);
+    for (int p = 0; p < 3; ++p)
+        for (int y = 0; y < (p ? 32 : 64); ++y)
+            for (int x = 0; x < (p ? 64 : 128); ++x)
+                in->data[p][y * in->linesize[p] + x] = static_cast<uint8_t>(x * 3 + y * 5 + (x * y) % 31 + p * 40);
+
+    MjpegEncoder encoder;
+    ASSERT_TRUE(encoder.Open(128, 64, 4));
+    EncoderOutput src;
+    encoder.Encode(in, src);
+    ASSERT_TRUE(src.success);
+
+    // 起点对齐 16x16 的 MCU，宽高不必对齐
+    JpegTranscoder jpeg;
+    std::vector<uint8_t> cropped;
+    ASSERT_TRUE(jpeg.Crop(src.data.data(), src.data.size(), 32, 16, 50, 41, cropped));
+    std::vector<uint8_t> unaligned;
+    EXPECT_FALSE(jpeg.Crop(src.data.data(), src.data.size(), 8, 16, 50, 41, unaligned));
+
+    auto decode = [](const std::vector<uint8_t> &data, AVFrame *frame)
+    {
+        const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+        AVCodecContext *dec = avcodec_alloc_context3(codec);
+        AVPacket *pkt = av_packet_alloc();
+        pkt->data = const_cast<uint8_t *>(data.data());
+        pkt->size = static_cast<int>(data.size());
+        bool ok = avcodec_open2(dec, codec, nullptr) >= 0 && avcodec_send_packet(dec, pkt) >= 0 &&
+                  avcodec_receive_frame(dec, frame) >= 0;
+        av_packet_free(&pkt);
+        avcodec_free_context(&dec);
+        return ok;
+    };
+    AVFrame *whole = av_frame_alloc();
+    AVFrame *part = av_frame_alloc();
+    ASSERT_TRUE(decode(std::vector<uint8_t>(src.data.begin(), src.data.end()), whole));
+    ASSERT_TRUE(decode(cropped, part));
+    ASSERT_EQ(part->width, 50);
+    ASSERT_EQ(part->height, 41);
+    // 系数原样保留：裁剪结果与整帧解码后的对应区域逐像素一致
+    for (int p = 0; p < 3; ++p)
+    {
+        int sx = p ? 16 : 32, sy = p ? 8 : 16;
+        int w = p ? 25 : 50, h = p ? 21 : 41;
+        for (int y = 0; y < h; ++y)
+            ASSERT_EQ(memcmp(part->data[p] + y * part->linesize[p], whole->data[p] + (sy + y) * whole->linesize[p] + sx, w), 0);
+    }
+
+    av_frame_free(&whole);
+    av_frame_free(&part);
+    av_frame_free(&in);
+}
+
+// 场景：分条编码的 JPEG 拼成一帧（除最后一条外高度对齐 MCU，宽度任意），解码结果与各条单独解码逐行一致
+TEST(JpegTranscoderTest, StitchedStripsMatchDecodedStrips) {
+    const int width = 100;
+    const int heights[3] = {32, 32, 7};
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    ASSERT_NE(codec, nullptr);
+
+    // 各条独立编码，共用默认 Huffman 表才能拼接
+    std::vector<std::vector<uint8_t>> encoded;
+    int y0 = 0;
+    for (int h : heights)
+    {
+        AVFrame *in = av_frame_alloc();
+        in->format = AV_PIX_FMT_YUVJ420P;
+        in->width = width;
+        in->height = h;
+        ASSERT_GE(av_frame_get_buffer(in, 0), 0);
+        for (int p = 0; p < 3; ++p)
+            for (int y = 0; y < (p ? (h + 1) / 2 : h); ++y)
+                for (int x = 0; x < (p ? width / 2 : width); ++x)
+                {
+                    int gy = (p ? y0 / 2 : y0) + y;
+                    in->data[p][y * in->linesize[p] + x] = static_cast<uint8_t>(x * 3 + gy * 5 + (x * gy) % 29 + p * 40);
+                }
+        in->quality = FF_QP2LAMBDA * 4;
+
+        AVCodecContext *enc = avcodec_alloc_context3(codec);
+        enc->width = width;
+        enc->height = h;
+        enc->pix_fmt = AV_PIX_FMT_YUVJ420P;
+        enc->time_base = {1, 25};
+        enc->flags |= AV_CODEC_FLAG_QSCALE;
+        enc->global_quality = FF_QP2LAMBDA * 4;
+        av_opt_set(enc->priv_data, "huffman", "default", 0);
+        AVPacket *pkt = av_packet_alloc();
+        ASSERT_GE(avcodec_open2(enc, codec, nullptr), 0);
+        ASSERT_GE(avcodec_send_frame(enc, in), 0);
+        ASSERT_GE(avcodec_receive_packet(enc, pkt), 0);
+        encoded.emplace_back(pkt->data, pkt->data + pkt->size);
+        av_packet_free(&pkt);
+        avcodec_free_context(&enc);
+        av_frame_free(&in);
+        y0 += h;
+    }
+
+    JpegTranscoder jpeg;
+    std::vector<JpegTranscoder::Span> spans;
+    for (auto &e : encoded)
+        spans.push_back({e.data(), e.size()});
+    size_t bound = JpegTranscoder::StitchBound(spans);
+    std::vector<uint8_t> stitched(bound);
+    EXPECT_EQ(jpeg.Stitch(spans, stitched.data(), bound - 1), 0u);
+    // 不满 MCU 的一条只能放在最后
+    EXPECT_EQ(jpeg.Stitch({spans[2], spans[0]}, stitched.data(), bound), 0u);
+    size_t size = jpeg.Stitch(spans, stitched.data(), bound);
+    ASSERT_GT(size, 0u);
+    stitched.resize(size);
+
+    auto decode = [](const uint8_t *data, size_t size, AVFrame *frame)
+    {
+        const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+        AVCodecContext *dec = avcodec_alloc_context3(codec);
+        AVPacket *pkt = av_packet_alloc();
+        pkt->data = const_cast<uint8_t *>(data);
+        pkt->size = static_cast<int>(size);
+        bool ok = avcodec_open2(dec, codec, nullptr) >= 0 && avcodec_send_packet(dec, pkt) >= 0 &&
+                  avcodec_receive_frame(dec, frame) >= 0;
+        av_packet_free(&pkt);
+        avcodec_free_context(&dec);
+        return ok;
+    };
+    AVFrame *whole = av_frame_alloc();
+    ASSERT_TRUE(decode(stitched.data(), stitched.size(), whole));
+    ASSERT_EQ(whole->width, width);
+    ASSERT_EQ(whole->height, 71);
+    // 熵编码数据原样搬运：拼接结果的每一行与所属条带单独解码的对应行一致
+    y0 = 0;
+    for (size_t i = 0; i < encoded.size(); ++i)
+    {
+        AVFrame *part = av_frame_alloc();
+        ASSERT_TRUE(decode(encoded[i].data(), encoded[i].size(), part));
+        for (int p = 0; p < 3; ++p)
+        {
+            int rows = p ? (heights[i] + 1) / 2 : heights[i];
+            int sy = p ? y0 / 2 : y0;
+            int w = p ? width / 2 : width;
+            for (int y = 0; y < rows; ++y)
+                ASSERT_EQ(memcmp(part->data[p] + y * part->linesize[p], whole->data[p] + (sy + y) * whole->linesize[p], w), 0);
+        }
+        av_frame_free(&part);
+        y0 += heights[i];
+    }
+    av_frame_free(&whole);
+}
+
+// 场景：码率控制闭环。合成帧大小与 qscale 成反比，按字节/秒或字节/帧预算都收敛到对应的 qscale 并保持在 [min, max] 内
+TEST(RateControllerTest, ConvergesToBudgetWithinBounds) {
+    // 复杂度 400000：qscale 为 q 时一帧 400000 / q 字节，25fps
+    auto run = [](RateController &rc, int base, int frames, int minQ, int maxQ, std::vector<int> &qs)
+    {
+        for (int i = 0; i < frames; ++i)
+        {
+            int q = rc.NextQuality(base);
+            EXPECT_GE(q, minQ);
+            EXPECT_LE(q, maxQ);
+            qs.push_back(q);
+            rc.Update(400000 / q, i * 40);
+        }
+    };
+
+    // 500KB/s @ 25fps -> 每帧 20000 字节 -> qscale 20
+    RateController perSecond;
+    EXPECT_FALSE(perSecond.Enabled());
+    perSecond.Configure(500000, 0, 4, 24);
+    EXPECT_TRUE(perSecond.Enabled());
+    std::vector<int> qs;
+    run(perSecond, 8, 200, 4, 24, qs);
+    for (size_t i = qs.size() - 20; i < qs.size(); ++i)
+        EXPECT_NEAR(qs[i], 20, 1);
+    RateStats stats = perSecond.Stats();
+    EXPECT_TRUE(stats.enabled);
+    EXPECT_EQ(stats.quality, qs.back());
+    EXPECT_NEAR(stats.targetBytes, 20000, 200);
+    EXPECT_NEAR(stats.avgBytes, 20000, 2000);
+    EXPECT_NEAR(stats.bytesPerSecond, 500000, 50000);
+
+    // 每帧 50000 字节 -> qscale 8，从较高的质量数值往下收敛
+    RateController perFrame;
+    perFrame.Configure(0, 50000, 2, 31);
+    qs.clear();
+    run(perFrame, 20, 200, 2, 31, qs);
+    for (size_t i = qs.size() - 20; i < qs.size(); ++i)
+        EXPECT_NEAR(qs[i], 8, 1);
+    stats = perFrame.Stats();
+    EXPECT_EQ(stats.quality, qs.back());
+    EXPECT_DOUBLE_EQ(stats.targetBytes, 50000);
+    EXPECT_NEAR(stats.avgBytes, 50000, 5000);
+
+    // 预算小到上限也达不到：停在 maxQ
+    RateController capped;
+    capped.Configure(0, 5000, 2, 20);
+    qs.clear();
+    run(capped, 8, 100, 2, 20, qs);
+    EXPECT_EQ(qs.back(), 20);
+    EXPECT_EQ(capped.Stats().quality, 20);
+
+    // 关闭后统计随之关闭
+    capped.Configure(0, 0, 2, 20);
+    EXPECT_FALSE(capped.Enabled());
+    EXPECT_FALSE(capped.Stats().enabled);
+}
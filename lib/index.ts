@@ -5,12 +5,41 @@ const nativeAddon = require('./module-ffmplayer-core.node');
 
 declare interface FrameData {
     success: boolean;
-    data?: Buffer; // 只有 success 为 true 时才有
+    seq: number;          // 发布序号，画面有变化才递增；作为 getNextFrame 的 lastSeq 传回可跳过重复帧
+    notModified?: boolean; // 条件获取：自 lastSeq 以来没有新帧（此时 success 为 false，无 data）
+    data?: Buffer; // 只有 success 为 true 时才有；与其他读者共享同一块内存，只读，不要修改
     width?: number;
     height?: number;
     timestamp?: number;
+    keyframe?: boolean;   // data 以关键帧开头（mjpeg 每帧都是）
+    codec?: string;       // 编码格式，如 "mjpeg" / "h264" / "mpeg4"
+    extradata?: Buffer;   // 帧间编码的关键帧附带的序列头（SPS/PPS 或 VOL）
+    format?: RawFormat;   // 原始像素输出的格式（codec 为 "rawvideo"）
+    offsets?: number[];   // 原始像素输出：各平面在 data 中的起始偏移（字节）
+    strides?: number[];   // 原始像素输出：各平面的行步长（字节，可能大于有效宽度）
 }
 
+declare interface FrameRequest {
+    devId: string;
+    index: number;
+    rendition?: number; // 档位 id，省略或 0 为主输出
+    lastSeq?: number;   // 上次拿到的 seq，没有新帧的流不出现在结果中
+}
+
+declare interface BatchFrame extends FrameData {
+    request: number; // 在请求数组中的下标
+    offset?: number; // packed 时：数据在 BatchFrames.data 中的起始偏移
+    size?: number;   // packed 时：数据长度（字节）
+}
+
+declare interface BatchFrames {
+    frames: BatchFrame[]; // 只含有新帧的流
+    data?: ArrayBuffer;   // packed 时所有帧数据连续存放于此，帧上不再带 data
+}
+
+declare type RawFormat = 'i420' | 'nv12' | 'rgba';
+declare type VideoCodec = 'mjpeg' | 'h264' | 'mpeg4' | RawFormat;
+
 declare interface MediaInfo {
     valid: boolean;
     type: string;     // e.g., "video", "img", "gif", "unknown"
@@ -21,6 +50,62 @@ declare interface MediaInfo {
     dar: string;      // Display Aspect Ratio
 }
 
+declare interface StreamStats {
+    valid: boolean;
+    encodedFrames: number; // 实际编码的帧数
+    skippedFrames: number; // 静态画面检测跳过编码的帧数
+    rate: RateStats;       // 码率控制状态
+    jpegMode: number;      // MJPEG 压缩域直出 0 关闭 / 1 透传 / 2 无损裁剪
+    jpegFrames: number;    // 压缩域直出的帧数（不经过解码和编码）
+    renditions: number;    // 附加输出档位数（不含主输出）
+    renditionEncodedFrames: number; // 附加档位合计编码的帧数
+    dropLevel: number;      // 追帧等级 0 正常 / 1 跳过非参考帧 / 2 只解关键帧
+    droppedPackets: number; // 送解码前丢弃的包
+    lateFrames: number;     // 解码后迟到的帧，帧内编码的输出被丢弃
+    nonRefSkips: number;    // 进入"跳过非参考帧"的次数
+    nonKeySkips: number;    // 进入"只解关键帧"的次数
+    syncDriftMs: number;    // 相对同步组 master 的偏差（毫秒），未加入同步组时为 0
+    decodeLowres: number;   // 降分辨率解码级别：0 原始尺寸，n 表示按 1/2^n 解码
+    wakeJitter: JitterHistogram; // 帧同步定时唤醒的抖动
+    demuxQueueBytes: number;   // 解复用预读队列当前字节数
+    demuxQueueMs: number;      // 解复用预读队列当前时长（毫秒）
+    demuxQueuePackets: number; // 解复用预读队列当前包数
+    demuxMaxBytes: number;     // 预读字节上限
+    demuxMaxMs: number;        // 预读时长上限（毫秒）
+    demuxUnderruns: number;    // 解码时队列为空的次数（I/O 没跟上）
+    demuxStalls: number;       // 预读因队列满而暂停的次数
+    presentQueueFrames: number; // 预解码呈现队列当前帧数
+    presentMaxFrames: number;   // 呈现队列帧数上限
+    presentMaxMs: number;       // 呈现队列时长上限（毫秒）
+    presentUnderruns: number;   // 到点时队列为空的次数（解码没跑在时钟前面）
+}
+
+declare interface RateStats {
+    enabled: boolean;
+    quality: number;        // 最近一帧使用的 qscale
+    targetBytes: number;    // 当前每帧预算（字节）
+    avgBytes: number;       // 最近帧大小的平均（字节）
+    bytesPerSecond: number; // 按实测帧间隔折算的输出码率
+    bucketBytes: number;    // 累计超出预算的字节，负数表示有结余
+}
+
+declare interface JitterHistogram {
+    bucketsUs: number[]; // 各桶上界（微秒）
+    counts: number[];    // 各桶计数，比 bucketsUs 多一桶（超过最大上界）
+    maxUs: number;       // 观测到的最大延迟
+}
+
+declare interface PacingStats {
+    spinUs: number;      // 到期前自旋窗口（微秒）
+    wakeJitter: JitterHistogram; // 所有流合计的唤醒抖动
+}
+
+declare interface SubscribeOptions {
+    rendition?: number;   // 档位 id，省略或 0 为主输出
+    latestOnly?: boolean; // 默认 true：回调返回后才投递下一帧，期间只保留最新一帧；false 时按顺序投递，最多 8 帧未处理完，积压超过 8 帧时丢最旧的
+    maxFps?: number;      // 投递频率上限，省略或 <=0 不限
+}
+
 declare interface CropResult {
     success: boolean;
     error?: string;
@@ -29,7 +114,7 @@ declare interface CropResult {
 // C++ 原生对象的接口契约 (不对外暴露，内部使用)
 interface INativeMediaManager {
     new(): INativeMediaManager;
-    addMedia(devId: string, index: number, url: string, x: number, y: number, sw: number, sh: number, ow: number, oh: number, startTime?: number, endTime?: number, quality?: number): boolean;
+    addMedia(devId: string, index: number, url: string, x: number, y: number, sw: number, sh: number, ow: number, oh: number, startTime?: number, endTime?: number, quality?: number, encoder?: VideoCodec, gop?: number): boolean;
     deleteMedia(devId: string, index: number): boolean;
     updateROI(devId: string, index: number, x: number, y: number, sw: number, sh: number): void;
     updateQuality(devId: string, index: number, quality: number): void;
@@ -37,7 +122,23 @@ interface INativeMediaManager {
     seekTo(devId: string, index: number, timeSec: number): void;
     pause(devId: string, index: number): boolean;
     resume(devId: string, index: number): boolean;
-    getNextFrame(devId: string, index: number): FrameData;
+    setEncodeOnDemand(devId: string, index: number, enabled: boolean): void;
+    setSceneThreshold(devId: string, index: number, threshold: number): void;
+    setEncoderThreads(devId: string, index: number, threads: number): void;
+    setRateControl(devId: string, index: number, bytesPerSecond: number, bytesPerFrame?: number, minQuality?: number, maxQuality?: number): boolean;
+    addRendition(devId: string, index: number, outW: number, outH: number, quality?: number, encoder?: VideoCodec, gop?: number): number;
+    removeRendition(devId: string, index: number, rendition: number): boolean;
+    getStats(devId: string, index: number): StreamStats;
+    joinSyncGroup(groupId: string, devId: string, index: number): boolean;
+    leaveSyncGroup(devId: string, index: number): boolean;
+    setDemuxLimits(devId: string, index: number, maxBytes: number, maxMs: number): void;
+    setPresentQueue(devId: string, index: number, maxFrames: number, maxMs: number): void;
+    setPacingSpin(spinUs: number): void;
+    getPacingStats(): PacingStats;
+    getNextFrame(devId: string, index: number, rendition?: number, requestKeyframe?: boolean, lastSeq?: number): FrameData;
+    getFrames(requests: FrameRequest[], packed?: boolean): BatchFrames;
+    subscribe(devId: string, index: number, callback: (frame: FrameData) => void, options?: SubscribeOptions): number;
+    unsubscribe(id: number): boolean;
 }
 
 // 2. 类接口 (包含静态方法)
@@ -110,6 +211,7 @@ export class MediaManager {
 
     /**
      * 添加媒体源
+     * 相同 url + startTime/endTime 的通道共享同一路解复用和解码，各自独立裁剪/缩放/编码
      * @param devId 设备ID/唯一标识
      * @param index 通道索引
      * @param url 视频流地址或文件路径
@@ -121,6 +223,11 @@ export class MediaManager {
      * @param oh 输出高度 (Output Height)
      * @param startTime 起始时间（秒），可选，仅视频生效
      * @param endTime 结束时间（秒），可选，仅视频生效
+     * @param quality 质量 qscale 1-31，越小越清晰，默认 8
+     * @param encoder 编码格式，默认 'mjpeg'；'h264'（libx264 不可用时回退 'mpeg4'）/ 'mpeg4' 为帧间编码，
+     *                getNextFrame 返回上次读取之后的全部数据，没有新数据时 success 为 false；
+     *                'i420' / 'nv12'（全范围 BT.601）/ 'rgba' 不编码，直接输出像素，供本机渲染上传纹理
+     * @param gop 帧间编码的关键帧间隔（帧），默认 50
      * @returns boolean 添加是否成功
      */
     addMedia(
@@ -130,9 +237,10 @@ export class MediaManager {
         x: number, y: number, sw: number, sh: number,
         ow: number, oh: number,
         startTime?: number, endTime?: number,
-        quality?: number
+        quality?: number,
+        encoder?: VideoCodec, gop?: number
     ): boolean {
-        return this._instance.addMedia(devId, index, url, x, y, sw, sh, ow, oh, startTime, endTime, quality);
+        return this._instance.addMedia(devId, index, url, x, y, sw, sh, ow, oh, startTime, endTime, quality, encoder, gop);
     }
 
     /**
@@ -194,6 +302,8 @@ export class MediaManager {
 
     /**
      * 跳转到指定时间
+     * 如果该通道与其他通道共享解码源，会为它单独打开一路私有源，不影响其他通道
+     * 如果该通道在同步组中，整组一起跳转
      * @param devId 设备ID/唯一标识
      * @param index 通道索引
      * @param timeSec 目标时间（秒）
@@ -204,6 +314,8 @@ export class MediaManager {
 
     /**
      * 暂停播放
+     * 每个解码源有自己的时钟，暂停不影响其他通道
+     * 共享解码源的通道暂停后只是不再接收新帧，所有通道都暂停时才停止解码
      * @param devId 设备ID/唯一标识
      * @param index 通道索引
      * @returns boolean 暂停是否成功
@@ -222,14 +334,206 @@ export class MediaManager {
         return this._instance.resume(devId, index);
     }
 
+    /**
+     * 按需编码模式
+     * 开启后解码线程只保留最新一帧 YUV，调用 getNextFrame 时才编码，
+     * 结果缓存到下一帧到来；适合轮询频率低于源帧率的场景
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @param enabled 是否开启
+     */
+    setEncodeOnDemand(devId: string, index: number, enabled: boolean): void {
+        this._instance.setEncodeOnDemand(devId, index, enabled);
+    }
+
+    /**
+     * 静态画面检测阈值
+     * 画面未变化时复用上一帧 JPEG，只更新时间戳
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @param threshold 32x32 分片平均亮度差 (0-255)，<0 关闭，0 只跳过完全相同的画面
+     */
+    setSceneThreshold(devId: string, index: number, threshold: number): void {
+        this._instance.setSceneThreshold(devId, index, threshold);
+    }
+
+    /**
+     * 单帧并行编码线程数（MJPEG 按重启间隔分片并行），作用于主输出和附加档位
+     * 4K 等大尺寸输出单线程编码赶不上帧率时调大；每线程至少分到 64 行，小尺寸输出自动减少线程
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @param threads 线程数，默认 1
+     */
+    setEncoderThreads(devId: string, index: number, threads: number): void {
+        this._instance.setEncoderThreads(devId, index, threads);
+    }
+
+    /**
+     * 字节预算码率控制（仅 MJPEG 主输出）
+     * 按最近几帧的大小逐帧调整 qscale，替代 updateQuality 的固定质量；状态见 getStats().rate
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @param bytesPerSecond 每秒字节预算，按实测帧间隔折算到每帧；0 表示不限
+     * @param bytesPerFrame 每帧字节预算，与 bytesPerSecond 同时给出时取较小者；两者都为 0 时关闭
+     * @param minQuality qscale 下限（最清晰），默认 2
+     * @param maxQuality qscale 上限（最模糊），默认 31
+     * @returns boolean 是否生效（非 MJPEG 输出返回 false）
+     */
+    setRateControl(devId: string, index: number, bytesPerSecond: number, bytesPerFrame?: number, minQuality?: number, maxQuality?: number): boolean {
+        return this._instance.setRateControl(devId, index, bytesPerSecond, bytesPerFrame, minQuality, maxQuality);
+    }
+
+    /**
+     * 添加输出档位
+     * 同一 ROI 再输出一种尺寸 / 质量（如网格缩略图、聚焦视图、全屏），只裁剪一次，
+     * 各档按尺寸从大到小由上一档级联缩小，每多一档只增加一次缩小和编码的开销
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @param outW 输出宽度
+     * @param outH 输出高度
+     * @param quality qscale 1-31, 1=最高质量，默认 8
+     * @param encoder 本档的编码格式，默认 'mjpeg'，取值与 addMedia 相同，可与主输出不同
+     * @param gop 帧间编码的关键帧间隔（帧），默认 50
+     * @returns number 档位 id（>0），传给 getNextFrame 选择；失败返回 -1
+     */
+    addRendition(devId: string, index: number, outW: number, outH: number, quality?: number, encoder?: VideoCodec, gop?: number): number {
+        return this._instance.addRendition(devId, index, outW, outH, quality, encoder, gop);
+    }
+
+    /**
+     * 移除输出档位
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @param rendition addRendition 返回的档位 id
+     * @returns boolean 是否移除
+     */
+    removeRendition(devId: string, index: number, rendition: number): boolean {
+        return this._instance.removeRendition(devId, index, rendition);
+    }
+
+    /**
+     * 获取通道运行统计
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @returns StreamStats 统计信息
+     */
+    getStats(devId: string, index: number): StreamStats {
+        return this._instance.getStats(devId, index);
+    }
+
+    /**
+     * 加入同步组
+     * 组内通道以同一个 master 时钟为准逐帧校正漂移，seek / 循环对整组生效，
+     * 适合同一事件的多路画面拼接（电视墙）；组不存在时自动创建
+     * 共享解码源的通道加入后，同一源上的其他通道也随之同步
+     * @param groupId 同步组ID
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @returns boolean 是否加入成功（静态图片不能加入）
+     */
+    joinSyncGroup(groupId: string, devId: string, index: number): boolean {
+        return this._instance.joinSyncGroup(groupId, devId, index);
+    }
+
+    /**
+     * 离开同步组，之后按自己的时钟播放；最后一个通道离开时组被销毁
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @returns boolean 操作是否成功
+     */
+    leaveSyncGroup(devId: string, index: number): boolean {
+        return this._instance.leaveSyncGroup(devId, index);
+    }
+
+    /**
+     * 设置解复用预读上限
+     * 读取在独立的 I/O 线程上预读到有界队列，吸收网络 / 磁盘抖动；
+     * 字节数或时长任一达到上限即暂停预读，直播源的额外延迟不超过 maxMs
+     * 共享解码源的通道设置的是同一个队列
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @param maxBytes 最大字节数（默认 4MB）
+     * @param maxMs 最大时长（毫秒，默认 500）
+     */
+    setDemuxLimits(devId: string, index: number, maxBytes: number, maxMs: number): void {
+        this._instance.setDemuxLimits(devId, index, maxBytes, maxMs);
+    }
+
+    /**
+     * 设置预解码呈现队列上限
+     * 解码线程提前完成解码 / 裁剪 / 编码并排队，到点由呈现线程发布，
+     * 大 I 帧解码慢于一帧间隔时不会拖迟下一次呈现；帧数或时长任一达到上限即暂停解码
+     * 共享解码源的通道设置的是同一个队列
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @param maxFrames 最多超前的帧数（默认 3，至少 1）
+     * @param maxMs 最多超前的时长（毫秒，默认 200）
+     */
+    setPresentQueue(devId: string, index: number, maxFrames: number, maxMs: number): void {
+        this._instance.setPresentQueue(devId, index, maxFrames, maxMs);
+    }
+
+    /**
+     * 设置呈现调度器的自旋窗口
+     * 到期前 spinUs 微秒内不再进内核等待而是自旋，唤醒更准但会多占少量 CPU
+     * @param spinUs 自旋窗口（微秒），0 关闭
+     */
+    setPacingSpin(spinUs: number): void {
+        this._instance.setPacingSpin(spinUs);
+    }
+
+    /**
+     * 获取呈现调度器状态（所有通道合计的唤醒抖动直方图）
+     * @returns PacingStats 调度器状态
+     */
+    getPacingStats(): PacingStats {
+        return this._instance.getPacingStats();
+    }
+
+    /**
+     * 订阅一路输出的新帧（推送式，代替轮询 getNextFrame）
+     * 有新帧发布时回调，数据与 getNextFrame 的返回值相同；帧间编码从关键帧开始，未投递的数据按顺序拼接不会丢失
+     * @param devId 设备ID/唯一标识
+     * @param index 通道索引
+     * @param callback 在 JS 线程上调用，应尽快返回
+     * @param options 订阅选项
+     * @returns 订阅 id，失败返回 -1
+     */
+    subscribe(devId: string, index: number, callback: (frame: FrameData) => void, options?: SubscribeOptions): number {
+        return this._instance.subscribe(devId, index, callback, options);
+    }
+
+    /**
+     * 取消订阅；通道被删除时订阅自动失效，仍可调用本方法释放
+     * @param id subscribe 返回的订阅 id
+     * @returns 订阅仍有效并已取消返回 true
+     */
+    unsubscribe(id: number): boolean {
+        return this._instance.unsubscribe(id);
+    }
+
     /**
      * 获取下一帧数据 (阻塞式)
      * @param devId 设备ID/唯一标识
      * @param index 通道索引
+     * @param rendition 档位 id，省略或 0 为主输出
+     * @param requestKeyframe 帧间编码的新读者置为 true：保证拿到的数据从关键帧开始，
+     *                        必要时本次返回空并让编码器尽快输出关键帧
+     * @param lastSeq 上次拿到的 seq：没有新帧时只返回 notModified，不拷贝也不编码
      * @returns FrameData 帧数据对象
      */
-    getNextFrame(devId: string, index: number): FrameData {
-        return this._instance.getNextFrame(devId, index);
+    getNextFrame(devId: string, index: number, rendition?: number, requestKeyframe?: boolean, lastSeq?: number): FrameData {
+        return this._instance.getNextFrame(devId, index, rendition, requestKeyframe, lastSeq);
+    }
+
+    /**
+     * 批量获取多路流的新帧：一次调用、一次注册表查找，代替逐路调用 getNextFrame
+     * @param requests 各路流及其上次拿到的 seq
+     * @param packed 为 true 时所有帧数据拷入同一个 ArrayBuffer，按 offset / size 切分
+     * @returns BatchFrames 只含有新帧的流
+     */
+    getFrames(requests: FrameRequest[], packed?: boolean): BatchFrames {
+        return this._instance.getFrames(requests, packed);
     }
 
     /**
@@ -300,7 +604,23 @@ function registerSelf() {
       { name: 'seekTo', description: '跳转到指定时间' },
       { name: 'pause', description: '暂停播放' },
       { name: 'resume', description: '恢复播放' },
+      { name: 'setEncodeOnDemand', description: '按需编码模式' },
+      { name: 'setSceneThreshold', description: '静态画面检测阈值' },
+      { name: 'setEncoderThreads', description: '单帧并行编码线程数' },
+      { name: 'setRateControl', description: '字节预算码率控制' },
+      { name: 'addRendition', description: '添加输出档位' },
+      { name: 'removeRendition', description: '移除输出档位' },
+      { name: 'getStats', description: '获取通道运行统计' },
+      { name: 'joinSyncGroup', description: '加入同步组' },
+      { name: 'leaveSyncGroup', description: '离开同步组' },
+      { name: 'setDemuxLimits', description: '设置解复用预读上限' },
+      { name: 'setPresentQueue', description: '设置预解码呈现队列上限' },
+      { name: 'setPacingSpin', description: '设置呈现调度自旋窗口' },
+      { name: 'getPacingStats', description: '获取呈现调度器状态' },
       { name: 'getNextFrame', description: '获取下一帧' },
+      { name: 'getFrames', description: '批量获取多路新帧' },
+      { name: 'subscribe', description: '订阅新帧推送' },
+      { name: 'unsubscribe', description: '取消订阅' },
       { name: 'cropMedia', description: '裁剪/缩放媒体文件' }
     ]
   }
@@ -351,7 +671,9 @@ function handleMediaManagerRequest(e: MessageEvent) {
           payload.oh,
           payload.startTime,
           payload.endTime,
-          payload.quality
+          payload.quality,
+          payload.encoder,
+          payload.gop
         )
         break
       case 'deleteMedia':
@@ -386,8 +708,68 @@ function handleMediaManagerRequest(e: MessageEvent) {
       case 'resume':
         result = mediaManager.resume(payload.devId, payload.index)
         break
+      case 'setEncodeOnDemand':
+        mediaManager.setEncodeOnDemand(payload.devId, payload.index, payload.enabled)
+        result = true
+        break
+      case 'setSceneThreshold':
+        mediaManager.setSceneThreshold(payload.devId, payload.index, payload.threshold)
+        result = true
+        break
+      case 'setEncoderThreads':
+        mediaManager.setEncoderThreads(payload.devId, payload.index, payload.threads)
+        result = true
+        break
+      case 'setRateControl':
+        result = mediaManager.setRateControl(payload.devId, payload.index, payload.bytesPerSecond, payload.bytesPerFrame, payload.minQuality, payload.maxQuality)
+        break
+      case 'addRendition':
+        result = mediaManager.addRendition(payload.devId, payload.index, payload.outW, payload.outH, payload.quality, payload.encoder, payload.gop)
+        break
+      case 'removeRendition':
+        result = mediaManager.removeRendition(payload.devId, payload.index, payload.rendition)
+        break
+      case 'getStats':
+        result = mediaManager.getStats(payload.devId, payload.index)
+        break
+      case 'joinSyncGroup':
+        result = mediaManager.joinSyncGroup(payload.groupId, payload.devId, payload.index)
+        break
+      case 'leaveSyncGroup':
+        result = mediaManager.leaveSyncGroup(payload.devId, payload.index)
+        break
+      case 'setDemuxLimits':
+        mediaManager.setDemuxLimits(payload.devId, payload.index, payload.maxBytes, payload.maxMs)
+        result = true
+        break
+      case 'setPresentQueue':
+        mediaManager.setPresentQueue(payload.devId, payload.index, payload.maxFrames, payload.maxMs)
+        result = true
+        break
+      case 'setPacingSpin':
+        mediaManager.setPacingSpin(payload.spinUs)
+        result = true
+        break
+      case 'getPacingStats':
+        result = mediaManager.getPacingStats()
+        break
       case 'getNextFrame':
-        result = mediaManager.getNextFrame(payload.devId, payload.index)
+        result = mediaManager.getNextFrame(payload.devId, payload.index, payload.rendition, payload.requestKeyframe, payload.lastSeq)
+        break
+      case 'getFrames':
+        result = mediaManager.getFrames(payload.requests, payload.packed)
+        break
+      case 'subscribe': {
+        const target = e.ports && e.ports[0] ? e.ports[0] : workerProcess.parentPort
+        // 推送的帧经同一通道以 media-manager-frame 消息送回
+        const subId: number = mediaManager.subscribe(payload.devId, payload.index, (frame) => {
+          target?.postMessage({ type: 'media-manager-frame', subscription: subId, frame })
+        }, payload.options)
+        result = subId
+        break
+      }
+      case 'unsubscribe':
+        result = mediaManager.unsubscribe(payload.id)
         break
       case 'cropMedia':
         result = mediaManager.cropMedia(
@@ -466,7 +848,9 @@ function handleMediaManagerRequestFromPort(e: MessageEvent, sourcePluginId: stri
           payload.oh,
           payload.startTime,
           payload.endTime,
-          payload.quality
+          payload.quality,
+          payload.encoder,
+          payload.gop
         )
         break
       case 'deleteMedia':
@@ -501,8 +885,67 @@ function handleMediaManagerRequestFromPort(e: MessageEvent, sourcePluginId: stri
       case 'resume':
         result = mediaManager.resume(payload.devId, payload.index)
         break
+      case 'setEncodeOnDemand':
+        mediaManager.setEncodeOnDemand(payload.devId, payload.index, payload.enabled)
+        result = true
+        break
+      case 'setSceneThreshold':
+        mediaManager.setSceneThreshold(payload.devId, payload.index, payload.threshold)
+        result = true
+        break
+      case 'setEncoderThreads':
+        mediaManager.setEncoderThreads(payload.devId, payload.index, payload.threads)
+        result = true
+        break
+      case 'setRateControl':
+        result = mediaManager.setRateControl(payload.devId, payload.index, payload.bytesPerSecond, payload.bytesPerFrame, payload.minQuality, payload.maxQuality)
+        break
+      case 'addRendition':
+        result = mediaManager.addRendition(payload.devId, payload.index, payload.outW, payload.outH, payload.quality, payload.encoder, payload.gop)
+        break
+      case 'removeRendition':
+        result = mediaManager.removeRendition(payload.devId, payload.index, payload.rendition)
+        break
+      case 'getStats':
+        result = mediaManager.getStats(payload.devId, payload.index)
+        break
+      case 'joinSyncGroup':
+        result = mediaManager.joinSyncGroup(payload.groupId, payload.devId, payload.index)
+        break
+      case 'leaveSyncGroup':
+        result = mediaManager.leaveSyncGroup(payload.devId, payload.index)
+        break
+      case 'setDemuxLimits':
+        mediaManager.setDemuxLimits(payload.devId, payload.index, payload.maxBytes, payload.maxMs)
+        result = true
+        break
+      case 'setPresentQueue':
+        mediaManager.setPresentQueue(payload.devId, payload.index, payload.maxFrames, payload.maxMs)
+        result = true
+        break
+      case 'setPacingSpin':
+        mediaManager.setPacingSpin(payload.spinUs)
+        result = true
+        break
+      case 'getPacingStats':
+        result = mediaManager.getPacingStats()
+        break
       case 'getNextFrame':
-        result = mediaManager.getNextFrame(payload.devId, payload.index)
+        result = mediaManager.getNextFrame(payload.devId, payload.index, payload.rendition, payload.requestKeyframe, payload.lastSeq)
+        break
+      case 'getFrames':
+        result = mediaManager.getFrames(payload.requests, payload.packed)
+        break
+      case 'subscribe': {
+        // 推送的帧经同一通道以 media-manager-frame 消息送回
+        const subId: number = mediaManager.subscribe(payload.devId, payload.index, (frame) => {
+          port.postMessage({ type: 'media-manager-frame', subscription: subId, frame })
+        }, payload.options)
+        result = subId
+        break
+      }
+      case 'unsubscribe':
+        result = mediaManager.unsubscribe(payload.id)
         break
       case 'cropMedia':
         result = mediaManager.cropMedia(
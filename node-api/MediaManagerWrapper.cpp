@@ -1,6 +1,139 @@
 #include "MediaManagerWrapper.h"
 #include <MediaProcessor.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace
+{
+    // 抖动直方图 -> JS: { bucketsUs: 各桶上界, counts: 各桶计数（比上界多一桶）}
+    Napi::Object JitterToJs(Napi::Env env, const std::array<uint64_t, JitterHistogram::kBuckets> &counts, int64_t maxUs)
+    {
+        Napi::Array bounds = Napi::Array::New(env, JitterHistogram::kBuckets - 1);
+        for (uint32_t i = 0; i < JitterHistogram::kBuckets - 1; ++i)
+            bounds.Set(i, Napi::Number::New(env, static_cast<double>(JitterHistogram::kUpperUs[i])));
+        Napi::Array values = Napi::Array::New(env, JitterHistogram::kBuckets);
+        for (uint32_t i = 0; i < JitterHistogram::kBuckets; ++i)
+            values.Set(i, Napi::Number::New(env, static_cast<double>(counts[i])));
+
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("bucketsUs", bounds);
+        obj.Set("counts", values);
+        obj.Set("maxUs", Napi::Number::New(env, static_cast<double>(maxUs)));
+        return obj;
+    }
+
+    Napi::Object RateToJs(Napi::Env env, const RateStats &rate)
+    {
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("enabled", Napi::Boolean::New(env, rate.enabled));
+        obj.Set("quality", Napi::Number::New(env, rate.quality));
+        obj.Set("targetBytes", Napi::Number::New(env, rate.targetBytes));
+        obj.Set("avgBytes", Napi::Number::New(env, rate.avgBytes));
+        obj.Set("bytesPerSecond", Napi::Number::New(env, rate.bytesPerSecond));
+        obj.Set("bucketBytes", Napi::Number::New(env, rate.bucketBytes));
+        return obj;
+    }
+
+    // 一帧的元数据 -> JS: { success, seq, notModified?, width, height, timestamp, keyframe, codec?, extradata?, format?, offsets?, strides? }
+    void FrameMetaToJs(Napi::Env env, const EncoderOutput &frame, Napi::Object &obj)
+    {
+        obj.Set("success", Napi::Boolean::New(env, frame.success));
+        obj.Set("seq", Napi::Number::New(env, static_cast<double>(frame.seq)));
+        if (frame.not_modified)
+            obj.Set("notModified", Napi::Boolean::New(env, true));
+        if (!frame.success)
+            return;
+
+        obj.Set("width", Napi::Number::New(env, frame.width));
+        obj.Set("height", Napi::Number::New(env, frame.height));
+        obj.Set("timestamp", Napi::Number::New(env, frame.timestamp));
+        obj.Set("keyframe", Napi::Boolean::New(env, frame.keyframe));
+        if (frame.codec != AV_CODEC_ID_NONE)
+            obj.Set("codec", Napi::String::New(env, avcodec_get_name(frame.codec)));
+        // 帧间编码的关键帧附带序列头，供 WebCodecs 等解码端配置
+        if (!frame.extradata.empty())
+            obj.Set("extradata", Napi::Buffer<uint8_t>::Copy(env, frame.extradata.data(), frame.extradata.size()));
+        // 原始像素：各平面在 data 中的偏移与步长（字节）
+        if (frame.planes > 0)
+        {
+            obj.Set("format", Napi::String::New(env, frame.format == AV_PIX_FMT_YUVJ420P ? "i420" : av_get_pix_fmt_name(frame.format)));
+            Napi::Array offsets = Napi::Array::New(env, frame.planes);
+            Napi::Array strides = Napi::Array::New(env, frame.planes);
+            for (int p = 0; p < frame.planes; ++p)
+            {
+                offsets.Set(p, Napi::Number::New(env, static_cast<double>(frame.offset[p])));
+                strides.Set(p, Napi::Number::New(env, frame.linesize[p]));
+            }
+            obj.Set("offsets", offsets);
+            obj.Set("strides", strides);
+        }
+    }
+
+    // 一帧编码结果 -> JS: 元数据 + data: Buffer
+    Napi::Object FrameToJs(Napi::Env env, EncoderOutput &&frame)
+    {
+        Napi::Object obj = Napi::Object::New(env);
+        FrameMetaToJs(env, frame, obj);
+        if (frame.success)
+        {
+            // 外部 Buffer 直接指向编码结果，持有一份引用，JS 回收时释放；
+            // 不允许外部 Buffer 的运行时（如开启 V8 沙箱的 Electron）自动退回拷贝
+            auto *hold = new SharedBuffer(std::move(frame.data));
+            obj.Set("data", Napi::Buffer<uint8_t>::NewOrCopy(
+                                env, const_cast<uint8_t *>(hold->data()), hold->size(),
+                                [](Napi::Env, uint8_t *, SharedBuffer *buf)
+                                { delete buf; },
+                                hold));
+        }
+        return obj;
+    }
+
+    // 编码格式：'mjpeg'（默认，每帧独立）/ 'h264' / 'mpeg4'（帧间编码，带宽更小）；gop 为关键帧间隔
+    // 'i420' / 'nv12' / 'rgba'：不编码，直接输出像素给本机渲染。不认识的格式返回 nullptr
+    std::unique_ptr<IEncoder> MakeEncoder(const std::string &codec, int gop)
+    {
+        if (codec == "mjpeg")
+            return std::make_unique<MjpegEncoder>();
+        if (codec == "h264")
+            return std::make_unique<VideoEncoder>(VideoEncoder::Codec::H264, gop);
+        if (codec == "mpeg4")
+            return std::make_unique<VideoEncoder>(VideoEncoder::Codec::Mpeg4, gop);
+        if (codec == "i420")
+            return std::make_unique<RawEncoder>(RawEncoder::Format::I420);
+        if (codec == "nv12")
+            return std::make_unique<RawEncoder>(RawEncoder::Format::NV12);
+        if (codec == "rgba")
+            return std::make_unique<RawEncoder>(RawEncoder::Format::RGBA);
+        return nullptr;
+    }
+
+    // 推送订阅的 JS 端出口：投递线程经 ThreadSafeFunction 把帧转交到 JS 线程。
+    // 订阅取消时（退订、删流、删 rendition、析构）由取消回调释放，之后的投递直接丢弃
+    struct JsSink
+    {
+        std::mutex mtx;
+        Napi::ThreadSafeFunction tsfn;
+        bool released = false;
+
+        template <typename Callback>
+        bool Call(EncoderOutput *frame, Callback cb)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            return !released && tsfn.NonBlockingCall(frame, cb) == napi_ok;
+        }
+
+        void Release()
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (released)
+                return;
+            released = true;
+            tsfn.Release();
+        }
+    };
+}
 
 Napi::Object MediaManagerWrapper::Init(Napi::Env env, Napi::Object exports)
 {
@@ -9,12 +142,28 @@ Napi::Object MediaManagerWrapper::Init(Napi::Env env, Napi::Object exports)
                                           InstanceMethod("addMedia", &MediaManagerWrapper::AddMedia),
                                           InstanceMethod("deleteMedia", &MediaManagerWrapper::DeleteMedia),
                                           InstanceMethod("getNextFrame", &MediaManagerWrapper::GetNextFrame),
+                                          InstanceMethod("getFrames", &MediaManagerWrapper::GetFrames),
                                           InstanceMethod("updateROI", &MediaManagerWrapper::UpdateROI),
                                           InstanceMethod("updateQuality", &MediaManagerWrapper::UpdateQuality),
                                           InstanceMethod("updateOutputSize", &MediaManagerWrapper::UpdateOutputSize),
                                           InstanceMethod("seekTo", &MediaManagerWrapper::SeekTo),
                                           InstanceMethod("pause", &MediaManagerWrapper::Pause),
                                           InstanceMethod("resume", &MediaManagerWrapper::Resume),
+                                          InstanceMethod("setEncodeOnDemand", &MediaManagerWrapper::SetEncodeOnDemand),
+                                          InstanceMethod("setSceneThreshold", &MediaManagerWrapper::SetSceneThreshold),
+                                          InstanceMethod("setEncoderThreads", &MediaManagerWrapper::SetEncoderThreads),
+                                          InstanceMethod("setRateControl", &MediaManagerWrapper::SetRateControl),
+                                          InstanceMethod("addRendition", &MediaManagerWrapper::AddRendition),
+                                          InstanceMethod("removeRendition", &MediaManagerWrapper::RemoveRendition),
+                                          InstanceMethod("getStats", &MediaManagerWrapper::GetStats),
+                                          InstanceMethod("joinSyncGroup", &MediaManagerWrapper::JoinSyncGroup),
+                                          InstanceMethod("leaveSyncGroup", &MediaManagerWrapper::LeaveSyncGroup),
+                                          InstanceMethod("setDemuxLimits", &MediaManagerWrapper::SetDemuxLimits),
+                                          InstanceMethod("setPresentQueue", &MediaManagerWrapper::SetPresentQueue),
+                                          InstanceMethod("setPacingSpin", &MediaManagerWrapper::SetPacingSpin),
+                                          InstanceMethod("getPacingStats", &MediaManagerWrapper::GetPacingStats),
+                                          InstanceMethod("subscribe", &MediaManagerWrapper::Subscribe),
+                                          InstanceMethod("unsubscribe", &MediaManagerWrapper::Unsubscribe),
                                       });
 
     Napi::FunctionReference *constructor = new Napi::FunctionReference();
@@ -31,7 +180,7 @@ MediaManagerWrapper::MediaManagerWrapper(const Napi::CallbackInfo &info)
     _manager = std::make_unique<MediaManager>();
 }
 
-// JS: addMedia(deviceId, index, url, x, y, sw, sh, ow, oh)
+// JS: addMedia(deviceId, index, url, x, y, sw, sh, ow, oh, startTime?, endTime?, quality?, encoder?, gop?)
 Napi::Value MediaManagerWrapper::AddMedia(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
@@ -56,7 +205,19 @@ Napi::Value MediaManagerWrapper::AddMedia(const Napi::CallbackInfo &info)
         if (info.Length() > 11 && info[11].IsNumber())
             config.quality = info[11].As<Napi::Number>().Int32Value();
 
-        auto encoder = std::make_unique<MjpegEncoder>();
+        std::string codec = "mjpeg";
+        if (info.Length() > 12 && info[12].IsString())
+            codec = info[12].As<Napi::String>().Utf8Value();
+        int gop = 50;
+        if (info.Length() > 13 && info[13].IsNumber())
+            gop = info[13].As<Napi::Number>().Int32Value();
+
+        std::unique_ptr<IEncoder> encoder = MakeEncoder(codec, gop);
+        if (!encoder)
+        {
+            Napi::TypeError::New(env, "Expected: encoder 'mjpeg' | 'h264' | 'mpeg4' | 'i420' | 'nv12' | 'rgba'").ThrowAsJavaScriptException();
+            return env.Null();
+        }
         bool res = _manager->AddMedia(devId, index, url, config, std::move(encoder), startTime, endTime);
 
         return Napi::Boolean::New(env, res);
@@ -201,43 +362,499 @@ Napi::Value MediaManagerWrapper::Resume(const Napi::CallbackInfo &info)
     }
 }
 
-// JS: getNextFrame(deviceId, index) -> { data: Buffer, width, height, success }
+// JS: setEncodeOnDemand(deviceId, index, enabled)
+Napi::Value MediaManagerWrapper::SetEncodeOnDemand(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsBoolean())
+    {
+        Napi::TypeError::New(env, "Expected: setEncodeOnDemand(deviceId: string, index: number, enabled: boolean)")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    _manager->SetEncodeOnDemand(
+        info[0].As<Napi::String>(),
+        info[1].As<Napi::Number>(),
+        info[2].As<Napi::Boolean>().Value());
+    return env.Undefined();
+}
+
+// JS: setSceneThreshold(deviceId, index, threshold)
+Napi::Value MediaManagerWrapper::SetSceneThreshold(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: setSceneThreshold(deviceId: string, index: number, threshold: number)")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    _manager->SetSceneThreshold(
+        info[0].As<Napi::String>(),
+        info[1].As<Napi::Number>(),
+        info[2].As<Napi::Number>().Int32Value());
+    return env.Undefined();
+}
+
+// JS: setRateControl(deviceId, index, bytesPerSecond, bytesPerFrame?, minQuality?, maxQuality?) -> boolean
+Napi::Value MediaManagerWrapper::SetRateControl(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: setRateControl(deviceId: string, index: number, bytesPerSecond: number, bytesPerFrame?: number, minQuality?: number, maxQuality?: number)")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    double bytesPerFrame = 0;
+    int minQuality = 2;
+    int maxQuality = 31;
+    if (info.Length() > 3 && info[3].IsNumber())
+        bytesPerFrame = info[3].As<Napi::Number>().DoubleValue();
+    if (info.Length() > 4 && info[4].IsNumber())
+        minQuality = info[4].As<Napi::Number>().Int32Value();
+    if (info.Length() > 5 && info[5].IsNumber())
+        maxQuality = info[5].As<Napi::Number>().Int32Value();
+    bool res = _manager->SetRateControl(
+        info[0].As<Napi::String>(),
+        info[1].As<Napi::Number>(),
+        info[2].As<Napi::Number>().DoubleValue(),
+        bytesPerFrame, minQuality, maxQuality);
+    return Napi::Boolean::New(env, res);
+}
+
+// JS: setEncoderThreads(deviceId, index, threads)
+Napi::Value MediaManagerWrapper::SetEncoderThreads(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: setEncoderThreads(deviceId: string, index: number, threads: number)")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    _manager->SetEncoderThreads(
+        info[0].As<Napi::String>(),
+        info[1].As<Napi::Number>(),
+        info[2].As<Napi::Number>().Int32Value());
+    return env.Undefined();
+}
+
+// JS: addRendition(deviceId, index, outW, outH, quality?, encoder?, gop?) -> rendition id (>0)，失败为 -1
+//     encoder / gop 与 addMedia 相同，每档可用不同的编码格式
+Napi::Value MediaManagerWrapper::AddRendition(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 4 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber() || !info[3].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: addRendition(deviceId: string, index: number, outW: number, outH: number, quality?: number, encoder?: string, gop?: number)")
+            .ThrowAsJavaScriptException();
+        return Napi::Number::New(env, -1);
+    }
+    int quality = 8;
+    if (info.Length() > 4 && info[4].IsNumber())
+        quality = info[4].As<Napi::Number>().Int32Value();
+    std::string codec = "mjpeg";
+    if (info.Length() > 5 && info[5].IsString())
+        codec = info[5].As<Napi::String>().Utf8Value();
+    int gop = 50;
+    if (info.Length() > 6 && info[6].IsNumber())
+        gop = info[6].As<Napi::Number>().Int32Value();
+    std::unique_ptr<IEncoder> encoder = MakeEncoder(codec, gop);
+    if (!encoder)
+    {
+        Napi::TypeError::New(env, "Expected: encoder 'mjpeg' | 'h264' | 'mpeg4' | 'i420' | 'nv12' | 'rgba'").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, -1);
+    }
+    int id = _manager->AddRendition(
+        info[0].As<Napi::String>(),
+        info[1].As<Napi::Number>(),
+        info[2].As<Napi::Number>(),
+        info[3].As<Napi::Number>(),
+        quality,
+        std::move(encoder));
+    return Napi::Number::New(env, id);
+}
+
+// JS: removeRendition(deviceId, index, rendition) -> boolean
+Napi::Value MediaManagerWrapper::RemoveRendition(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: removeRendition(deviceId: string, index: number, rendition: number)")
+            .ThrowAsJavaScriptException();
+        return Napi::Boolean::New(env, false);
+    }
+    bool res = _manager->RemoveRendition(
+        info[0].As<Napi::String>(),
+        info[1].As<Napi::Number>(),
+        info[2].As<Napi::Number>());
+    return Napi::Boolean::New(env, res);
+}
+
+// JS: getStats(deviceId, index) -> { valid, encodedFrames, skippedFrames, jpegMode, jpegFrames, renditions, renditionEncodedFrames, dropLevel, droppedPackets, lateFrames, nonRefSkips, nonKeySkips, syncDriftMs, decodeLowres, wakeJitter, demux*, present* }
+Napi::Value MediaManagerWrapper::GetStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: getStats(deviceId: string, index: number)")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    StreamStats stats = _manager->GetStats(info[0].As<Napi::String>(), info[1].As<Napi::Number>());
+
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("valid", Napi::Boolean::New(env, stats.valid));
+    obj.Set("encodedFrames", Napi::Number::New(env, static_cast<double>(stats.encodedFrames)));
+    obj.Set("skippedFrames", Napi::Number::New(env, static_cast<double>(stats.skippedFrames)));
+    obj.Set("rate", RateToJs(env, stats.rate));
+    obj.Set("jpegMode", Napi::Number::New(env, stats.jpegMode));
+    obj.Set("jpegFrames", Napi::Number::New(env, static_cast<double>(stats.jpegFrames)));
+    obj.Set("renditions", Napi::Number::New(env, static_cast<double>(stats.renditions)));
+    obj.Set("renditionEncodedFrames", Napi::Number::New(env, static_cast<double>(stats.renditionEncodedFrames)));
+    obj.Set("dropLevel", Napi::Number::New(env, stats.dropLevel));
+    obj.Set("droppedPackets", Napi::Number::New(env, static_cast<double>(stats.droppedPackets)));
+    obj.Set("lateFrames", Napi::Number::New(env, static_cast<double>(stats.lateFrames)));
+    obj.Set("nonRefSkips", Napi::Number::New(env, static_cast<double>(stats.nonRefSkips)));
+    obj.Set("nonKeySkips", Napi::Number::New(env, static_cast<double>(stats.nonKeySkips)));
+    obj.Set("syncDriftMs", Napi::Number::New(env, static_cast<double>(stats.syncDriftMs)));
+    obj.Set("decodeLowres", Napi::Number::New(env, stats.decodeLowres));
+    obj.Set("wakeJitter", JitterToJs(env, stats.wakeJitter, stats.wakeJitterMaxUs));
+    obj.Set("demuxQueueBytes", Napi::Number::New(env, static_cast<double>(stats.demuxQueueBytes)));
+    obj.Set("demuxQueueMs", Napi::Number::New(env, static_cast<double>(stats.demuxQueueMs)));
+    obj.Set("demuxQueuePackets", Napi::Number::New(env, static_cast<double>(stats.demuxQueuePackets)));
+    obj.Set("demuxMaxBytes", Napi::Number::New(env, static_cast<double>(stats.demuxMaxBytes)));
+    obj.Set("demuxMaxMs", Napi::Number::New(env, static_cast<double>(stats.demuxMaxMs)));
+    obj.Set("demuxUnderruns", Napi::Number::New(env, static_cast<double>(stats.demuxUnderruns)));
+    obj.Set("demuxStalls", Napi::Number::New(env, static_cast<double>(stats.demuxStalls)));
+    obj.Set("presentQueueFrames", Napi::Number::New(env, static_cast<double>(stats.presentQueueFrames)));
+    obj.Set("presentMaxFrames", Napi::Number::New(env, static_cast<double>(stats.presentMaxFrames)));
+    obj.Set("presentMaxMs", Napi::Number::New(env, static_cast<double>(stats.presentMaxMs)));
+    obj.Set("presentUnderruns", Napi::Number::New(env, static_cast<double>(stats.presentUnderruns)));
+    return obj;
+}
+
+// JS: setDemuxLimits(deviceId, index, maxBytes, maxMs)
+Napi::Value MediaManagerWrapper::SetDemuxLimits(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 4 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber() || !info[3].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: setDemuxLimits(deviceId: string, index: number, maxBytes: number, maxMs: number)")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    _manager->SetDemuxLimits(
+        info[0].As<Napi::String>(),
+        info[1].As<Napi::Number>(),
+        static_cast<size_t>(info[2].As<Napi::Number>().Int64Value()),
+        info[3].As<Napi::Number>().Int64Value());
+    return env.Undefined();
+}
+
+// JS: setPresentQueue(deviceId, index, maxFrames, maxMs)
+Napi::Value MediaManagerWrapper::SetPresentQueue(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 4 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber() || !info[3].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: setPresentQueue(deviceId: string, index: number, maxFrames: number, maxMs: number)")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    _manager->SetPresentQueue(
+        info[0].As<Napi::String>(),
+        info[1].As<Napi::Number>(),
+        static_cast<size_t>(std::max<int64_t>(0, info[2].As<Napi::Number>().Int64Value())),
+        info[3].As<Napi::Number>().Int64Value());
+    return env.Undefined();
+}
+
+// JS: setPacingSpin(spinUs)
+Napi::Value MediaManagerWrapper::SetPacingSpin(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: setPacingSpin(spinUs: number)")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    _manager->SetPacingSpin(info[0].As<Napi::Number>().Int32Value());
+    return env.Undefined();
+}
+
+// JS: getPacingStats() -> { spinUs, wakeJitter }
+Napi::Value MediaManagerWrapper::GetPacingStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    PacingStats stats = _manager->GetPacingStats();
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("spinUs", Napi::Number::New(env, stats.spinUs));
+    obj.Set("wakeJitter", JitterToJs(env, stats.wakeJitter, stats.wakeJitterMaxUs));
+    return obj;
+}
+
+// JS: joinSyncGroup(groupId, deviceId, index) -> boolean
+Napi::Value MediaManagerWrapper::JoinSyncGroup(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsString() || !info[2].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: joinSyncGroup(groupId: string, deviceId: string, index: number)")
+            .ThrowAsJavaScriptException();
+        return Napi::Boolean::New(env, false);
+    }
+    bool res = _manager->JoinSyncGroup(
+        info[0].As<Napi::String>(),
+        info[1].As<Napi::String>(),
+        info[2].As<Napi::Number>());
+    return Napi::Boolean::New(env, res);
+}
+
+// JS: leaveSyncGroup(deviceId, index) -> boolean
+Napi::Value MediaManagerWrapper::LeaveSyncGroup(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: leaveSyncGroup(deviceId: string, index: number)")
+            .ThrowAsJavaScriptException();
+        return Napi::Boolean::New(env, false);
+    }
+    bool res = _manager->LeaveSyncGroup(info[0].As<Napi::String>(), info[1].As<Napi::Number>());
+    return Napi::Boolean::New(env, res);
+}
+
+// JS: getNextFrame(deviceId, index, rendition?, requestKeyframe?, lastSeq?) -> { data: Buffer, width, height, success, seq, keyframe, codec, extradata? }
+//     lastSeq 为上次拿到的 seq：没有新帧时只返回 { success: false, notModified: true, seq }
 Napi::Value MediaManagerWrapper::GetNextFrame(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
     std::string devId = info[0].As<Napi::String>();
     int index = info[1].As<Napi::Number>();
+    int rendition = 0;
+    if (info.Length() > 2 && info[2].IsNumber())
+        rendition = info[2].As<Napi::Number>().Int32Value();
+    bool requestKeyframe = false;
+    if (info.Length() > 3 && info[3].IsBoolean())
+        requestKeyframe = info[3].As<Napi::Boolean>().Value();
+    uint64_t lastSeq = 0;
+    if (info.Length() > 4 && info[4].IsNumber())
+        lastSeq = static_cast<uint64_t>(info[4].As<Napi::Number>().Int64Value());
     try
     {
-        EncoderOutput frame = _manager->GetNextFrame(devId, index);
+        EncoderOutput frame = _manager->GetNextFrame(devId, index, rendition, requestKeyframe, lastSeq);
+        return FrameToJs(env, std::move(frame));
+    }
+    catch (const std::exception &e)
+    {
+        spdlog::error("GetNextFrame error: {}", e.what());
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    catch (...)
+    {
+        spdlog::error("GetNextFrame error");
+        Napi::Error::New(env, "GetNextFrame unknown error").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
 
-        Napi::Object obj = Napi::Object::New(env);
-        obj.Set("success", Napi::Boolean::New(env, frame.success));
+// JS: getFrames([{ devId, index, rendition?, lastSeq? }, ...], packed?) -> { frames: [...], data?: ArrayBuffer }
+//     frames 只含有新帧的项，request 为其在请求数组中的下标；
+//     packed 时各帧数据拷进同一个 ArrayBuffer，帧上给出 offset / size，不再各带 data
+Napi::Value MediaManagerWrapper::GetFrames(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsArray())
+    {
+        Napi::TypeError::New(env, "Expected: getFrames(requests: { devId: string, index: number, rendition?: number, lastSeq?: number }[], packed?: boolean)")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    Napi::Array list = info[0].As<Napi::Array>();
+    bool packed = info.Length() > 1 && info[1].IsBoolean() && info[1].As<Napi::Boolean>().Value();
 
-        if (frame.success)
+    std::vector<FrameRequest> requests(list.Length());
+    for (uint32_t i = 0; i < list.Length(); ++i)
+    {
+        Napi::Value item = list.Get(i);
+        if (!item.IsObject())
+        {
+            Napi::TypeError::New(env, "getFrames: each request must be { devId: string, index: number, rendition?: number, lastSeq?: number }")
+                .ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Object req = item.As<Napi::Object>();
+        Napi::Value devId = req.Get("devId");
+        Napi::Value index = req.Get("index");
+        if (!devId.IsString() || !index.IsNumber())
         {
-            // 使用 Copy 模式将 C++ vector 数据拷贝到 JS Buffer
-            obj.Set("data", Napi::Buffer<uint8_t>::Copy(env, frame.data.data(), frame.data.size()));
-            obj.Set("width", Napi::Number::New(env, frame.width));
-            obj.Set("height", Napi::Number::New(env, frame.height));
-            obj.Set("timestamp", Napi::Number::New(env, frame.timestamp));
+            Napi::TypeError::New(env, "getFrames: each request must be { devId: string, index: number, rendition?: number, lastSeq?: number }")
+                .ThrowAsJavaScriptException();
+            return env.Null();
         }
+        requests[i].deviceId = devId.As<Napi::String>().Utf8Value();
+        requests[i].indexCode = index.As<Napi::Number>().Int32Value();
+        Napi::Value rendition = req.Get("rendition");
+        if (rendition.IsNumber())
+            requests[i].rendition = rendition.As<Napi::Number>().Int32Value();
+        Napi::Value lastSeq = req.Get("lastSeq");
+        if (lastSeq.IsNumber())
+            requests[i].lastSeq = static_cast<uint64_t>(lastSeq.As<Napi::Number>().Int64Value());
+    }
 
-        return obj;
+    try
+    {
+        std::vector<EncoderOutput> frames = _manager->GetFrames(requests);
+        Napi::Object result = Napi::Object::New(env);
+        Napi::Array out = Napi::Array::New(env);
+        uint32_t count = 0;
+        if (!packed)
+        {
+            for (size_t i = 0; i < frames.size(); ++i)
+            {
+                if (!frames[i].success)
+                    continue;
+                Napi::Object obj = FrameToJs(env, std::move(frames[i]));
+                obj.Set("request", Napi::Number::New(env, static_cast<double>(i)));
+                out.Set(count++, obj);
+            }
+            result.Set("frames", out);
+            return result;
+        }
+
+        // 打包：一次分配，逐帧拷贝
+        size_t total = 0;
+        for (auto &frame : frames)
+            if (frame.success)
+                total += frame.data.size();
+        Napi::ArrayBuffer data = Napi::ArrayBuffer::New(env, total);
+        uint8_t *dst = static_cast<uint8_t *>(data.Data());
+        size_t offset = 0;
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            if (!frames[i].success)
+                continue;
+            Napi::Object obj = Napi::Object::New(env);
+            FrameMetaToJs(env, frames[i], obj);
+            obj.Set("request", Napi::Number::New(env, static_cast<double>(i)));
+            obj.Set("offset", Napi::Number::New(env, static_cast<double>(offset)));
+            obj.Set("size", Napi::Number::New(env, static_cast<double>(frames[i].data.size())));
+            if (!frames[i].data.empty())
+                std::memcpy(dst + offset, frames[i].data.data(), frames[i].data.size());
+            offset += frames[i].data.size();
+            out.Set(count++, obj);
+        }
+        result.Set("frames", out);
+        result.Set("data", data);
+        return result;
     }
     catch (const std::exception &e)
     {
-        spdlog::error("GetNextFrame error: {}", e.what());
+        spdlog::error("GetFrames error: {}", e.what());
         Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
         return env.Null();
     }
     catch (...)
     {
-        spdlog::error("GetNextFrame error");
-        Napi::Error::New(env, "GetNextFrame unknown error").ThrowAsJavaScriptException();
+        spdlog::error("GetFrames error");
+        Napi::Error::New(env, "GetFrames unknown error").ThrowAsJavaScriptException();
         return env.Null();
     }
 }
+
+// JS: subscribe(deviceId, index, callback, options?) -> 订阅 id，失败为 -1
+//     options: { rendition?: number, latestOnly?: boolean (默认 true), maxFps?: number }
+//     callback(frame) 在 JS 线程上调用，frame 与 getNextFrame 的返回值相同；latestOnly 时回调返回后才投递下一帧，
+//     否则最多 8 帧排在 JS 线程上，其余的按订阅的规则丢弃
+Napi::Value MediaManagerWrapper::Subscribe(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsFunction())
+    {
+        Napi::TypeError::New(env, "Expected: subscribe(deviceId: string, index: number, callback: (frame) => void, options?: { rendition?: number, latestOnly?: boolean, maxFps?: number })")
+            .ThrowAsJavaScriptException();
+        return Napi::Number::New(env, -1);
+    }
+    int rendition = 0;
+    SubscribeOptions options;
+    if (info.Length() > 3 && info[3].IsObject())
+    {
+        Napi::Object opt = info[3].As<Napi::Object>();
+        if (opt.Get("rendition").IsNumber())
+            rendition = opt.Get("rendition").As<Napi::Number>().Int32Value();
+        if (opt.Get("latestOnly").IsBoolean())
+            options.latestOnly = opt.Get("latestOnly").As<Napi::Boolean>().Value();
+        if (opt.Get("maxFps").IsNumber())
+            options.maxFps = opt.Get("maxFps").As<Napi::Number>().DoubleValue();
+    }
+
+    auto sink = std::make_shared<JsSink>();
+    sink->tsfn = Napi::ThreadSafeFunction::New(env, info[2].As<Napi::Function>(), "MediaManager.subscribe", 0, 1);
+    // 与轮询一致，订阅本身不阻止进程退出
+    sink->tsfn.Unref(env);
+    // 订阅对象在 Subscribe 返回后才填入；JS 线程此刻正在执行本函数，回调不会先于赋值运行
+    auto holder = std::make_shared<std::weak_ptr<FrameSubscription>>();
+    auto callback = [sink, holder](EncoderOutput &&out)
+    {
+        auto *frame = new EncoderOutput(std::move(out));
+        bool queued = sink->Call(frame, [holder](Napi::Env env, Napi::Function js, EncoderOutput *f)
+                                 {
+            std::unique_ptr<EncoderOutput> owned(f);
+            auto sub = holder->lock();
+            // 已退订或环境正在销毁：丢弃排队中的帧
+            if (!sub || sub->Cancelled() || env == nullptr)
+                return;
+            try
+            {
+                js.Call({FrameToJs(env, std::move(*owned))});
+            }
+            catch (...)
+            {
+                sub->Release();
+                throw;
+            }
+            sub->Release(); });
+        // 已退订或队列已关闭，投递任务随后结束
+        if (!queued)
+        {
+            delete frame;
+            if (auto sub = holder->lock())
+                sub->Release();
+        }
+    };
+
+    auto sub = _manager->Subscribe(info[0].As<Napi::String>(), info[1].As<Napi::Number>(), rendition, std::move(callback), options);
+    if (!sub)
+    {
+        sink->Release();
+        return Napi::Number::New(env, -1);
+    }
+    *holder = sub;
+    // 订阅随流 / rendition / 管理器一起取消时同样释放 ThreadSafeFunction，不必等 JS 退订
+    sub->SetOnCancel([sink]
+                     { sink->Release(); });
+    return Napi::Number::New(env, sub->Id());
+}
+
+// JS: unsubscribe(id) -> boolean
+Napi::Value MediaManagerWrapper::Unsubscribe(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected: unsubscribe(id: number)")
+            .ThrowAsJavaScriptException();
+        return Napi::Boolean::New(env, false);
+    }
+    // 取消回调负责释放 ThreadSafeFunction
+    return Napi::Boolean::New(env, _manager->Unsubscribe(info[0].As<Napi::Number>().Int32Value()));
+}
+
 Napi::Value GetMediaInfoWrap(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
@@ -12,12 +12,28 @@ private:
     Napi::Value AddMedia(const Napi::CallbackInfo& info);
     Napi::Value DeleteMedia(const Napi::CallbackInfo &info);
     Napi::Value GetNextFrame(const Napi::CallbackInfo &info);
+    Napi::Value GetFrames(const Napi::CallbackInfo &info);
     Napi::Value UpdateROI(const Napi::CallbackInfo& info);
     Napi::Value UpdateQuality(const Napi::CallbackInfo& info);
     Napi::Value UpdateOutputSize(const Napi::CallbackInfo& info);
     Napi::Value SeekTo(const Napi::CallbackInfo& info);
     Napi::Value Pause(const Napi::CallbackInfo& info);
     Napi::Value Resume(const Napi::CallbackInfo& info);
+    Napi::Value SetEncodeOnDemand(const Napi::CallbackInfo& info);
+    Napi::Value SetSceneThreshold(const Napi::CallbackInfo& info);
+    Napi::Value SetEncoderThreads(const Napi::CallbackInfo& info);
+    Napi::Value SetRateControl(const Napi::CallbackInfo& info);
+    Napi::Value AddRendition(const Napi::CallbackInfo& info);
+    Napi::Value RemoveRendition(const Napi::CallbackInfo& info);
+    Napi::Value GetStats(const Napi::CallbackInfo& info);
+    Napi::Value JoinSyncGroup(const Napi::CallbackInfo& info);
+    Napi::Value LeaveSyncGroup(const Napi::CallbackInfo& info);
+    Napi::Value SetDemuxLimits(const Napi::CallbackInfo& info);
+    Napi::Value SetPresentQueue(const Napi::CallbackInfo& info);
+    Napi::Value SetPacingSpin(const Napi::CallbackInfo& info);
+    Napi::Value GetPacingStats(const Napi::CallbackInfo& info);
+    Napi::Value Subscribe(const Napi::CallbackInfo& info);
+    Napi::Value Unsubscribe(const Napi::CallbackInfo& info);
 
     std::unique_ptr<MediaManager> _manager;
 };
\ No newline at end of file